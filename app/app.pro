@@ -4,24 +4,52 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 CONFIG += c++14
 
+LIBS += -lz
+
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    bufferpool.cpp \
     correctionfactor.cpp \
+    correctiontable.cpp \
+    correctiontablecache.cpp \
+    displaypyramid.cpp \
     filemanager.cpp \
+    idlethreads.cpp \
+    imagewriter.cpp \
     main.cpp \
     mainwindow.cpp \
+    pngencoder.cpp \
+    previewrenderer.cpp \
+    rectifykernel.cpp \
     rectifythread.cpp \
-    threadmanager.cpp
+    resamplemap.cpp \
+    rowscheduler.cpp \
+    threadmanager.cpp \
+    tracer.cpp \
+    workerpool.cpp
 
 HEADERS += \
+    bufferpool.h \
     correctionfactor.h \
+    correctiontable.h \
+    correctiontablecache.h \
+    displaypyramid.h \
     filemanager.h \
+    idlethreads.h \
+    imagewriter.h \
     mainwindow.h \
+    pngencoder.h \
+    previewrenderer.h \
+    rectifykernel.h \
     rectifythread.h \
-    threadmanager.h
+    resamplemap.h \
+    rowscheduler.h \
+    threadmanager.h \
+    tracer.h \
+    workerpool.h
 
 FORMS += \
     mainwindow.ui
@@ -0,0 +1,210 @@
+//============================================================================
+// Name        : bufferpool.cpp
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This class is responsible for the memory rectified images
+//               are written into. Rather than allocating a full size image
+//               for every render, images are handed out on top of buffers
+//               that come back to the pool once the image is released, and
+//               the next image that fits takes the smallest idle buffer that
+//               holds it. Buffers are allocated with some headroom, rounded
+//               up to whole huge pages, so the small changes in rectified
+//               width a slider move makes still fit. On Linux large buffers
+//               are aligned to a huge page and advised to be backed by
+//               transparent huge pages, which cuts TLB misses when whole
+//               images are swept. Scanlines are padded to a cache line. The
+//               idle buffers are capped in total, past that returned ones
+//               are freed, smallest first. A fresh buffer is not touched
+//               before it is handed out, so its pages are still placed by
+//               whichever thread first writes them.
+//============================================================================
+
+#include "bufferpool.h"
+#include "tracer.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <vector>
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
+#endif
+#ifdef Q_OS_WIN
+#include <malloc.h>
+#endif
+
+struct PooledBuffer{
+    uchar *data;
+    qint64 capacity;
+};
+
+struct BufferPoolState{
+    QMutex mutex;
+    vector<PooledBuffer> idle; //Sorted by capacity, smallest first
+    qint64 idleBytes = 0;
+    qint64 maxIdleBytes;
+    qint64 allocations = 0;
+    qint64 reuses = 0;
+    bool closed = false; //Set once the pool is gone, buffers coming back are freed
+};
+
+//Travels with an image as its cleanup info, back to the pool it came from
+struct BufferTicket{
+    shared_ptr<BufferPoolState> state;
+    PooledBuffer buffer;
+};
+
+static uchar *allocateBuffer(qint64 capacity){
+    //Huge page aligned when large enough to hold one, cache line aligned otherwise
+    size_t alignment = capacity >= BufferPool::hugePageBytes ? static_cast<size_t>(BufferPool::hugePageBytes) : static_cast<size_t>(BufferPool::rowAlignment);
+#ifdef Q_OS_WIN
+    void *data = _aligned_malloc(static_cast<size_t>(capacity), alignment);
+#else
+    void *data = nullptr;
+    if(posix_memalign(&data, alignment, static_cast<size_t>(capacity)) != 0){
+        data = nullptr;
+    }
+#endif
+#if defined(Q_OS_LINUX) && defined(MADV_HUGEPAGE)
+    if(data != nullptr && alignment == static_cast<size_t>(BufferPool::hugePageBytes)){
+        madvise(data, static_cast<size_t>(capacity), MADV_HUGEPAGE); //Only advice, the kernel may still use small pages
+    }
+#endif
+    return static_cast<uchar *>(data);
+}
+
+static void freeBuffer(uchar *data){
+#ifdef Q_OS_WIN
+    _aligned_free(data);
+#else
+    free(data);
+#endif
+}
+
+static void evictIdle(BufferPoolState *state, qint64 maxIdleBytes){
+    //Called with the state's mutex held, frees the smallest idle buffers while over maxIdleBytes
+    while(state->idleBytes > maxIdleBytes && !state->idle.empty()){
+        state->idleBytes -= state->idle.front().capacity;
+        freeBuffer(state->idle.front().data);
+        state->idle.erase(state->idle.begin());
+    }
+}
+
+static void keepIdle(BufferPoolState *state, const PooledBuffer &buffer){
+    //Called with the state's mutex held, in capacity order
+    auto position = lower_bound(state->idle.begin(), state->idle.end(), buffer.capacity, [](const PooledBuffer &idle, qint64 capacity){
+        return idle.capacity < capacity;
+    });
+    state->idle.insert(position, buffer);
+    state->idleBytes += buffer.capacity;
+    evictIdle(state, state->maxIdleBytes);
+}
+
+static void returnBuffer(void *info){
+    //Cleanup function of every pooled image, run by whichever thread drops its last copy
+    BufferTicket *ticket = static_cast<BufferTicket *>(info);
+    {
+        QMutexLocker locker(&ticket->state->mutex);
+        if(ticket->state->closed){
+            freeBuffer(ticket->buffer.data);
+        } else {
+            keepIdle(ticket->state.get(), ticket->buffer);
+        }
+    }
+    delete ticket;
+}
+
+BufferPool::BufferPool(qint64 maxIdleBytes): state(make_shared<BufferPoolState>()){
+    this->state->maxIdleBytes = maxIdleBytes;
+}
+
+BufferPool::~BufferPool(){
+    //Images still out free their own buffers from now on
+    QMutexLocker locker(&this->state->mutex);
+    this->state->closed = true;
+    evictIdle(this->state.get(), 0);
+}
+
+BufferPool &BufferPool::instance(){
+    static BufferPool bufferPool;
+    return bufferPool;
+}
+
+qint64 BufferPool::capacityFor(qint64 bytes){
+    //An eighth more than asked for, in whole huge pages, so a slightly wider image fits the same buffer
+    qint64 capacity = bytes + bytes / 8;
+    return (capacity + hugePageBytes - 1) / hugePageBytes * hugePageBytes;
+}
+
+QImage BufferPool::acquireImage(int width, int height, QImage::Format format){
+    //An image on the smallest idle buffer that holds it, or on a new one, null like QImage's own when memory runs out
+    if(width <= 0 || height <= 0 || format == QImage::Format_Invalid){
+        return QImage();
+    }
+    int depth = QImage::toPixelFormat(format).bitsPerPixel();
+    qint64 bytesPerLine = ((static_cast<qint64>(width) * depth + 7) / 8 + rowAlignment - 1) / rowAlignment * rowAlignment;
+    qint64 bytes = bytesPerLine * height;
+    if(bytes < minPooledBytes || bytesPerLine > INT_MAX){
+        return QImage(width, height, format);
+    }
+
+    PooledBuffer buffer = {nullptr, 0};
+    {
+        QMutexLocker locker(&this->state->mutex);
+        auto position = lower_bound(this->state->idle.begin(), this->state->idle.end(), bytes, [](const PooledBuffer &idle, qint64 capacity){
+            return idle.capacity < capacity;
+        });
+        if(position != this->state->idle.end()){
+            buffer = *position;
+            this->state->idle.erase(position);
+            this->state->idleBytes -= buffer.capacity;
+            this->state->reuses++;
+        } else {
+            this->state->allocations++;
+        }
+    }
+    if(buffer.data == nullptr){
+        TraceScope trace("BufferPool::allocate");
+        buffer.capacity = capacityFor(bytes);
+        buffer.data = allocateBuffer(buffer.capacity);
+        if(buffer.data == nullptr){
+            return QImage();
+        }
+    }
+    BufferTicket *ticket = new BufferTicket{this->state, buffer};
+    return QImage(buffer.data, width, height, static_cast<int>(bytesPerLine), format, returnBuffer, ticket);
+}
+
+void BufferPool::setMaxIdleBytes(qint64 maxIdleBytes){
+    QMutexLocker locker(&this->state->mutex);
+    this->state->maxIdleBytes = maxIdleBytes;
+    evictIdle(this->state.get(), maxIdleBytes);
+}
+
+void BufferPool::trim(){
+    //Free every idle buffer, the ones still in use come back as usual
+    QMutexLocker locker(&this->state->mutex);
+    evictIdle(this->state.get(), 0);
+}
+
+qint64 BufferPool::getAllocationCount() const{
+    QMutexLocker locker(&this->state->mutex);
+    return this->state->allocations;
+}
+
+qint64 BufferPool::getReuseCount() const{
+    QMutexLocker locker(&this->state->mutex);
+    return this->state->reuses;
+}
+
+qint64 BufferPool::getIdleBytes() const{
+    QMutexLocker locker(&this->state->mutex);
+    return this->state->idleBytes;
+}
+
+int BufferPool::getIdleCount() const{
+    QMutexLocker locker(&this->state->mutex);
+    return static_cast<int>(this->state->idle.size());
+}
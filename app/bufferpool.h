@@ -0,0 +1,48 @@
+//============================================================================
+// Name        : bufferpool.h
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is the class definition of BufferPool. Special note is
+//               that the images it hands out own nothing themselves: the
+//               last copy of one to go away hands its buffer back through
+//               QImage's cleanup function, so a buffer is only reused once
+//               every shallow copy (a queued save, a pyramid build) is done
+//               with it. Images may outlive the pool, their buffers are then
+//               freed instead of returned. Pixels are not cleared, whoever
+//               acquires an image has to write all of it.
+//============================================================================
+
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+#include <QImage>
+#include <memory>
+
+using namespace std;
+
+struct BufferPoolState;
+
+class BufferPool{
+private:
+    shared_ptr<BufferPoolState> state; //Shared with every image handed out, which may outlive the pool
+public:
+    static const int rowAlignment = 64; //Scanlines start on a cache line
+    static const qint64 hugePageBytes = qint64(2) << 20;
+    static const qint64 minPooledBytes = qint64(1) << 20; //Smaller images are left to QImage
+    static const qint64 defaultMaxIdleBytes = qint64(1) << 30;
+    explicit BufferPool(qint64 maxIdleBytes = defaultMaxIdleBytes);
+    ~BufferPool();
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+    static BufferPool &instance();
+    static qint64 capacityFor(qint64 bytes);
+    QImage acquireImage(int width, int height, QImage::Format format);
+    void setMaxIdleBytes(qint64 maxIdleBytes);
+    void trim();
+    qint64 getAllocationCount() const;
+    qint64 getReuseCount() const;
+    qint64 getIdleBytes() const;
+    int getIdleCount() const;
+};
+
+#endif // BUFFERPOOL_H
@@ -7,10 +7,21 @@
 //               values used to correct the spherical deformation on a pixel-
 //               by-pixel basis. The implementation rounds off these values
 //               and is not perfect, but it does produce an image pleasing to
-//               the eye.
+//               the eye. The vector is also turned into a ResampleMap on
+//               request, which is shared by every thread rectifying with the
+//               current parameters. Vectors come from CorrectionTableCache,
+//               and are only computed here when no earlier run or session
+//               has produced one for the same parameters. The computation
+//               works in double with every per-table term hoisted, only
+//               covers one half of the (symmetric) vector and splits wide
+//               tables across threads. The original long double loop is
+//               kept as calcReferenceVector() to check it against.
 //============================================================================
 
 #include "correctionfactor.h"
+#include "tracer.h"
+#include <algorithm>
+#include <thread>
 
 long double CorrectionFactor::calcThetaSin(long double thetaCenterAngle) const{
     return atan(earthRadius * sin(thetaCenterAngle) / (satelliteAltitude + earthRadius * (1 - cos(thetaCenterAngle))));
@@ -33,50 +44,124 @@ long double CorrectionFactor::calcThetaCenter(int imgWidth, int imgColumn) const
 }
 
 void CorrectionFactor::calcRectifiedWidth(){
-    this->rectifiedWidth = ceil(accumulate(this->correctionFactors.begin(), this->correctionFactors.end(), 0.0));
+    this->rectifiedWidth = ceil(accumulate(this->correctionTable->begin(), this->correctionTable->end(), 0.0));
 }
 
-void CorrectionFactor::calcCorrectionVector(){
-    correctionFactors.clear();
+vector<long double> CorrectionFactor::calcReferenceVector() const{
+    //The original per-column evaluation, kept to verify the fast path against
+    vector<long double> referenceFactors;
     for(int imgColumn = 0; imgColumn <= this->imageWidth; imgColumn++){
-        correctionFactors.push_back(calcCorrectionFactor(this->calcThetaCenter(this->imageWidth, imgColumn)));
+        referenceFactors.push_back(calcCorrectionFactor(this->calcThetaCenter(this->imageWidth, imgColumn)));
+    }
+    return referenceFactors;
+}
+
+void CorrectionFactor::calcCorrectionRange(double *factors, int firstColumn, int endColumn) const{
+    //Same math as calcThetaCenter() and calcCorrectionFactor(), in double and with the shared terms pulled out
+    const double radius = this->earthRadius;
+    const double radius_squared = radius * radius;
+    const double orbit_radius = this->satelliteOrbitRadius;
+    const double radius_difference = radius_squared - orbit_radius * orbit_radius;
+    const double altitude = this->satelliteAltitude;
+    const double norm_factor = radius / altitude;
+    const double edge_theta_sin = static_cast<double>(calcThetaSin(thetaCenter / 2.0));
+    const double half_width = this->imageWidth / 2.0;
+    for(int imgColumn = firstColumn; imgColumn < endColumn; imgColumn++){
+        double theta_sin = edge_theta_sin * (abs(imgColumn - half_width) / half_width);
+        double tan_squared = tan(theta_sin) * tan(theta_sin);
+        double delta_sqrt = sqrt(radius_squared + tan_squared * radius_difference);
+        double theta_center = acos((tan_squared * orbit_radius + delta_sqrt) / (radius * (tan_squared + 1)));
+        double sin_center = sin(theta_center);
+        double cos_center = cos(theta_center);
+        double distance = altitude + radius * (1 - cos_center);
+        double tan_ratio = radius * sin_center / distance;
+        double tan_derivative_recip = 1 + tan_ratio * tan_ratio;
+        double arg_derivative_recip = distance * distance / (radius * cos_center * distance - radius_squared * sin_center * sin_center);
+        factors[imgColumn] = norm_factor * tan_derivative_recip * arg_derivative_recip;
+    }
+}
+
+void CorrectionFactor::calcCorrectionVector(CorrectionTable *table) const{
+    TraceScope trace("CorrectionFactor::calcCorrectionVector");
+    //Column c and column imageWidth - c are the same distance from the center, so only compute up to the middle
+    double *factors = table->getData();
+    int halfColumns = this->imageWidth / 2 + 1;
+    int threads = min(static_cast<int>(thread::hardware_concurrency()), halfColumns / minColumnsPerThread);
+    if(threads <= 1){
+        this->calcCorrectionRange(factors, 0, halfColumns);
+    } else {
+        vector<thread> workers;
+        int threadColumns = (halfColumns + threads - 1) / threads;
+        for(int firstColumn = 0; firstColumn < halfColumns; firstColumn += threadColumns){
+            workers.emplace_back(&CorrectionFactor::calcCorrectionRange, this, factors, firstColumn, min(firstColumn + threadColumns, halfColumns));
+        }
+        for(thread &worker : workers){
+            worker.join();
+        }
+    }
+    for(int imgColumn = 0; imgColumn < halfColumns; imgColumn++){
+        factors[this->imageWidth - imgColumn] = factors[imgColumn];
     }
 }
 
+void CorrectionFactor::update(){
+    //Fetch the vector for the current parameters, computing it only on a cache miss
+    if(!this->outdated){
+        return;
+    }
+    CorrectionTableKey key = {this->imageWidth, this->earthRadius, this->satelliteAltitude, this->satelliteSwath, this->thetaCenter};
+    this->correctionTable = CorrectionTableCache::instance().lookup(key, [this](CorrectionTable *computed){
+        this->calcCorrectionVector(computed);
+    }, this->persistent);
+    this->calcRectifiedWidth();
+    this->resampleMap.reset();
+    this->outdated = false;
+}
+
 CorrectionFactor::CorrectionFactor(int imgWidth){
     this->imageWidth = imgWidth;
-    calcCorrectionVector();
-    calcRectifiedWidth();
 }
 
 void CorrectionFactor::setImageWidth(int imgWidth){
     if(this->imageWidth != imgWidth){
         this->imageWidth = imgWidth;
-        calcCorrectionVector();
-        calcRectifiedWidth();
+        this->outdated = true;
     }
 }
 
 void CorrectionFactor::setEarthRadius(double earthRadius){
     this->earthRadius = earthRadius;
-    this->calcCorrectionVector();
-    this->calcRectifiedWidth();
+    this->outdated = true;
 }
 
 void CorrectionFactor::setSatelliteAltitude(double satelliteAltitude){
     this->satelliteAltitude = satelliteAltitude;
-    this->calcCorrectionVector();
-    this->calcRectifiedWidth();
+    this->outdated = true;
 }
 
 void CorrectionFactor::setSatelliteSwath(int satelliteSwath){
     this->satelliteSwath = satelliteSwath;
     this->thetaCenter = satelliteSwath / earthRadius;
-    this->calcCorrectionVector();
-    this->calcRectifiedWidth();
+    this->outdated = true;
+}
+
+void CorrectionFactor::setFilter(ResampleFilter filter){
+    //The correction vector stays valid, only the map has to be rebuilt with the new taps
+    if(this->filter != filter){
+        this->filter = filter;
+        this->resampleMap.reset();
+    }
+}
+
+void CorrectionFactor::setParameters(double earthRadius, double satelliteAltitude, int satelliteSwath){
+    //Same as calling the three setters in this order, the vector is fetched once when next read
+    this->setEarthRadius(earthRadius);
+    this->setSatelliteAltitude(satelliteAltitude);
+    this->setSatelliteSwath(satelliteSwath);
 }
 
 int CorrectionFactor::getRectifiedWidth(){
+    this->update();
     return this->rectifiedWidth;
 }
 
@@ -104,6 +189,16 @@ int CorrectionFactor::getDefaultSatelliteSwath() const{
     return this->defaultSatelliteSwath;
 }
 
-vector<long double> CorrectionFactor::getVector(){
-    return this->correctionFactors;
+shared_ptr<const CorrectionTable> CorrectionFactor::getTable(){
+    this->update();
+    return this->correctionTable;
+}
+
+shared_ptr<const ResampleMap> CorrectionFactor::getResampleMap(){
+    //Build the column map once per parameter set, then hand out the same one
+    this->update();
+    if(!this->resampleMap){
+        this->resampleMap = make_shared<ResampleMap>(this->imageWidth, this->rectifiedWidth, *this->correctionTable, this->filter);
+    }
+    return this->resampleMap;
 }
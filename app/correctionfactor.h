@@ -3,20 +3,27 @@
 // Author      : TGYK
 // Date        : 12/14/2020
 // E-Mail      : tgyk@tgyk.net
-// Description : This is the class definition of CorrectionFactor
+// Description : This is the class definition of CorrectionFactor. Special
+//               note is that setters only record the new parameters; the
+//               vector is fetched or computed the next time anything reads
+//               it.
 //============================================================================
 
 #ifndef CORRECTIONFACTOR_H
 #define CORRECTIONFACTOR_H
 #include <math.h>
+#include <memory>
 #include <numeric>
 #include <vector>
+#include "correctiontable.h"
+#include "correctiontablecache.h"
+#include "resamplemap.h"
 
 using namespace std;
 
 class CorrectionFactor{
 private:
-    vector<long double> correctionFactors;
+    shared_ptr<const CorrectionTable> correctionTable; //Shared with the cache and everyone else using these parameters
     double earthRadius = 6371.0;
     const double defaultEarthRadius = 6371.0;
     double satelliteAltitude = 822.5;
@@ -27,18 +34,29 @@ private:
     double thetaCenter = satelliteSwath / earthRadius;
     int imageWidth;
     int rectifiedWidth;
+    bool outdated = true; //Parameters changed since the vector was last fetched
+    bool persistent = true; //Whether the vector is worth saving to the disk cache
+    ResampleFilter filter = ResampleFilter::Linear; //Only affects the resample map, not the vector
+    shared_ptr<const ResampleMap> resampleMap; //Built on first request, dropped whenever the correction vector changes
     long double calcThetaSin(long double thetaCenterAngle) const; //Satellite angle for given center angle
     long double calcThetaCos(long double thetaSin) const; //Inverse of theta Sin
     long double calcCorrectionFactor(long double thetaCenterAngle) const; //Calculate the needed correction factor for given center angle
     long double calcThetaCenter(int imgWidth, int imgColumn) const; //Calculate the center angle given the image column and the overall width
     void calcRectifiedWidth();
-    void calcCorrectionVector();
+    void calcCorrectionVector(CorrectionTable *table) const;
+    void calcCorrectionRange(double *factors, int firstColumn, int endColumn) const;
+    void update();
 public:
+    static const int minColumnsPerThread = 1024; //Narrower tables are not worth starting threads for
     CorrectionFactor(int imgWidth = 1568);
     void setImageWidth(int imgWidth);
     void setEarthRadius(double earthRadius);
     void setSatelliteAltitude(double satelliteAltitude);
     void setSatelliteSwath(int satelliteSwath);
+    void setParameters(double earthRadius, double satelliteAltitude, int satelliteSwath);
+    void setFilter(ResampleFilter filter);
+    void setPersistent(bool persistent){this->persistent = persistent;}
+    ResampleFilter getFilter() const {return this->filter;}
     int getRectifiedWidth();
     double getEarthRadius() const;
     double getDefaultEarthRadius() const;
@@ -46,7 +64,9 @@ public:
     double getDefaultSatelliteAltitude() const;
     int getSatelliteSwath() const;
     int getDefaultSatelliteSwath() const;
-    vector<long double> getVector();
+    shared_ptr<const CorrectionTable> getTable();
+    vector<long double> calcReferenceVector() const;
+    shared_ptr<const ResampleMap> getResampleMap();
 };
 
 #endif // CORRECTIONFACTOR_H
@@ -0,0 +1,29 @@
+//============================================================================
+// Name        : correctiontable.cpp
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This class is responsible for owning the values of one
+//               correction vector, one double per original column plus the
+//               closing edge, in storage aligned for vector loads. Tables
+//               are filled once, by CorrectionFactor or from the disk cache,
+//               and are read-only from then on.
+//============================================================================
+
+#include "correctiontable.h"
+#include <QtGlobal>
+#include <cstring>
+
+atomic<int> CorrectionTable::allocations{0};
+
+CorrectionTable::CorrectionTable(int size){
+    this->size = size > 0 ? size : 0;
+    this->factors = static_cast<double *>(qMallocAligned(sizeof(double) * (this->size > 0 ? this->size : 1), alignment));
+    Q_CHECK_PTR(this->factors);
+    memset(this->factors, 0, sizeof(double) * this->size);
+    allocations++;
+}
+
+CorrectionTable::~CorrectionTable(){
+    qFreeAligned(this->factors);
+}
@@ -0,0 +1,38 @@
+//============================================================================
+// Name        : correctiontable.h
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is the class definition of CorrectionTable. Special note
+//               is that it cannot be copied: it is handed around as a
+//               shared_ptr<const CorrectionTable>, so every user of a
+//               parameter set reads the very same cache-line aligned values.
+//============================================================================
+
+#ifndef CORRECTIONTABLE_H
+#define CORRECTIONTABLE_H
+#include <atomic>
+
+using namespace std;
+
+class CorrectionTable{
+private:
+    double *factors;
+    int size;
+    static atomic<int> allocations; //Tables ever allocated, to verify sharing
+public:
+    static const int alignment = 64;
+    explicit CorrectionTable(int size);
+    ~CorrectionTable();
+    CorrectionTable(const CorrectionTable &) = delete;
+    CorrectionTable &operator=(const CorrectionTable &) = delete;
+    int getSize() const {return this->size;}
+    const double *getData() const {return this->factors;}
+    double *getData() {return this->factors;}
+    double operator[](int column) const {return this->factors[column];}
+    const double *begin() const {return this->factors;}
+    const double *end() const {return this->factors + this->size;}
+    static int getAllocationCount() {return allocations.load();}
+};
+
+#endif // CORRECTIONTABLE_H
@@ -0,0 +1,221 @@
+//============================================================================
+// Name        : correctiontablecache.cpp
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This class is responsible for remembering correction vectors
+//               so the trigonometry behind them runs once per parameter set.
+//               A lookup first checks the tables kept for this session, then
+//               the cache directory on disk, and only computes the table if
+//               neither has it. Each file holds a short header repeating the
+//               key, followed by the raw values, and is written atomically so
+//               concurrent batch jobs never see a partial table. Files whose
+//               header does not match (another build or format version)
+//               are ignored and overwritten. Once the directory grows past
+//               maxDiskBytes the oldest files are removed. Tables asked for
+//               as not persistent, like the preview proxy's, stay in memory
+//               and never touch the disk.
+//============================================================================
+
+#include "correctiontablecache.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <cstring>
+#include <tuple>
+
+//Layout of the header at the start of every table file
+struct CorrectionTableHeader{
+    char magic[4];
+    quint32 version;
+    quint32 valueSize;
+    quint32 entries;
+    qint32 imageWidth;
+    qint32 satelliteSwath;
+    double earthRadius;
+    double satelliteAltitude;
+    double thetaCenter;
+};
+
+static const char tableMagic[4] = {'M', 'R', 'C', 'T'};
+static const quint32 tableVersion = 3; //3: stored as double, the width the kernel uses
+
+const qint64 CorrectionTableCache::maxDiskBytes;
+
+bool CorrectionTableKey::operator<(const CorrectionTableKey &other) const{
+    return tie(imageWidth, earthRadius, satelliteAltitude, satelliteSwath, thetaCenter) <
+           tie(other.imageWidth, other.earthRadius, other.satelliteAltitude, other.satelliteSwath, other.thetaCenter);
+}
+
+QString CorrectionTableKey::fileName() const{
+    //Width first so the files are easy to tell apart, then a hash of the exact parameter bits
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(reinterpret_cast<const char *>(&earthRadius), sizeof(earthRadius));
+    hash.addData(reinterpret_cast<const char *>(&satelliteAltitude), sizeof(satelliteAltitude));
+    hash.addData(reinterpret_cast<const char *>(&satelliteSwath), sizeof(satelliteSwath));
+    hash.addData(reinterpret_cast<const char *>(&thetaCenter), sizeof(thetaCenter));
+    return QString("%1-%2.ctab").arg(imageWidth).arg(QString::fromLatin1(hash.result().toHex().left(16)));
+}
+
+CorrectionTableCache &CorrectionTableCache::instance(){
+    static CorrectionTableCache cache;
+    return cache;
+}
+
+void CorrectionTableCache::setDirectory(const QString &directory){
+    QMutexLocker locker(&this->mutex);
+    this->directory = directory;
+    this->directoryChosen = true;
+}
+
+QString CorrectionTableCache::cacheDirectory(){
+    //Decided on first use, once the application name is known
+    if(!this->directoryChosen){
+        QString location = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        this->directory = location.isEmpty() ? QString() : location + "/correction-tables";
+        this->directoryChosen = true;
+    }
+    return this->directory;
+}
+
+void CorrectionTableCache::clearMemory(){
+    QMutexLocker locker(&this->mutex);
+    this->tables.clear();
+    this->insertionOrder.clear();
+}
+
+shared_ptr<const CorrectionTable> CorrectionTableCache::lookup(const CorrectionTableKey &key, const function<void(CorrectionTable *)> &compute, bool persistent){
+    QString directory;
+    {
+        QMutexLocker locker(&this->mutex);
+        while(true){
+            auto found = this->tables.find(key);
+            if(found != this->tables.end()){
+                this->memoryHits++;
+                return found->second;
+            }
+            if(this->inFlight.count(key) == 0){
+                break;
+            }
+            //Someone else is already on this table, wait for it rather than computing it twice
+            this->tableReady.wait(&this->mutex);
+        }
+        this->inFlight.insert(key);
+        directory = persistent ? this->cacheDirectory() : QString();
+    }
+
+    //Disk and trigonometry run unlocked, so other keys are never held up by this one
+    shared_ptr<CorrectionTable> table;
+    try {
+        table = loadTable(directory, key);
+        if(table){
+            this->diskLoads++;
+        } else {
+            table = make_shared<CorrectionTable>(key.imageWidth + 1);
+            compute(table.get());
+            this->computations++;
+            storeTable(directory, key, *table);
+        }
+    }  catch (...) {
+        //Let a waiter try for itself
+        QMutexLocker locker(&this->mutex);
+        this->inFlight.erase(key);
+        this->tableReady.wakeAll();
+        throw;
+    }
+
+    QMutexLocker locker(&this->mutex);
+    this->remember(key, table);
+    this->inFlight.erase(key);
+    this->tableReady.wakeAll();
+    return table;
+}
+
+void CorrectionTableCache::remember(const CorrectionTableKey &key, shared_ptr<const CorrectionTable> table){
+    //Slider sessions go through a lot of parameter sets, only keep the most recent ones
+    this->tables[key] = table;
+    this->insertionOrder.push_back(key);
+    while(static_cast<int>(this->insertionOrder.size()) > maxMemoryTables){
+        this->tables.erase(this->insertionOrder.front());
+        this->insertionOrder.pop_front();
+    }
+}
+
+shared_ptr<CorrectionTable> CorrectionTableCache::loadTable(const QString &directory, const CorrectionTableKey &key){
+    if(directory.isEmpty()){
+        return nullptr;
+    }
+    QFile file(QDir(directory).filePath(key.fileName()));
+    if(!file.open(QIODevice::ReadOnly) || file.size() < static_cast<qint64>(sizeof(CorrectionTableHeader))){
+        return nullptr;
+    }
+    uchar *data = file.map(0, file.size());
+    if(data == nullptr){
+        return nullptr;
+    }
+
+    //Only trust a file that repeats the exact key and matches this build's value size
+    CorrectionTableHeader header;
+    memcpy(&header, data, sizeof(header));
+    bool valid = memcmp(header.magic, tableMagic, sizeof(tableMagic)) == 0 &&
+                 header.version == tableVersion &&
+                 header.valueSize == sizeof(double) &&
+                 header.entries == static_cast<quint32>(key.imageWidth + 1) &&
+                 header.imageWidth == key.imageWidth &&
+                 header.satelliteSwath == key.satelliteSwath &&
+                 header.earthRadius == key.earthRadius &&
+                 header.satelliteAltitude == key.satelliteAltitude &&
+                 header.thetaCenter == key.thetaCenter &&
+                 file.size() == static_cast<qint64>(sizeof(header) + header.entries * sizeof(double));
+    shared_ptr<CorrectionTable> table;
+    if(valid){
+        table = make_shared<CorrectionTable>(header.entries);
+        memcpy(table->getData(), data + sizeof(header), header.entries * sizeof(double));
+    }
+    file.unmap(data);
+    return table;
+}
+
+void CorrectionTableCache::storeTable(const QString &directory, const CorrectionTableKey &key, const CorrectionTable &table){
+    //Best effort, a cache that cannot be written just means computing again next run
+    if(directory.isEmpty() || !QDir().mkpath(directory)){
+        return;
+    }
+    CorrectionTableHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, tableMagic, sizeof(tableMagic));
+    header.version = tableVersion;
+    header.valueSize = sizeof(double);
+    header.entries = static_cast<quint32>(table.getSize());
+    header.imageWidth = key.imageWidth;
+    header.satelliteSwath = key.satelliteSwath;
+    header.earthRadius = key.earthRadius;
+    header.satelliteAltitude = key.satelliteAltitude;
+    header.thetaCenter = key.thetaCenter;
+
+    QSaveFile file(QDir(directory).filePath(key.fileName()));
+    if(!file.open(QIODevice::WriteOnly)){
+        return;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(table.getData()), table.getSize() * sizeof(double));
+    if(file.commit()){
+        trimDirectory(directory);
+    }
+}
+
+void CorrectionTableCache::trimDirectory(const QString &directory){
+    //Newest first, everything past the budget goes; another run may be removing the same files
+    QFileInfoList files = QDir(directory).entryInfoList(QStringList() << "*.ctab", QDir::Files, QDir::Time);
+    qint64 totalBytes = 0;
+    for(const QFileInfo &file : files){
+        totalBytes += file.size();
+        if(totalBytes > maxDiskBytes){
+            QFile::remove(file.filePath());
+        }
+    }
+}
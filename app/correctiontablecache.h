@@ -0,0 +1,73 @@
+//============================================================================
+// Name        : correctiontablecache.h
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is the class definition of CorrectionTableCache. Special
+//               note is that tables are kept in memory for the session and
+//               also written to small files in the cache directory, which
+//               later runs memory-map and copy instead of recomputing. The
+//               lock only guards the bookkeeping: tables are computed, read
+//               and written without it, and a key being worked on is marked
+//               in flight so everyone else asking for it waits instead of
+//               computing it again.
+//============================================================================
+
+#ifndef CORRECTIONTABLECACHE_H
+#define CORRECTIONTABLECACHE_H
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+#include "correctiontable.h"
+
+using namespace std;
+
+//Everything the correction vector depends on
+struct CorrectionTableKey{
+    int imageWidth;
+    double earthRadius;
+    double satelliteAltitude;
+    int satelliteSwath;
+    double thetaCenter; //Derived from the swath, but only when the swath is set, so it is part of the key too
+    bool operator<(const CorrectionTableKey &other) const;
+    QString fileName() const;
+};
+
+class CorrectionTableCache{
+private:
+    QMutex mutex;
+    QString directory;
+    bool directoryChosen = false;
+    map<CorrectionTableKey, shared_ptr<const CorrectionTable>> tables;
+    deque<CorrectionTableKey> insertionOrder; //Oldest first, for evicting
+    set<CorrectionTableKey> inFlight; //Being loaded or computed by some thread right now
+    QWaitCondition tableReady;
+    atomic<int> memoryHits{0};
+    atomic<int> diskLoads{0};
+    atomic<int> computations{0};
+    CorrectionTableCache(){}
+    QString cacheDirectory();
+    static shared_ptr<CorrectionTable> loadTable(const QString &directory, const CorrectionTableKey &key);
+    static void storeTable(const QString &directory, const CorrectionTableKey &key, const CorrectionTable &table);
+    static void trimDirectory(const QString &directory);
+    void remember(const CorrectionTableKey &key, shared_ptr<const CorrectionTable> table);
+public:
+    static const int maxMemoryTables = 64;
+    static const qint64 maxDiskBytes = qint64(32) << 20; //Oldest files are removed past this
+    static CorrectionTableCache &instance();
+    shared_ptr<const CorrectionTable> lookup(const CorrectionTableKey &key, const function<void(CorrectionTable *)> &compute, bool persistent = true);
+    void setDirectory(const QString &directory); //Empty keeps tables in memory only
+    void clearMemory();
+    int getMemoryHits() const {return this->memoryHits.load();}
+    int getDiskLoads() const {return this->diskLoads.load();}
+    int getComputations() const {return this->computations.load();}
+};
+
+#endif // CORRECTIONTABLECACHE_H
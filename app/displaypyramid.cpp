@@ -0,0 +1,185 @@
+//============================================================================
+// Name        : displaypyramid.cpp
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This class keeps a mip pyramid of an image for the display,
+//               so showing a huge image in a small view scales a level at
+//               most twice the view's size instead of converting the whole
+//               image to a QPixmap every time. Each level is a 2x2 box
+//               filtered half of the one before, computed in bands of rows
+//               on whichever pool threads are idle, and the whole build runs
+//               off the GUI thread. Bottom-up images are put the right way
+//               up while the first level is built, so the levels never need
+//               mirroring. Only downscaled levels are kept, a view larger
+//               than half the image is left to the full resolution image.
+//               Levels are taken from the BufferPool, so rebuilding them for
+//               every render reuses the memory of the levels they replace.
+//============================================================================
+
+#include "displaypyramid.h"
+#include "bufferpool.h"
+#include "idlethreads.h"
+#include "tracer.h"
+#include <QRunnable>
+#include <algorithm>
+#include <functional>
+
+class DisplayPyramidTask: public QRunnable{
+private:
+    DisplayPyramid *pyramid;
+    QImage source;
+    bool mirrored;
+    int generation;
+public:
+    DisplayPyramidTask(DisplayPyramid *pyramid, const QImage &source, bool mirrored, int generation):
+        pyramid(pyramid), source(source), mirrored(mirrored), generation(generation){}
+    void run() override{
+        this->pyramid->buildLevels(this->source, this->mirrored, this->generation);
+    }
+};
+
+DisplayPyramid::DisplayPyramid(QObject *parent): QObject(parent){
+    this->buildPool.setMaxThreadCount(1);
+    this->buildPool.setExpiryTimeout(-1);
+}
+
+DisplayPyramid::~DisplayPyramid(){
+    this->cancel();
+}
+
+void DisplayPyramid::build(const QImage &image, bool mirrored){
+    //Forget the old levels now, the new ones are published together once they are all done
+    int generation = ++this->generation;
+    {
+        QMutexLocker locker(&this->mutex);
+        this->levels.clear();
+        this->sourceSize = image.size();
+        this->built = false;
+    }
+    this->buildPool.start(new DisplayPyramidTask(this, image, mirrored, generation));
+}
+
+void DisplayPyramid::cancel(){
+    //Drop everything and make sure no build still holds the source
+    ++this->generation;
+    this->buildPool.waitForDone();
+    QMutexLocker locker(&this->mutex);
+    this->levels.clear();
+    this->sourceSize = QSize();
+    this->built = false;
+}
+
+void DisplayPyramid::waitForDone(){
+    this->buildPool.waitForDone();
+}
+
+bool DisplayPyramid::isReady(){
+    QMutexLocker locker(&this->mutex);
+    return this->built;
+}
+
+QSize DisplayPyramid::getSourceSize(){
+    QMutexLocker locker(&this->mutex);
+    return this->sourceSize;
+}
+
+int DisplayPyramid::levelCount(){
+    QMutexLocker locker(&this->mutex);
+    return static_cast<int>(this->levels.size());
+}
+
+QImage DisplayPyramid::levelFor(const QSize &size){
+    //Smallest level still covering the size, so scaling it down to the view never loses detail
+    QMutexLocker locker(&this->mutex);
+    for(auto level = this->levels.rbegin(); level != this->levels.rend(); level++){
+        if(level->width() >= size.width() && level->height() >= size.height()){
+            return *level;
+        }
+    }
+    return QImage();
+}
+
+void DisplayPyramid::buildLevels(const QImage &source, bool mirrored, int generation){
+    //Queued builds that were superseded before they started do nothing at all
+    if(this->generation != generation){
+        return;
+    }
+    TraceScope trace("DisplayPyramid::build");
+    vector<QImage> levels;
+    QImage level = source;
+    while(max(level.width(), level.height()) > minLevelSize && min(level.width(), level.height()) >= 2){
+        if(this->generation != generation){
+            return;
+        }
+        level = halve(level, mirrored && levels.empty());
+        levels.push_back(level);
+    }
+
+    QMutexLocker locker(&this->mutex);
+    if(this->generation != generation){
+        return;
+    }
+    this->levels = levels;
+    this->built = true;
+    locker.unlock();
+    emit levelsReady();
+}
+
+QImage DisplayPyramid::halve(const QImage &image, bool mirrored, QThreadPool *pool){
+    //Average each 2x2 block byte by byte, odd edges repeat their last row or column
+    QImage source = image;
+    switch(source.format()){
+    case QImage::Format_Grayscale8:
+    case QImage::Format_RGB888:
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        break;
+    default:
+        //Premultiplied so transparent pixels do not bleed their colour into the average
+        source = source.convertToFormat(source.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+        break;
+    }
+    int width = source.width();
+    int height = source.height();
+    if(width < 1 || height < 1){
+        return QImage();
+    }
+    QImage half = BufferPool::instance().acquireImage((width + 1) / 2, (height + 1) / 2, source.format()); //Every pixel is written below
+    if(half.isNull()){
+        return QImage();
+    }
+    int bytes_per_pixel = source.depth() / 8;
+    int half_width = half.width();
+    uchar *half_pixels = half.bits();
+    int half_bytes_per_line = half.bytesPerLine();
+    int bands = (half.height() + bandRows - 1) / bandRows;
+
+    atomic<int> nextBand{0};
+    function<void()> work = [&](){
+        for(int band = nextBand.fetch_add(1); band < bands; band = nextBand.fetch_add(1)){
+            int end_row = min(half.height(), (band + 1) * bandRows);
+            for(int row = band * bandRows; row < end_row; row++){
+                int top = 2 * row;
+                int bottom = min(top + 1, height - 1);
+                if(mirrored){
+                    top = height - 1 - top;
+                    bottom = height - 1 - bottom;
+                }
+                const uchar *top_row = source.constScanLine(top);
+                const uchar *bottom_row = source.constScanLine(bottom);
+                uchar *half_row = half_pixels + static_cast<qint64>(row) * half_bytes_per_line;
+                for(int column = 0; column < half_width; column++){
+                    int left = 2 * column * bytes_per_pixel;
+                    int right = min(2 * column + 1, width - 1) * bytes_per_pixel;
+                    for(int channel = 0; channel < bytes_per_pixel; channel++){
+                        half_row[column * bytes_per_pixel + channel] = static_cast<uchar>((top_row[left + channel] + top_row[right + channel] +
+                                                                                           bottom_row[left + channel] + bottom_row[right + channel] + 2) >> 2);
+                    }
+                }
+            }
+        }
+    };
+    runOnIdleThreads(pool, bands - 1, work);
+    return half;
+}
@@ -0,0 +1,56 @@
+//============================================================================
+// Name        : displaypyramid.h
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is the class definition of DisplayPyramid. Special note
+//               is that the levels are built on a pool thread from a shallow
+//               copy of the image, so the image must not be written to, or
+//               unmapped, until the build is done or cancel() returns. The
+//               levelsReady() signal is emitted from the building thread.
+//============================================================================
+
+#ifndef DISPLAYPYRAMID_H
+#define DISPLAYPYRAMID_H
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QSize>
+#include <QThreadPool>
+#include <atomic>
+#include <vector>
+
+using namespace std;
+
+class DisplayPyramid: public QObject{
+Q_OBJECT
+
+private:
+    QMutex mutex;
+    vector<QImage> levels; //Each half the size of the one before, levels[0] is half the source
+    QSize sourceSize;
+    bool built = false;
+    atomic<int> generation{0}; //Bumped by every build() and cancel(), older builds throw their levels away
+    QThreadPool buildPool; //One build at a time, the halving itself is spread over the global pool
+    void buildLevels(const QImage &source, bool mirrored, int generation);
+    friend class DisplayPyramidTask;
+public:
+    static const int minLevelSize = 128; //Halving stops once the longer side is this short
+    static const int bandRows = 32; //Rows of a level each thread halves at a time
+    explicit DisplayPyramid(QObject *parent = nullptr);
+    ~DisplayPyramid();
+    DisplayPyramid(const DisplayPyramid &) = delete;
+    DisplayPyramid &operator=(const DisplayPyramid &) = delete;
+    void build(const QImage &image, bool mirrored = false);
+    void cancel();
+    void waitForDone();
+    bool isReady();
+    QSize getSourceSize();
+    int levelCount();
+    QImage levelFor(const QSize &size);
+    static QImage halve(const QImage &image, bool mirrored = false, QThreadPool *pool = QThreadPool::globalInstance());
+signals:
+    void levelsReady();
+};
+
+#endif // DISPLAYPYRAMID_H
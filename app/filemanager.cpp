@@ -8,9 +8,160 @@
 //               includes a moderate level of error detection and exception
 //               handling. It is tailored to fit the use of the project based
 //               on the implementation of the accessors.
+//
+//               Uncompressed binary PGM/PPM and BMP files skip QImage's
+//               decoders and encoders entirely. Inputs are memory-mapped and
+//               the image wraps the mapped scanlines without copying them.
+//               createRectImage() sizes the output file up front and maps it,
+//               so the rectifier writes its rows straight into the file and
+//               save() has nothing left to do. PGM maps to Grayscale8, PPM to
+//               RGB888 and BMP to Grayscale8 (gray palette), BGR888 or RGB32.
+//               Anything else, palette BMPs included, goes through QImage.
+//               PNG output is written by PngEncoder, which deflates row
+//               groups in parallel. In memory rectified images come from the
+//               BufferPool, so a batch reuses the same few buffers.
 //============================================================================
 
 #include "filemanager.h"
+#include "bufferpool.h"
+#include "pngencoder.h"
+#include "tracer.h"
+#include <QFileInfo>
+#include <QImageWriter>
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstring>
+
+static const qint64 maxBmpSide = 1000000; //Wider or taller headers are taken to be corrupt
+
+static QString suffixOf(const string &filePath){
+    return QFileInfo(QString::fromStdString(filePath)).suffix().toLower();
+}
+
+static quint32 readLittleEndian(const uchar *data, int bytes){
+    quint32 value = 0;
+    for(int byte = bytes - 1; byte >= 0; byte--){
+        value = (value << 8) | data[byte];
+    }
+    return value;
+}
+
+static void writeLittleEndian(uchar *data, quint32 value, int bytes){
+    for(int byte = 0; byte < bytes; byte++){
+        data[byte] = static_cast<uchar>(value >> (byte * 8));
+    }
+}
+
+static bool parsePnm(const uchar *data, qint64 size, QImage::Format *format, int *width, int *height, qint64 *offset){
+    //Binary 8-bit PGM/PPM header: magic, width, height and maxval separated by whitespace or comments
+    if(size < 2 || data[0] != 'P' || (data[1] != '5' && data[1] != '6')){
+        return false;
+    }
+    *format = data[1] == '5' ? QImage::Format_Grayscale8 : QImage::Format_RGB888;
+    qint64 position = 2;
+    long values[3];
+    for(int value = 0; value < 3; value++){
+        while(position < size && (isspace(data[position]) || data[position] == '#')){
+            if(data[position] == '#'){
+                while(position < size && data[position] != '\n'){
+                    position++;
+                }
+            } else {
+                position++;
+            }
+        }
+        if(position >= size || !isdigit(data[position])){
+            return false;
+        }
+        values[value] = 0;
+        while(position < size && isdigit(data[position]) && values[value] < 1000000){
+            values[value] = values[value] * 10 + (data[position++] - '0');
+        }
+    }
+    if(position >= size || !isspace(data[position]) || values[0] < 1 || values[1] < 1 || values[2] != 255){
+        return false;
+    }
+    *width = static_cast<int>(values[0]);
+    *height = static_cast<int>(values[1]);
+    *offset = position + 1; //Exactly one whitespace byte before the samples
+    return true;
+}
+
+static bool parseBmp(const uchar *data, qint64 size, QImage::Format *format, int *width, int *height, int *bytesPerLine, qint64 *offset, bool *bottomUp){
+    //Uncompressed 8-bit gray, 24-bit and 32-bit BMPs are stored in a layout QImage can wrap
+    if(size < 54 || data[0] != 'B' || data[1] != 'M'){
+        return false;
+    }
+    //Everything is checked in 64 bits, a corrupt header must not wrap into a layout that passes the size check
+    qint64 headerSize = readLittleEndian(data + 14, 4);
+    qint64 storedWidth = static_cast<qint32>(readLittleEndian(data + 18, 4));
+    qint64 storedHeight = static_cast<qint32>(readLittleEndian(data + 22, 4));
+    int bitCount = readLittleEndian(data + 28, 2);
+    quint32 compression = readLittleEndian(data + 30, 4);
+    qint64 absoluteHeight = storedHeight < 0 ? -storedHeight : storedHeight;
+    if(headerSize < 40 || compression != 0 || storedWidth < 1 || storedWidth > maxBmpSide || absoluteHeight < 1 || absoluteHeight > maxBmpSide){
+        return false;
+    }
+    *offset = readLittleEndian(data + 10, 4);
+    *width = static_cast<int>(storedWidth);
+    *height = static_cast<int>(absoluteHeight);
+    *bottomUp = storedHeight > 0;
+    qint64 pixelsStart = 14 + headerSize; //Where the pixels may start at the earliest, past the headers and palette
+    if(bitCount == 8){
+        //Only a plain gray ramp palette can be treated as Grayscale8
+        quint32 colors = readLittleEndian(data + 46, 4);
+        pixelsStart += 1024;
+        if((colors != 0 && colors != 256) || pixelsStart > size){
+            return false;
+        }
+        const uchar *palette = data + 14 + headerSize;
+        for(int index = 0; index < 256; index++){
+            if(palette[index * 4] != index || palette[index * 4 + 1] != index || palette[index * 4 + 2] != index){
+                return false;
+            }
+        }
+        *format = QImage::Format_Grayscale8;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    } else if(bitCount == 24){
+        *format = QImage::Format_BGR888;
+#endif
+    } else if(bitCount == 32){
+        *format = QImage::Format_RGB32;
+    } else {
+        return false;
+    }
+    qint64 rowBytes = (storedWidth * bitCount + 31) / 32 * 4;
+    if(*offset < pixelsStart || rowBytes <= 0 || rowBytes > INT_MAX){
+        return false;
+    }
+    *bytesPerLine = static_cast<int>(rowBytes);
+    return true;
+}
+
+static bool rawFileFormat(const QString &suffix, QImage::Format format, QImage::Format *fileFormat){
+    //Pixel format a raw file of this type stores an image of the given format in
+    if(suffix == "pgm"){
+        *fileFormat = QImage::Format_Grayscale8;
+    } else if(suffix == "ppm" || suffix == "pnm"){
+        *fileFormat = format == QImage::Format_Grayscale8 && suffix == "pnm" ? QImage::Format_Grayscale8 : QImage::Format_RGB888;
+    } else if(suffix == "bmp"){
+        if(format == QImage::Format_Grayscale8){
+            *fileFormat = QImage::Format_Grayscale8;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+        } else if(format == QImage::Format_BGR888){
+            *fileFormat = QImage::Format_BGR888;
+#endif
+        } else if(format == QImage::Format_ARGB32 || format == QImage::Format_ARGB32_Premultiplied){
+            *fileFormat = format; //Same bytes as RGB32, the alpha byte is simply not read back
+        } else {
+            *fileFormat = QImage::Format_RGB32;
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
 
 void FileManager::setInputFileName(const string *filePath){
     //Set input bare file name with error handling
@@ -46,6 +197,18 @@ FileManager::FileManager(){
 
 }
 
+FileManager::~FileManager(){
+    //The images may point into the mappings, drop them before the files close
+    this->image = QImage();
+    this->closeOutput();
+}
+
+bool FileManager::isRawFormat(const string &filePath){
+    //Formats read and written through memory mapping
+    QString suffix = suffixOf(filePath);
+    return suffix == "pgm" || suffix == "ppm" || suffix == "pnm" || suffix == "bmp";
+}
+
 void FileManager::setInputFilePath(const string *filePath){
     //Set input file path with error handling
     this->inputFilePath = *filePath;
@@ -67,18 +230,184 @@ void FileManager::setOutputFilePath(const string *filePath){
 }
 
 void FileManager::open(){
-    //Set Qimage to open file based on inputFilePath with error handling
+    TraceScope trace("FileManager::open");
+    //Release any previous mapping before the image is replaced
+    this->image = QImage();
+    this->inputFile.close();
+    this->bottomUp = false;
+
+    //Map raw files, and let QImage decode everything else with error handling
+    if(isRawFormat(this->inputFilePath) && this->openMapped()){
+        return;
+    }
     this->image = QImage(QString::fromStdString(this->inputFilePath));
     if(this->image.isNull()){
         throw string("The file was unable to be opened");
     }
 }
 
+bool FileManager::openMapped(){
+    //Wrap the pixels of a raw file in place, false when the layout is not one that can be wrapped
+    this->inputFile.setFileName(QString::fromStdString(this->inputFilePath));
+    if(!this->inputFile.open(QIODevice::ReadOnly)){
+        throw string("The file was unable to be opened");
+    }
+    qint64 size = this->inputFile.size();
+    const uchar *data = size > 0 ? this->inputFile.map(0, size) : nullptr;
+    QImage::Format format;
+    int width, height, bytesPerLine;
+    qint64 offset;
+    bool bottomUp = false;
+    bool parsed = false;
+    if(data != nullptr){
+        if(suffixOf(this->inputFilePath) == "bmp"){
+            parsed = parseBmp(data, size, &format, &width, &height, &bytesPerLine, &offset, &bottomUp);
+        } else {
+            parsed = parsePnm(data, size, &format, &width, &height, &offset);
+            bytesPerLine = parsed ? width * (format == QImage::Format_Grayscale8 ? 1 : 3) : 0;
+        }
+    }
+    if(!parsed || offset + static_cast<qint64>(bytesPerLine) * height > size){
+        this->inputFile.close();
+        return false;
+    }
+    this->image = QImage(data + offset, width, height, bytesPerLine, format);
+    this->bottomUp = bottomUp;
+    return true;
+}
+
+uchar *FileManager::createMapped(QFile *file, const string &filePath, QImage::Format format, int width, int height, bool bottomUp, int *bytesPerLine){
+    //Create a raw file of its final size, write the header, and hand back the mapped pixel rows
+    QString suffix = suffixOf(filePath);
+    QByteArray header;
+    if(suffix == "bmp"){
+        int bitCount = format == QImage::Format_Grayscale8 ? 8 : (format == QImage::Format_RGB32 || format == QImage::Format_ARGB32 || format == QImage::Format_ARGB32_Premultiplied ? 32 : 24);
+        int paletteSize = bitCount == 8 ? 1024 : 0;
+        *bytesPerLine = (width * bitCount + 31) / 32 * 4;
+        header = QByteArray(54 + paletteSize, 0);
+        uchar *bytes = reinterpret_cast<uchar *>(header.data());
+        bytes[0] = 'B';
+        bytes[1] = 'M';
+        writeLittleEndian(bytes + 2, static_cast<quint32>(header.size() + static_cast<qint64>(*bytesPerLine) * height), 4);
+        writeLittleEndian(bytes + 10, header.size(), 4);
+        writeLittleEndian(bytes + 14, 40, 4);
+        writeLittleEndian(bytes + 18, width, 4);
+        writeLittleEndian(bytes + 22, static_cast<quint32>(bottomUp ? height : -height), 4);
+        writeLittleEndian(bytes + 26, 1, 2);
+        writeLittleEndian(bytes + 28, bitCount, 2);
+        writeLittleEndian(bytes + 34, static_cast<quint32>(static_cast<qint64>(*bytesPerLine) * height), 4);
+        writeLittleEndian(bytes + 38, 2835, 4); //72 DPI
+        writeLittleEndian(bytes + 42, 2835, 4);
+        writeLittleEndian(bytes + 46, bitCount == 8 ? 256 : 0, 4);
+        for(int index = 0; index < paletteSize / 4; index++){
+            bytes[54 + index * 4] = bytes[55 + index * 4] = bytes[56 + index * 4] = static_cast<uchar>(index);
+        }
+    } else {
+        bool grayscale = format == QImage::Format_Grayscale8;
+        *bytesPerLine = width * (grayscale ? 1 : 3);
+        header = QByteArray(grayscale ? "P5" : "P6") + "\n" + QByteArray::number(width) + " " + QByteArray::number(height) + "\n255\n";
+    }
+    qint64 size = header.size() + static_cast<qint64>(*bytesPerLine) * height;
+    file->setFileName(QString::fromStdString(filePath));
+    if(!file->open(QIODevice::ReadWrite | QIODevice::Truncate) || !file->resize(size)){
+        file->close();
+        throw string("The file was unable to be saved");
+    }
+    uchar *data = file->map(0, size);
+    if(data == nullptr){
+        file->close();
+        throw string("The file was unable to be saved");
+    }
+    memcpy(data, header.constData(), header.size());
+    return data + header.size();
+}
+
+void FileManager::closeOutput(){
+    //Unmapping writes the rows back, the image must not outlive it
+    this->rectifiedImage = QImage();
+    this->outputFile.close();
+    this->mappedOutputPath = "";
+    this->mappedOutputPixels = nullptr;
+}
+
+void FileManager::releaseInput(const string &filePath){
+    //Writing over the mapped input would pull the pixels out from under the image, so take a private copy first
+    if(this->inputFile.isOpen() && QFileInfo(this->inputFile.fileName()).absoluteFilePath() == QFileInfo(QString::fromStdString(filePath)).absoluteFilePath()){
+        this->image = this->image.copy();
+        this->inputFile.close();
+    }
+}
+
+QImage *FileManager::createRectImage(int width, int height, QImage::Format format){
+    //Rectify straight into the output file when it is raw and can hold this format as is, otherwise into memory
+    this->closeOutput();
+    this->releaseInput(this->outputFilePath);
+    QImage::Format fileFormat;
+    QString suffix = suffixOf(this->outputFilePath);
+    bool rowOrderMatches = suffix == "bmp" || !this->bottomUp;
+    if(isRawFormat(this->outputFilePath) && rawFileFormat(suffix, format, &fileFormat) && fileFormat == format && rowOrderMatches){
+        int bytesPerLine;
+        uchar *pixels = createMapped(&this->outputFile, this->outputFilePath, format, width, height, this->bottomUp, &bytesPerLine);
+        this->rectifiedImage = QImage(pixels, width, height, bytesPerLine, format);
+        this->mappedOutputPath = this->outputFilePath;
+        this->mappedOutputPixels = pixels;
+    } else {
+        this->rectifiedImage = BufferPool::instance().acquireImage(width, height, format);
+    }
+    return &this->rectifiedImage;
+}
+
+bool FileManager::prepareSave(){
+    //Rows rectified into a mapping of this very file are already in place
+    if(this->mappedOutputPixels != nullptr && this->mappedOutputPath == this->outputFilePath && this->rectifiedImage.constBits() == this->mappedOutputPixels){
+        return false;
+    }
+    this->releaseInput(this->outputFilePath);
+    return true;
+}
+
 void FileManager::save(){
-    //Save the image
-    bool returnStatus = rectifiedImage.save(QString::fromStdString(this->outputFilePath));
+    TraceScope trace("FileManager::save");
+    //Write the rectified image to the output path, unless it is already there
+    if(this->prepareSave()){
+        writeImage(this->rectifiedImage, this->outputFilePath, this->bottomUp, this->compressionLevel);
+    }
+}
+
+void FileManager::writeImage(const QImage &image, const string &filePath, bool bottomUp, int compressionLevel){
+    TraceScope trace("FileManager::writeImage");
+    //Only touches its arguments, so any thread may write an image it holds a copy of
+    //Raw formats are written through a mapping of their own
+    QString suffix = suffixOf(filePath);
+    QImage::Format fileFormat;
+    if(isRawFormat(filePath) && rawFileFormat(suffix, image.format(), &fileFormat)){
+        QImage converted = image.convertToFormat(fileFormat);
+        if(converted.isNull()){
+            throw string("The file was unable to be saved");
+        }
+        QFile file;
+        int bytesPerLine;
+        int height = converted.height();
+        bool fileBottomUp = bottomUp && suffix == "bmp";
+        uchar *pixels = createMapped(&file, filePath, fileFormat, converted.width(), height, fileBottomUp, &bytesPerLine);
+        for(int row = 0; row < height; row++){
+            //PGM/PPM are always top-down, so rows kept bottom-up are written in reverse
+            int sourceRow = bottomUp && !fileBottomUp ? height - 1 - row : row;
+            memcpy(pixels + static_cast<qint64>(row) * bytesPerLine, converted.constScanLine(sourceRow), min(bytesPerLine, static_cast<int>(converted.bytesPerLine())));
+        }
+        file.close();
+        return;
+    }
+
+    //PNG is deflated on the thread pool, any other format Qt knows goes through its own encoder
+    if(suffix == "png"){
+        PngEncoder::write(image, filePath, bottomUp, compressionLevel);
+        return;
+    }
+    QImageWriter writer(QString::fromStdString(filePath));
+    bool returnStatus = writer.write(bottomUp ? image.mirrored() : image);
     if(!returnStatus){
-        throw string("The file was unable to be saved");
+        throw string("The file was unable to be saved: ") + writer.errorString().toStdString();
     }
 }
 
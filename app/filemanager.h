@@ -3,12 +3,20 @@
 // Author      : TGYK
 // Date        : 12/14/2020
 // E-Mail      : tgyk@tgyk.net
-// Description : This is the class definition of FileManager
+// Description : This is the class definition of FileManager. Special note
+//               is that for raw PGM/PPM/BMP files the images point straight
+//               into memory-mapped files, so the manager owns the mappings
+//               and cannot be copied. Bottom-up BMPs are kept in file row
+//               order, isBottomUp() tells whether they need mirroring for
+//               display. save() encodes on the calling thread; for saving in
+//               the background, prepareSave() and writeImage() are split out
+//               so the encoding can run on an ImageWriter thread.
 //============================================================================
 
 #ifndef FILEMANAGER_H
 #define FILEMANAGER_H
 #include <iostream>
+#include <QFile>
 #include <QImage>
 #include <QString>
 
@@ -22,16 +30,37 @@ private:
     string outputFileName = "";
     QImage image;
     QImage rectifiedImage;
+    QFile inputFile; //Mapped raw input, open for as long as image points into it
+    QFile outputFile; //Mapped raw output, open for as long as rectifiedImage points into it
+    string mappedOutputPath = ""; //Output file rectifiedImage is mapped onto, if any
+    const uchar *mappedOutputPixels = nullptr;
+    bool bottomUp = false; //Rows are stored bottom row first, as in most BMPs
+    int compressionLevel = -1; //zlib level 0-9 for PNG output, -1 for the encoder's default
     void setInputFileName(const string *filePath);
     void setOutputFileName(const string *filePath);
+    bool openMapped();
+    void closeOutput();
+    void releaseInput(const string &filePath);
+    static uchar *createMapped(QFile *file, const string &filePath, QImage::Format format, int width, int height, bool bottomUp, int *bytesPerLine);
 public:
     FileManager();
+    ~FileManager();
+    FileManager(const FileManager &) = delete;
+    FileManager &operator=(const FileManager &) = delete;
+    static bool isRawFormat(const string &filePath);
     FileManager(const string *inputFilePath);
     FileManager(const string *inputFilePath, const string *outputFilePath);
     void setInputFilePath(const string *filePath);
     void setOutputFilePath(const string *filePath);
     void open();
     void save();
+    bool prepareSave();
+    static void writeImage(const QImage &image, const string &filePath, bool bottomUp, int compressionLevel = -1);
+    QImage *createRectImage(int width, int height, QImage::Format format);
+    bool isBottomUp() const {return this->bottomUp;}
+    void setBottomUp(bool bottomUp){this->bottomUp = bottomUp;}
+    int getCompressionLevel() const {return this->compressionLevel;}
+    void setCompressionLevel(int compressionLevel){this->compressionLevel = compressionLevel;}
     const string &getInputFileName() const;
     const string &getInputFilePath() const;
     const string &getOutputFileName() const;
@@ -0,0 +1,45 @@
+//============================================================================
+// Name        : idlethreads.cpp
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is responsible for splitting one piece of work over a
+//               pool that may already be busy. The calling thread always
+//               takes part, and helpers are only started on threads of the
+//               pool that are idle right now, so work split from inside a
+//               task of the same pool never waits on itself, and a busy
+//               pool simply leaves the caller to do more of it.
+//============================================================================
+
+#include "idlethreads.h"
+#include <QRunnable>
+#include <QSemaphore>
+#include <algorithm>
+
+class IdleThreadTask: public QRunnable{
+private:
+    function<void()> work;
+    QSemaphore *done;
+public:
+    IdleThreadTask(function<void()> work, QSemaphore *done): work(work), done(done){}
+    void run() override{
+        this->work();
+        this->done->release();
+    }
+};
+
+void runOnIdleThreads(QThreadPool *pool, int maxHelpers, const function<void()> &work){
+    //Runs work on the calling thread and on up to maxHelpers idle threads of pool, returns once every copy has finished
+    QSemaphore done;
+    int helpers = 0;
+    int wantedHelpers = pool == nullptr ? 0 : min(maxHelpers, pool->maxThreadCount());
+    for(; helpers < wantedHelpers; helpers++){
+        IdleThreadTask *task = new IdleThreadTask(work, &done);
+        if(!pool->tryStart(task)){
+            delete task;
+            break;
+        }
+    }
+    work();
+    done.acquire(helpers);
+}
@@ -0,0 +1,21 @@
+//============================================================================
+// Name        : idlethreads.h
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is the declaration of runOnIdleThreads(). Special note
+//               is that work is run by several threads at once, so it has to
+//               claim its pieces itself, typically from an atomic counter,
+//               and that the calling thread may end up doing all of them.
+//============================================================================
+
+#ifndef IDLETHREADS_H
+#define IDLETHREADS_H
+#include <QThreadPool>
+#include <functional>
+
+using namespace std;
+
+void runOnIdleThreads(QThreadPool *pool, int maxHelpers, const function<void()> &work);
+
+#endif // IDLETHREADS_H
@@ -0,0 +1,103 @@
+//============================================================================
+// Name        : imagewriter.cpp
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This class encodes and writes finished images in the
+//               background, so neither the GUI nor the rectifier waits on
+//               the PNG encoder. Each image is held as a QImage copy, which
+//               shares the pixels until somebody writes to them, so the
+//               caller must hand over an image nothing is still rendering
+//               into. A few images can be encoded side by side while the
+//               next one is rectified; beyond the capacity, enqueue() blocks
+//               and tryEnqueue() refuses.
+//============================================================================
+
+#include "imagewriter.h"
+#include <QElapsedTimer>
+#include <QRunnable>
+#include <QThread>
+#include <algorithm>
+#include "filemanager.h"
+
+class ImageWriterTask: public QRunnable{
+private:
+    ImageWriter *writer;
+    QImage image;
+    string filePath;
+    bool bottomUp;
+    int compressionLevel;
+public:
+    ImageWriterTask(ImageWriter *writer, const QImage &image, const string &filePath, bool bottomUp, int compressionLevel):
+        writer(writer), image(image), filePath(filePath), bottomUp(bottomUp), compressionLevel(compressionLevel){}
+    void run() override{
+        QElapsedTimer timer;
+        timer.start();
+        QString path = QString::fromStdString(this->filePath);
+        try {
+            FileManager::writeImage(this->image, this->filePath, this->bottomUp, this->compressionLevel);
+            this->image = QImage(); //Let go of the pixels before anyone is told the slot is free
+            emit this->writer->saved(path, timer.elapsed());
+        }  catch (string &e) {
+            this->image = QImage();
+            emit this->writer->saveFailed(path, QString::fromStdString(e));
+        }
+        this->writer->finish();
+    }
+};
+
+ImageWriter::ImageWriter(int capacity, QObject *parent): QObject(parent){
+    //Encoding is mostly zlib, a couple of threads keep up with the rectifier without starving it
+    this->capacity = max(1, capacity);
+    this->pool.setMaxThreadCount(min(this->capacity, max(1, QThread::idealThreadCount() / 2)));
+}
+
+ImageWriter::~ImageWriter(){
+    //Every queued image is written before the writer goes away
+    this->waitForDone();
+}
+
+int ImageWriter::pendingCount(){
+    QMutexLocker locker(&this->mutex);
+    return this->pending;
+}
+
+void ImageWriter::start(const QImage &image, const string &filePath, bool bottomUp, int compressionLevel){
+    //Caller has already claimed the slot
+    this->pool.start(new ImageWriterTask(this, image, filePath, bottomUp, compressionLevel));
+}
+
+void ImageWriter::finish(){
+    QMutexLocker locker(&this->mutex);
+    this->pending--;
+    this->slotFreed.wakeOne();
+}
+
+void ImageWriter::enqueue(const QImage &image, const string &filePath, bool bottomUp, int compressionLevel){
+    //Wait for a free slot, then hand the image to the pool
+    {
+        QMutexLocker locker(&this->mutex);
+        while(this->pending >= this->capacity){
+            this->slotFreed.wait(&this->mutex);
+        }
+        this->pending++;
+    }
+    this->start(image, filePath, bottomUp, compressionLevel);
+}
+
+bool ImageWriter::tryEnqueue(const QImage &image, const string &filePath, bool bottomUp, int compressionLevel){
+    //Same as enqueue(), but a full queue is reported instead of waited out
+    {
+        QMutexLocker locker(&this->mutex);
+        if(this->pending >= this->capacity){
+            return false;
+        }
+        this->pending++;
+    }
+    this->start(image, filePath, bottomUp, compressionLevel);
+    return true;
+}
+
+void ImageWriter::waitForDone(){
+    this->pool.waitForDone();
+}
@@ -0,0 +1,54 @@
+//============================================================================
+// Name        : imagewriter.h
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is the class definition of ImageWriter. Special note is
+//               the bounded queue: at most getCapacity() images are waiting
+//               or being encoded at once, and enqueue() blocks until one of
+//               them is done when it is full. The signals are emitted from
+//               the writer threads, so receivers living on another thread
+//               get them queued.
+//============================================================================
+
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <string>
+
+using namespace std;
+
+class ImageWriter: public QObject{
+Q_OBJECT
+
+private:
+    int capacity;
+    int pending = 0; //Images queued or being encoded
+    QMutex mutex;
+    QWaitCondition slotFreed;
+    QThreadPool pool; //Own pool, so encoding never takes threads from the rectifier
+    void start(const QImage &image, const string &filePath, bool bottomUp, int compressionLevel);
+    void finish();
+    friend class ImageWriterTask;
+public:
+    static const int defaultCapacity = 4;
+    explicit ImageWriter(int capacity = defaultCapacity, QObject *parent = nullptr);
+    ~ImageWriter();
+    ImageWriter(const ImageWriter &) = delete;
+    ImageWriter &operator=(const ImageWriter &) = delete;
+    int getCapacity() const {return this->capacity;}
+    int pendingCount();
+    void enqueue(const QImage &image, const string &filePath, bool bottomUp = false, int compressionLevel = -1);
+    bool tryEnqueue(const QImage &image, const string &filePath, bool bottomUp = false, int compressionLevel = -1);
+    void waitForDone();
+signals:
+    void saved(QString filePath, qint64 milliseconds);
+    void saveFailed(QString filePath, QString message);
+};
+
+#endif // IMAGEWRITER_H
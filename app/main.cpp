@@ -13,8 +13,6 @@
 
 using namespace std;
 
-QMutex RectifyThread::mutex;
-
 int main(int argc, char *argv[]){
 
     QApplication a(argc, argv);
@@ -7,11 +7,29 @@
 //               presented to the user. It handles button and slider inputs,
 //               as well as updating various graphic displays based on signals
 //               from other classes. This class also handles the preparation
-//               of other classes and overall program flow.
+//               of other classes and overall program flow. While a slider is
+//               dragged only a downscaled proxy is rectified and shown, the
+//               full resolution render starts once the slider is released
+//               or Rectify is clicked. The filter box switches between
+//               linear, cubic and Lanczos-3 resampling. Saving runs in the
+//               background at the zlib level picked in the compression box.
+//               Full size images are displayed from a pyramid of downscaled
+//               levels built in the background, so showing them again after
+//               a resize only scales the level nearest to the view's size.
+//               While a render runs, each tick of the progress timer samples
+//               the rows finished since the last one into a view sized
+//               canvas, so the result fills in as the workers go. Worker
+//               settings are loaded on startup and saved whenever the Workers
+//               menu changes them.
 //============================================================================
 
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include <QFileInfo>
+#include <QInputDialog>
+#include <QSettings>
+
+const int MainWindow::compressionLevels[] = {1, 6, 9};
 
 MainWindow::MainWindow(QWidget *parent): QMainWindow(parent), ui(new Ui::MainWindow){
     //Setup ui
@@ -32,6 +50,7 @@ MainWindow::MainWindow(QWidget *parent): QMainWindow(parent), ui(new Ui::MainWin
     ui->altitudeSlider->setDisabled(true);
     ui->swathSlider->setDisabled(true);
     ui->sliderResetButton->setDisabled(true);
+    ui->filterBox->setDisabled(true);
     ui->saveButton->setDisabled(true);
     ui->rectifyButton->setDisabled(true);
 
@@ -41,9 +60,47 @@ MainWindow::MainWindow(QWidget *parent): QMainWindow(parent), ui(new Ui::MainWin
     //Connect slot responsible for updating progressbar to signal from threadmanager
     QObject::connect(&threadManager, SIGNAL(progressMade(int)), this, SLOT(updateProgress(int)), Qt::DirectConnection);
     QObject::connect(&threadManager, SIGNAL(processingDone()), this, SLOT(updateImage()));
+    QObject::connect(&threadManager, SIGNAL(rowsRectified()), this, SLOT(showRectifiedRows()));
+
+    //Slider moves only render the preview, debounced so a fast drag renders once per interval
+    this->previewTimer.setSingleShot(true);
+    this->previewTimer.setInterval(previewDebounceMs);
+    QObject::connect(&previewTimer, SIGNAL(timeout()), this, SLOT(updatePreview()));
+    QObject::connect(ui->radiusSlider, SIGNAL(sliderReleased()), this, SLOT(sliderReleased()));
+    QObject::connect(ui->altitudeSlider, SIGNAL(sliderReleased()), this, SLOT(sliderReleased()));
+    QObject::connect(ui->swathSlider, SIGNAL(sliderReleased()), this, SLOT(sliderReleased()));
+    QObject::connect(ui->filterBox, SIGNAL(currentIndexChanged(int)), this, SLOT(filterChanged(int)));
+
+    //Saves finish on the writer's threads, report them from here
+    this->fileManager.setCompressionLevel(compressionLevels[ui->compressionBox->currentIndex()]);
+    QObject::connect(ui->compressionBox, SIGNAL(currentIndexChanged(int)), this, SLOT(compressionChanged(int)));
+    QObject::connect(&imageWriter, SIGNAL(saved(QString,qint64)), this, SLOT(imageSaved(QString,qint64)));
+    QObject::connect(&imageWriter, SIGNAL(saveFailed(QString,QString)), this, SLOT(imageSaveFailed(QString,QString)));
+
+    //Pyramid levels are built off the GUI thread, redraw once they are in
+    QObject::connect(&originalPyramid, SIGNAL(levelsReady()), this, SLOT(refreshImage()));
+    QObject::connect(&rectifiedPyramid, SIGNAL(levelsReady()), this, SLOT(refreshImage()));
+
+    //Stage timings are only recorded while the menu says so
+    QObject::connect(ui->recordTraceAction, SIGNAL(toggled(bool)), this, SLOT(recordTraceToggled(bool)));
+    QObject::connect(ui->showTraceAction, SIGNAL(triggered()), this, SLOT(showTraceClicked()));
+    QObject::connect(ui->saveTraceAction, SIGNAL(triggered()), this, SLOT(saveTraceClicked()));
+    QObject::connect(ui->clearTraceAction, SIGNAL(triggered()), this, SLOT(clearTraceClicked()));
+
+    //The affinity entries pick one of three
+    this->affinityGroup = new QActionGroup(this);
+    this->affinityGroup->addAction(ui->noAffinityAction);
+    this->affinityGroup->addAction(ui->compactAffinityAction);
+    this->affinityGroup->addAction(ui->spreadAffinityAction);
+    QObject::connect(affinityGroup, SIGNAL(triggered(QAction*)), this, SLOT(affinityTriggered(QAction*)));
+    QObject::connect(ui->threadsAction, SIGNAL(triggered()), this, SLOT(threadsClicked()));
+    QObject::connect(ui->cpusAction, SIGNAL(triggered()), this, SLOT(cpusClicked()));
 
     //Print in logbox about startup
     ui->logBox->append("meteor_rectifyGUI V" + QString::fromStdString(this->version) + " successfully started.");
+
+    //Worker threads as they were last configured, here or for the batch tool
+    this->applyWorkerConfig(WorkerConfig::load(QSettings("TGYK", "meteor_rectify")));
     ui->logBox->append("Please open an image");
 }
 
@@ -60,33 +117,27 @@ void MainWindow::resetClicked(){
     ui->swathSlider->setValue(this->correctionFactor.getDefaultSatelliteSwath());
 
     //Update class vars in CorrectionFactor
-    this->correctionFactor.setEarthRadius(ui->radiusSlider->value());
-    this->correctionFactor.setSatelliteAltitude(ui->altitudeSlider->value());
-    this->correctionFactor.setSatelliteSwath(ui->swathSlider->value());
-
-    //Prepare new threads based on new correction factor.
-    threadManager.setCorrectionFactorVector(correctionFactor.getVector());
-    threadManager.setRectifiedWidth(correctionFactor.getRectifiedWidth());
+    this->correctionFactor.setParameters(ui->radiusSlider->value(), ui->altitudeSlider->value(), ui->swathSlider->value());
+    this->previewTimer.stop();
 
     //Reset image alignment
     ui->imageView->setAlignment(Qt::AlignHCenter);
 
-    //Reset image
-    ui->imageView->setPixmap(QPixmap::fromImage(*fileManager.getImagePtr()).QPixmap::scaledToHeight(ui->imageView->height()));
+    //Reset image, its levels were built when it was opened
+    this->showPyramid(&this->originalPyramid, fileManager.getImagePtr());
 
     //Reset progress bar
     ui->rectifyProgress->setValue(0);
 
     //Print to logbox about the event
     ui->logBox->append("Sliders reset to default values");
-
-    //Re-prepare threads
-    threadManager.prepare();
 }
 
 void MainWindow::rectifyClicked(){
-    //Call threadManager to start rectification
-    threadManager.run();
+    //Call threadManager to start rectification, the preview fills in for the rows not done yet
+    this->previewTimer.stop();
+    this->updatePreview();
+    this->startRendering();
 
     //Print to logbox about the event
     ui->logBox->append("Rectifying image...");
@@ -95,16 +146,79 @@ void MainWindow::rectifyClicked(){
     ui->saveButton->setDisabled(false);
 }
 
+void MainWindow::startRendering(){
+    //Preparing supersedes a render still in flight, so only the latest parameters cost a full pass
+    this->threadManager.setResampleMap(this->correctionFactor.getResampleMap());
+    this->threadManager.prepare();
+    this->startProgressiveImage();
+    this->threadManager.run();
+}
+
+void MainWindow::startProgressiveImage(){
+    //Start from the preview scaled to the view, finished rows are drawn over it as they come in
+    const QImage *rectImage = fileManager.getRectImagePtr();
+    QSize canvasSize = rectImage->size().scaled(ui->imageView->size(), Qt::KeepAspectRatio);
+    if(canvasSize.isEmpty()){
+        this->progressiveImage = QImage();
+        return;
+    }
+    const QImage *previewImage = this->previewRenderer.getPreviewImagePtr();
+    if(previewImage->isNull()){
+        this->progressiveImage = QImage(canvasSize, QImage::Format_RGB32);
+        this->progressiveImage.fill(Qt::black);
+    } else {
+        this->progressiveImage = previewImage->scaled(canvasSize).convertToFormat(QImage::Format_RGB32);
+    }
+    this->showImage(&this->progressiveImage);
+}
+
+void MainWindow::showRectifiedRows(){
+    //Point sample only the canvas rows whose source row has just been finished, never copying the image the workers write into
+    vector<pair<int, int>> ranges = this->threadManager.takeRectifiedRows();
+    if(this->progressiveImage.isNull() || ranges.empty()){
+        return;
+    }
+    TraceScope trace("MainWindow::showRectifiedRows");
+    const QImage *rectImage = fileManager.getRectImagePtr();
+    qint64 width = rectImage->width();
+    qint64 height = rectImage->height();
+    int canvasWidth = this->progressiveImage.width();
+    int canvasHeight = this->progressiveImage.height();
+    vector<int> columns(canvasWidth);
+    for(int column = 0; column < canvasWidth; column++){
+        columns[column] = static_cast<int>((2 * column + 1) * width / (2 * canvasWidth));
+    }
+    for(const pair<int, int> &range : ranges){
+        int firstRow = static_cast<int>(range.first * static_cast<qint64>(canvasHeight) / height);
+        int endRow = min(canvasHeight, static_cast<int>((range.second * static_cast<qint64>(canvasHeight) + height - 1) / height));
+        for(int row = firstRow; row < endRow; row++){
+            int sourceRow = static_cast<int>((2 * row + 1) * height / (2 * canvasHeight));
+            if(sourceRow < range.first || sourceRow >= range.second){
+                continue;
+            }
+            QRgb *line = reinterpret_cast<QRgb *>(this->progressiveImage.scanLine(row));
+            for(int column = 0; column < canvasWidth; column++){
+                line[column] = rectImage->pixel(columns[column], sourceRow) | 0xff000000;
+            }
+        }
+    }
+
+    //Only redraw while the canvas is what the view shows, a slider drag puts the preview there instead
+    if(this->shownImage == &this->progressiveImage){
+        this->refreshImage();
+    }
+}
+
 void MainWindow::openClicked(){
     QString filePath;
     //If lineEdit is empty, open file dialoge to current directory
     //Otherwise, open to string
     if(ui->openLineEdit->text() == "") {
         filePath = QFileDialog::getOpenFileName(this,
-            tr("Open Image"), "", tr("Image Files (*.png)"));
+            tr("Open Image"), "", tr("Image Files (*.png *.pgm *.ppm *.pnm *.bmp)"));
     } else {
         filePath = QFileDialog::getOpenFileName(this,
-            tr("Open Image"), ui->openLineEdit->text(), tr("Image Files (*.png)"));
+            tr("Open Image"), ui->openLineEdit->text(), tr("Image Files (*.png *.pgm *.ppm *.pnm *.bmp)"));
     }
 
     //Verify we got something back from the file dialog
@@ -116,7 +230,7 @@ void MainWindow::openClicked(){
 
     //Set some working strings
     string inputFilePath = filePath.toStdString();
-    string outputFilePath = inputFilePath.substr(0, inputFilePath.length() - 4) + "-rectified.png";
+    string outputFilePath = inputFilePath.substr(0, inputFilePath.length() - 4) + "-rectified" + inputFilePath.substr(inputFilePath.length() - 4); //Raw inputs default to a raw output
 
     //Update the UI to reflect these strings
     ui->openLineEdit->setText(filePath);
@@ -140,6 +254,13 @@ void MainWindow::openClicked(){
         return;
     }
     try {
+        //Nothing may still be reading the old image when it is replaced
+        threadManager.cancel();
+        this->shownPyramid = nullptr;
+        this->shownImage = nullptr;
+        this->progressiveImage = QImage();
+        this->originalPyramid.cancel();
+        this->rectifiedPyramid.cancel();
         fileManager.open();
     }  catch (exception &e) {
         QMessageBox msgBox;
@@ -154,8 +275,13 @@ void MainWindow::openClicked(){
     //If the opening is successful, update the CorrectionFactor object to recalculate the factor array
     this->correctionFactor.setImageWidth(fileManager.getImagePtr()->width());
 
-    //Display the unrectified image
-    ui->imageView->setPixmap(QPixmap::fromImage(*fileManager.getImagePtr()).QPixmap::scaledToHeight(ui->imageView->height()));
+    //Keep a small copy of the image for the live preview
+    this->previewRenderer.setSource(fileManager.getImagePtr());
+
+    //Display the unrectified image, the proxy stands in until the pyramid is built
+    this->showImage(this->previewRenderer.getProxyImagePtr());
+    this->originalPyramid.build(*fileManager.getImagePtr(), fileManager.isBottomUp());
+    this->showPyramid(&this->originalPyramid, fileManager.getImagePtr());
 
     //Reset progress bar
     ui->rectifyProgress->setValue(0);
@@ -163,24 +289,20 @@ void MainWindow::openClicked(){
     //Set threadmanager variables.. Likely a better way to do this.
     threadManager.setOriginalImage(fileManager.getImagePtr());
     threadManager.setRectImage(fileManager.getRectImagePtr());
-    threadManager.setCorrectionFactorVector(correctionFactor.getVector());
-    threadManager.setRectifiedWidth(correctionFactor.getRectifiedWidth());
-
-    //Call threadmanager to setup threads
-    threadManager.prepare();
 
     //Enable ui elements after image is opened
     ui->radiusSlider->setDisabled(false);
     ui->altitudeSlider->setDisabled(false);
     ui->swathSlider->setDisabled(false);
     ui->sliderResetButton->setDisabled(false);
+    ui->filterBox->setDisabled(false);
     ui->rectifyButton->setDisabled(false);
 }
 
 void MainWindow::saveClicked(){
     //Get output path from fileDialog
     QString outputFilePath = QFileDialog::getSaveFileName(this,
-        tr("Save"), ui->saveLineEdit->text(), tr("Image Files (*.png)"));
+        tr("Save"), ui->saveLineEdit->text(), tr("Image Files (*.png *.pgm *.ppm *.pnm *.bmp)"));
 
     //Check for blank string
     if(outputFilePath.isNull()){
@@ -202,30 +324,162 @@ void MainWindow::saveClicked(){
         return;
     }
 
-    //Save the file
-    try {
-        fileManager.save();
-    }  catch (exception &e) {
-        QMessageBox msgBox;
-        msgBox.setText(QString().fromStdString(e.what()));
-        msgBox.exec();
+    //Rows still being rectified would be torn, or copied out from under the workers
+    if(this->threadManager.isRunning()){
+        ui->logBox->append("Image is still being rectified, save again once it is done");
+        return;
+    }
+
+    //Saving over the opened file unmaps it, so the original's pyramid must be done reading it first
+    this->originalPyramid.waitForDone();
+
+    //Queue the file, the writer holds its own reference to the pixels so the next render can start right away
+    if(!fileManager.prepareSave()){
+        ui->logBox->append("Image " + QString::fromStdString(fileManager.getOutputFileName()) + " saved.");
+        return;
+    }
+    if(!this->imageWriter.tryEnqueue(*fileManager.getRectImagePtr(), fileManager.getOutputFilePath(), fileManager.isBottomUp(), fileManager.getCompressionLevel())){
+        ui->logBox->append("Still writing " + QString::number(this->imageWriter.getCapacity()) + " images, try again in a moment");
         return;
     }
-    ui->logBox->append("Image " + QString::fromStdString(fileManager.getOutputFileName()) + " saved.");
+    ui->logBox->append("Saving " + QString::fromStdString(fileManager.getOutputFileName()) + "...");
 }
 
 void MainWindow::updateSlider(){
-    //Update class vars in CorrectionFactor
-    this->correctionFactor.setEarthRadius(ui->radiusSlider->value());
-    this->correctionFactor.setSatelliteAltitude(ui->altitudeSlider->value());
-    this->correctionFactor.setSatelliteSwath(ui->swathSlider->value());
+    //Update class vars in CorrectionFactor, the table itself is only fetched when a render needs it
+    this->correctionFactor.setParameters(ui->radiusSlider->value(), ui->altitudeSlider->value(), ui->swathSlider->value());
 
-    //Prepare new threads based on new correction factor.
-    threadManager.setCorrectionFactorVector(correctionFactor.getVector());
-    threadManager.setRectifiedWidth(correctionFactor.getRectifiedWidth());
-    this->threadManager.prepare();
+    //Render the preview once the slider has been still for a moment
+    this->previewTimer.start();
+}
+
+void MainWindow::updatePreview(){
+    //Rectify the proxy with the current slider values and show it straight away
+    this->showImage(this->previewRenderer.render(ui->radiusSlider->value(), ui->altitudeSlider->value(), ui->swathSlider->value()));
+}
+
+void MainWindow::sliderReleased(){
+    //Dragging stopped, render the full resolution image
+    this->previewTimer.stop();
+    this->updatePreview();
+    this->startRendering();
+    ui->saveButton->setDisabled(false);
+}
+
+void MainWindow::filterChanged(int index){
+    //Box entries are in the same order as ResampleFilter
+    ResampleFilter filter = static_cast<ResampleFilter>(index);
+    this->correctionFactor.setFilter(filter);
+    this->previewRenderer.setFilter(filter);
+    ui->logBox->append("Resampling filter set to " + ui->filterBox->currentText());
+
+    //Re-render the same way a slider release does
+    if(ui->rectifyButton->isEnabled()){
+        this->updatePreview();
+        this->startRendering();
+    }
+}
+
+void MainWindow::compressionChanged(int index){
+    //Only affects saves queued from now on
+    this->fileManager.setCompressionLevel(compressionLevels[index]);
+    ui->logBox->append("PNG compression set to " + ui->compressionBox->currentText());
 }
 
+void MainWindow::imageSaved(QString filePath, qint64 milliseconds){
+    ui->logBox->append("Image " + QFileInfo(filePath).fileName() + " saved in " + QString::number(milliseconds) + " ms.");
+}
+
+void MainWindow::imageSaveFailed(QString filePath, QString message){
+    ui->logBox->append("Saving " + QFileInfo(filePath).fileName() + " failed: " + message);
+}
+
+void MainWindow::recordTraceToggled(bool checked){
+    Tracer::instance().setEnabled(checked);
+    ui->logBox->append(checked ? "Recording stage timings" : "Stopped recording stage timings");
+}
+
+void MainWindow::showTraceClicked(){
+    ui->logBox->append(Tracer::instance().summary());
+}
+
+void MainWindow::saveTraceClicked(){
+    //Write everything recorded so far as Chrome trace JSON
+    QString tracePath = QFileDialog::getSaveFileName(this, tr("Save trace"), "trace.json", tr("Chrome trace (*.json)"));
+    if(tracePath.isNull()){
+        ui->logBox->append("No file selected for the trace");
+        return;
+    }
+    try {
+        Tracer::instance().writeChromeTrace(tracePath.toStdString());
+    }  catch (string &e) {
+        ui->logBox->append(QString::fromStdString(e));
+        return;
+    }
+    ui->logBox->append("Trace saved to " + QFileInfo(tracePath).fileName() + ", open it in chrome://tracing or Perfetto");
+    ui->logBox->append(Tracer::instance().summary());
+}
+
+void MainWindow::clearTraceClicked(){
+    Tracer::instance().clear();
+    ui->logBox->append("Stage timings cleared");
+}
+
+void MainWindow::threadsClicked(){
+    WorkerConfig config = this->threadManager.getWorkerConfig();
+    bool ok;
+    int threads = QInputDialog::getInt(this, "Threads", "Rectifying threads, 0 for one per usable CPU:", config.threads, 0, 1024, 1, &ok);
+    if(!ok){
+        return;
+    }
+    config.threads = threads;
+    this->applyWorkerConfig(config);
+}
+
+void MainWindow::cpusClicked(){
+    WorkerConfig config = this->threadManager.getWorkerConfig();
+    bool ok;
+    QString cpuList = QInputDialog::getText(this, "CPUs", "CPUs to rectify on, such as 0-7,16-23, empty for all:", QLineEdit::Normal, WorkerPool::formatCpuList(config.cpus), &ok);
+    if(!ok){
+        return;
+    }
+    if(!WorkerPool::parseCpuList(cpuList, &config.cpus)){
+        ui->logBox->append("Invalid CPU list " + cpuList);
+        return;
+    }
+    this->applyWorkerConfig(config);
+}
+
+void MainWindow::affinityTriggered(QAction *action){
+    WorkerConfig config = this->threadManager.getWorkerConfig();
+    if(action == ui->compactAffinityAction){
+        config.affinity = CpuAffinity::Compact;
+    } else if(action == ui->spreadAffinityAction){
+        config.affinity = CpuAffinity::Spread;
+    } else {
+        config.affinity = CpuAffinity::None;
+    }
+    this->applyWorkerConfig(config);
+}
+
+void MainWindow::applyWorkerConfig(const WorkerConfig &config){
+    //Reconfiguring cancels a render in flight, which starts over on the new threads
+    bool rendering = this->threadManager.isRunning();
+    this->threadManager.setWorkerConfig(config);
+    QSettings settings("TGYK", "meteor_rectify");
+    config.save(settings);
+
+    //Check the menu entry, which only matters when the settings picked it
+    QAction *affinityActions[] = {ui->noAffinityAction, ui->compactAffinityAction, ui->spreadAffinityAction};
+    affinityActions[static_cast<int>(config.affinity)]->setChecked(true);
+
+    //Print to logbox about the threads
+    QString cpus = config.cpus.empty() ? "any CPU" : "CPUs " + WorkerPool::formatCpuList(config.cpus);
+    ui->logBox->append(QString("Rectifying on %1 threads, %2 pinning, on %3").arg(this->threadManager.getThreadCount()).arg(config.affinity == CpuAffinity::None ? "no" : WorkerPool::affinityName(config.affinity)).arg(cpus));
+    if(rendering){
+        this->startRendering();
+    }
+}
 
 void MainWindow::updateProgress(int progress){
     //Update progressbar based on incoming progress by emitting a signal to the progress bar's slot..
@@ -238,15 +492,67 @@ void MainWindow::updateProgress(int progress){
 }
 
 void MainWindow::updateImage(){
-    //Change the imageview to the new image, scaling based on imageView constraints
-    if(QPixmap::fromImage(*fileManager.getRectImagePtr()).QPixmap::scaledToHeight(ui->imageView->height()).width() > ui->imageView->width()){
-        //Align image in center of frame to be viewed more friendly
-        ui->imageView->setAlignment(Qt::AlignVCenter);
-        ui->imageView->setPixmap(QPixmap::fromImage(*fileManager.getRectImagePtr()).QPixmap::scaledToWidth(ui->imageView->width()));
-    }else {
-        //Align image in center of frame to be viewed more friendly
-        ui->imageView->setAlignment(Qt::AlignHCenter);
-        ui->imageView->setPixmap(QPixmap::fromImage(*fileManager.getRectImagePtr()).QPixmap::scaledToHeight(ui->imageView->height()));
+    //The render is done, so the pyramid can share its pixels until the next one replaces the image
+    this->rectifiedPyramid.build(*fileManager.getRectImagePtr(), fileManager.isBottomUp());
+    this->showPyramid(&this->rectifiedPyramid, fileManager.getRectImagePtr());
+}
+
+QImage MainWindow::displayImage(const QImage *image) const{
+    //Bottom-up BMPs are kept in file row order, so everything shown for them is upside down until mirrored
+    return this->fileManager.isBottomUp() ? image->mirrored() : *image;
+}
+
+void MainWindow::showImage(const QImage *image){
+    //Small images such as the preview are shown as they are
+    this->shownPyramid = nullptr;
+    this->shownImage = image;
+    this->refreshImage();
+}
+
+void MainWindow::showPyramid(DisplayPyramid *pyramid, const QImage *image){
+    //Large images are shown through the nearest pyramid level, the current picture stays until the levels exist
+    this->shownPyramid = pyramid;
+    this->shownImage = image;
+    this->refreshImage();
+}
+
+void MainWindow::resizeEvent(QResizeEvent *event){
+    QMainWindow::resizeEvent(event);
+    this->refreshImage();
+}
+
+void MainWindow::refreshImage(){
+    TraceScope trace("MainWindow::showImage");
+    if(this->shownImage == nullptr || this->shownImage->isNull()){
+        return;
+    }
+    //Fit to the view's height, or to its width if that makes the image too wide
+    QSize viewSize = ui->imageView->size();
+    QSize imageSize = this->shownImage->size();
+    bool fitWidth = static_cast<qint64>(imageSize.width()) * viewSize.height() > static_cast<qint64>(viewSize.width()) * imageSize.height();
+    QSize fittedSize = imageSize.scaled(viewSize, Qt::KeepAspectRatio);
+    if(fittedSize.isEmpty()){
+        return;
+    }
+
+    QImage level;
+    if(this->shownPyramid != nullptr){
+        if(!this->shownPyramid->isReady()){
+            return;
+        }
+        level = this->shownPyramid->levelFor(fittedSize);
+        if(level.isNull() && this->shownPyramid == &this->rectifiedPyramid && this->threadManager.isRunning()){
+            //Copying the image the workers write into would detach it from under them
+            return;
+        }
     }
+    if(level.isNull()){
+        //No level is large enough, only happens for images at most twice the view's size
+        level = this->displayImage(this->shownImage);
+    }
+
+    //Align image in center of frame to be viewed more friendly
+    ui->imageView->setAlignment(fitWidth ? Qt::AlignVCenter : Qt::AlignHCenter);
+    ui->imageView->setPixmap(QPixmap::fromImage(level.scaled(fittedSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)));
 }
 
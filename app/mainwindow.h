@@ -4,18 +4,34 @@
 // Date        : 12/14/2020
 // E-Mail      : tgyk@tgyk.net
 // Description : This is the class definition of MainWindow. Special note is
-//               the slots used to capture GUI events and process them, and
+//               the slots used to capture GUI events and process them, the
+//               timer that debounces slider moves into preview renders, and
 //               the signal used to send the progress to the GUI progress bar
-//               for updating.
+//               for updating. Saving hands the image to an ImageWriter and
+//               returns, the outcome comes back through its signals. The
+//               Trace menu records stage timings and saves them for
+//               chrome://tracing. Opened and rectified images are shown
+//               through a DisplayPyramid each, whose levels arrive through
+//               levelsReady() once they are built in the background. While
+//               a render runs, its finished rows are sampled into a view
+//               sized canvas and shown as they come in. The Workers menu
+//               sizes and pins the rectifying threads, and is kept in the
+//               settings file the batch tool reads too.
 //============================================================================
 
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 #include <QMainWindow>
+#include <QActionGroup>
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QTimer>
 #include "filemanager.h"
+#include "imagewriter.h"
+#include "tracer.h"
 #include "correctionfactor.h"
+#include "displaypyramid.h"
+#include "previewrenderer.h"
 #include "threadmanager.h"
 
 
@@ -37,16 +53,49 @@ private slots:
     void openClicked();
     void saveClicked();
     void updateSlider();
+    void sliderReleased();
+    void updatePreview();
+    void filterChanged(int index);
+    void compressionChanged(int index);
+    void imageSaved(QString filePath, qint64 milliseconds);
+    void imageSaveFailed(QString filePath, QString message);
+    void recordTraceToggled(bool checked);
+    void showTraceClicked();
+    void saveTraceClicked();
+    void clearTraceClicked();
+    void threadsClicked();
+    void cpusClicked();
+    void affinityTriggered(QAction *action);
     void updateProgress(int progress);
     void updateImage();
+    void refreshImage();
+    void showRectifiedRows();
 
 private:
     int progress = 0;
+    static const int previewDebounceMs = 30;
+    static const int compressionLevels[]; //zlib level for each entry of the compression box
     string version = "1.0";
     Ui::MainWindow *ui;
     FileManager fileManager;
     CorrectionFactor correctionFactor;
     ThreadManager threadManager;
+    PreviewRenderer previewRenderer;
+    ImageWriter imageWriter; //Encodes saved images off the GUI thread
+    DisplayPyramid originalPyramid; //Declared after fileManager, so no build outlives the images it reads
+    DisplayPyramid rectifiedPyramid;
+    DisplayPyramid *shownPyramid = nullptr; //Pyramid of the image in the view, nullptr while a preview is shown
+    const QImage *shownImage = nullptr;
+    QImage progressiveImage; //Finished rows of the running render, sampled down to the view's size
+    QTimer previewTimer; //Coalesces slider moves into one preview render
+    QActionGroup *affinityGroup;
+    void startRendering();
+    void applyWorkerConfig(const WorkerConfig &config);
+    void startProgressiveImage();
+    void showImage(const QImage *image);
+    void showPyramid(DisplayPyramid *pyramid, const QImage *image);
+    void resizeEvent(QResizeEvent *event) override;
+    QImage displayImage(const QImage *image) const;
 signals:
     void setProgressValue(int progress);
 };
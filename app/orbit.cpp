@@ -0,0 +1,196 @@
+//============================================================================
+// Name        : orbit.cpp
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This class is responsible for knowing where the satellite
+//               is. It reads the mean elements of a two-line element set
+//               and propagates them as a Keplerian orbit whose node, perigee
+//               and mean anomaly drift at the secular J2 rates, which is all
+//               the oblateness does over the few minutes of a pass. Drag and
+//               the periodic terms SGP4 adds are left out, so positions stay
+//               within a few km for elements a day or two old. The state is
+//               turned from the inertial frame into the Earth-fixed one with
+//               the Greenwich mean sidereal time, the velocity included, so
+//               it follows the ground track rather than the inertial orbit.
+//============================================================================
+
+#include "orbit.h"
+#include <QFile>
+#include <QStringList>
+
+static const double pi = 3.14159265358979323846;
+const double Orbit::earthMu = 398600.4418;
+const double Orbit::earthEquatorialRadius = 6378.137;
+const double Orbit::earthJ2 = 1.08262668e-3;
+const double Orbit::earthRotationRate = 7.2921150e-5;
+
+static bool tleChecksumValid(const QString &line){
+    //Last column is the sum of the digits before it, minus signs counting as one, modulo 10
+    if(line.length() != 69 || !line[68].isDigit()){
+        return false;
+    }
+    int sum = 0;
+    for(int column = 0; column < 68; column++){
+        if(line[column].isDigit()){
+            sum += line[column].digitValue();
+        } else if(line[column] == '-'){
+            sum++;
+        }
+    }
+    return sum % 10 == line[68].digitValue();
+}
+
+static double tleField(const QString &line, int firstColumn, int lastColumn){
+    //Columns are 1-based and inclusive, as in the format's definition
+    bool ok;
+    double value = line.mid(firstColumn - 1, lastColumn - firstColumn + 1).trimmed().toDouble(&ok);
+    if(!ok){
+        throw string("Invalid two-line element set");
+    }
+    return value;
+}
+
+Orbit::Orbit(const OrbitalElements &elements){
+    //Secular J2 rates, from the mean motion and the shape of the orbit
+    this->elements = elements;
+    double mean_motion = elements.meanMotion;
+    this->semiMajorAxis = cbrt(earthMu / (mean_motion * mean_motion));
+    double semi_latus = this->semiMajorAxis * (1 - elements.eccentricity * elements.eccentricity);
+    double j2_factor = 1.5 * mean_motion * earthJ2 * pow(earthEquatorialRadius / semi_latus, 2);
+    double sin_inclination = sin(elements.inclination);
+    this->rightAscensionRate = -j2_factor * cos(elements.inclination);
+    this->argumentOfPerigeeRate = j2_factor * (2 - 2.5 * sin_inclination * sin_inclination);
+    this->meanAnomalyRate = mean_motion + j2_factor * sqrt(1 - elements.eccentricity * elements.eccentricity) * (1 - 1.5 * sin_inclination * sin_inclination);
+}
+
+OrbitalElements Orbit::parseTle(const QString &text, const QString &satelliteName){
+    //Take the first set, or the first one whose name line contains satelliteName
+    QStringList lines;
+    for(const QString &line : text.split('\n')){
+        QString trimmed = line.trimmed();
+        if(!trimmed.isEmpty()){
+            lines << trimmed;
+        }
+    }
+    for(int line = 0; line + 1 < lines.size(); line++){
+        if(!lines[line].startsWith("1 ") || !lines[line + 1].startsWith("2 ")){
+            continue;
+        }
+        QString name = line > 0 && !lines[line - 1].startsWith("1 ") && !lines[line - 1].startsWith("2 ") ? lines[line - 1] : QString();
+        if(name.startsWith("0 ")){
+            name = name.mid(2);
+        }
+        if(!satelliteName.isEmpty() && !name.contains(satelliteName, Qt::CaseInsensitive)){
+            continue;
+        }
+        const QString &first = lines[line];
+        const QString &second = lines[line + 1];
+        if(!tleChecksumValid(first) || !tleChecksumValid(second)){
+            throw string("Invalid two-line element set checksum");
+        }
+
+        OrbitalElements elements;
+        elements.name = name;
+        int year = static_cast<int>(tleField(first, 19, 20));
+        year += year < 57 ? 2000 : 1900;
+        double day = tleField(first, 21, 32);
+        elements.epoch = QDateTime(QDate(year, 1, 1), QTime(0, 0), Qt::UTC).addMSecs(static_cast<qint64>(llround((day - 1) * 86400000.0)));
+        elements.inclination = tleField(second, 9, 16) * pi / 180;
+        elements.rightAscension = tleField(second, 18, 25) * pi / 180;
+        elements.eccentricity = tleField(second, 27, 33) * 1e-7;
+        elements.argumentOfPerigee = tleField(second, 35, 42) * pi / 180;
+        elements.meanAnomaly = tleField(second, 44, 51) * pi / 180;
+        elements.meanMotion = tleField(second, 53, 63) * 2 * pi / 86400;
+        if(elements.meanMotion <= 0 || elements.eccentricity >= 1){
+            throw string("Invalid two-line element set");
+        }
+        return elements;
+    }
+    throw string("No matching two-line element set found");
+}
+
+OrbitalElements Orbit::readTle(const string &filePath, const QString &satelliteName){
+    QFile file(QString::fromStdString(filePath));
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text)){
+        throw string("The element set file was unable to be opened");
+    }
+    return parseTle(QString::fromLatin1(file.readAll()), satelliteName);
+}
+
+static double siderealTimeAt(double daysSinceJ2000){
+    //IAU 1982 Greenwich mean sidereal time, in radians
+    double centuries = daysSinceJ2000 / 36525.0;
+    double seconds = 67310.54841 + (876600.0 * 3600.0 + 8640184.812866) * centuries + 0.093104 * centuries * centuries - 6.2e-6 * centuries * centuries * centuries;
+    double angle = fmod(seconds, 86400.0) / 86400.0 * 2 * pi;
+    return angle < 0 ? angle + 2 * pi : angle;
+}
+
+static double daysSinceJ2000(const QDateTime &time){
+    static const qint64 j2000Msecs = QDateTime(QDate(2000, 1, 1), QTime(12, 0), Qt::UTC).toMSecsSinceEpoch();
+    return (time.toMSecsSinceEpoch() - j2000Msecs) / 86400000.0;
+}
+
+double Orbit::siderealTime(const QDateTime &time){
+    return siderealTimeAt(daysSinceJ2000(time));
+}
+
+double Orbit::getPeriod() const{
+    return 2 * pi / this->meanAnomalyRate;
+}
+
+void Orbit::stateAt(const QDateTime &time, Vector3 *position, Vector3 *velocity) const{
+    this->stateAt(this->elements.epoch.msecsTo(time) / 1000.0, position, velocity);
+}
+
+void Orbit::stateAt(double secondsSinceEpoch, Vector3 *position, Vector3 *velocity) const{
+    //Solve Kepler's equation for the drifted elements
+    const OrbitalElements &elements = this->elements;
+    double eccentricity = elements.eccentricity;
+    double mean_anomaly = fmod(elements.meanAnomaly + this->meanAnomalyRate * secondsSinceEpoch, 2 * pi);
+    double right_ascension = elements.rightAscension + this->rightAscensionRate * secondsSinceEpoch;
+    double perigee = elements.argumentOfPerigee + this->argumentOfPerigeeRate * secondsSinceEpoch;
+    double eccentric_anomaly = mean_anomaly;
+    for(int iteration = 0; iteration < 10; iteration++){
+        double step = (eccentric_anomaly - eccentricity * sin(eccentric_anomaly) - mean_anomaly) / (1 - eccentricity * cos(eccentric_anomaly));
+        eccentric_anomaly -= step;
+        if(fabs(step) < 1e-12){
+            break;
+        }
+    }
+
+    //Position and velocity in the orbital plane, perigee along the first axis
+    double a = this->semiMajorAxis;
+    double root = sqrt(1 - eccentricity * eccentricity);
+    double cos_e = cos(eccentric_anomaly);
+    double sin_e = sin(eccentric_anomaly);
+    double radius = a * (1 - eccentricity * cos_e);
+    double plane_x = a * (cos_e - eccentricity);
+    double plane_y = a * root * sin_e;
+    double speed_factor = sqrt(earthMu * a) / radius;
+    double plane_vx = -speed_factor * sin_e;
+    double plane_vy = speed_factor * root * cos_e;
+
+    //Rotate by perigee, inclination and node into the inertial frame
+    double cos_w = cos(perigee), sin_w = sin(perigee);
+    double cos_i = cos(elements.inclination), sin_i = sin(elements.inclination);
+    double cos_o = cos(right_ascension), sin_o = sin(right_ascension);
+    Vector3 p = {cos_o * cos_w - sin_o * sin_w * cos_i, sin_o * cos_w + cos_o * sin_w * cos_i, sin_w * sin_i};
+    Vector3 q = {-cos_o * sin_w - sin_o * cos_w * cos_i, -sin_o * sin_w + cos_o * cos_w * cos_i, cos_w * sin_i};
+    Vector3 inertial_position = p * plane_x + q * plane_y;
+    Vector3 inertial_velocity = p * plane_vx + q * plane_vy;
+
+    //Then by sidereal time into the Earth-fixed frame, taking the rotation out of the velocity
+    double theta = siderealTimeAt(daysSinceJ2000(elements.epoch) + secondsSinceEpoch / 86400.0);
+    double cos_t = cos(theta), sin_t = sin(theta);
+    Vector3 fixed_position = {cos_t * inertial_position.x + sin_t * inertial_position.y, -sin_t * inertial_position.x + cos_t * inertial_position.y, inertial_position.z};
+    Vector3 fixed_velocity = {cos_t * inertial_velocity.x + sin_t * inertial_velocity.y, -sin_t * inertial_velocity.x + cos_t * inertial_velocity.y, inertial_velocity.z};
+    fixed_velocity.x += earthRotationRate * fixed_position.y;
+    fixed_velocity.y -= earthRotationRate * fixed_position.x;
+    if(position != nullptr){
+        *position = fixed_position;
+    }
+    if(velocity != nullptr){
+        *velocity = fixed_velocity;
+    }
+}
@@ -0,0 +1,69 @@
+//============================================================================
+// Name        : orbit.h
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is the class definition of Orbit, along with the
+//               OrbitalElements read from a two-line element set and the
+//               small Vector3 both work in. Special note is that angles are
+//               kept in radians and rates per second, while positions come
+//               out in km in the Earth-fixed frame.
+//============================================================================
+
+#ifndef ORBIT_H
+#define ORBIT_H
+#include <QDateTime>
+#include <QString>
+#include <cmath>
+#include <string>
+
+using namespace std;
+
+struct Vector3{
+    double x;
+    double y;
+    double z;
+    Vector3 operator+(const Vector3 &other) const {return {this->x + other.x, this->y + other.y, this->z + other.z};}
+    Vector3 operator-(const Vector3 &other) const {return {this->x - other.x, this->y - other.y, this->z - other.z};}
+    Vector3 operator*(double factor) const {return {this->x * factor, this->y * factor, this->z * factor};}
+    double dot(const Vector3 &other) const {return this->x * other.x + this->y * other.y + this->z * other.z;}
+    Vector3 cross(const Vector3 &other) const {return {this->y * other.z - this->z * other.y, this->z * other.x - this->x * other.z, this->x * other.y - this->y * other.x};}
+    double length() const {return sqrt(this->dot(*this));}
+    Vector3 normalized() const {return *this * (1.0 / this->length());}
+};
+
+struct OrbitalElements{
+    QString name;
+    QDateTime epoch; //UTC
+    double inclination;
+    double rightAscension; //Of the ascending node
+    double eccentricity;
+    double argumentOfPerigee;
+    double meanAnomaly;
+    double meanMotion; //Radians per second
+};
+
+class Orbit{
+private:
+    OrbitalElements elements;
+    double semiMajorAxis;
+    double rightAscensionRate; //J2 drift of the node
+    double argumentOfPerigeeRate;
+    double meanAnomalyRate;
+public:
+    static const double earthMu; //km^3/s^2
+    static const double earthEquatorialRadius; //km
+    static const double earthJ2;
+    static const double earthRotationRate; //rad/s
+    explicit Orbit(const OrbitalElements &elements);
+    static OrbitalElements parseTle(const QString &text, const QString &satelliteName = "");
+    static OrbitalElements readTle(const string &filePath, const QString &satelliteName = "");
+    static double siderealTime(const QDateTime &time);
+    const OrbitalElements &getElements() const {return this->elements;}
+    double getSemiMajorAxis() const {return this->semiMajorAxis;}
+    double getPeriod() const;
+    void stateAt(const QDateTime &time, Vector3 *position, Vector3 *velocity) const;
+    void stateAt(double secondsSinceEpoch, Vector3 *position, Vector3 *velocity) const;
+};
+
+#endif // ORBIT_H
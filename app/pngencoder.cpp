@@ -0,0 +1,292 @@
+//============================================================================
+// Name        : pngencoder.cpp
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This class writes PNG files with the deflate work spread
+//               over a thread pool, the way pigz does for gzip. The rows are
+//               cut into groups and each group is filtered and deflated on
+//               its own, primed with the last 32 KiB of filtered rows before
+//               it as a preset dictionary so little ratio is lost at the
+//               seams. Every group but the last ends on a sync flush, which
+//               leaves the raw deflate streams byte aligned and without a
+//               final block, so they concatenate into one zlib stream. The
+//               Adler-32 of the whole stream is put together from the groups'
+//               own checksums with adler32_combine(), and each group goes out
+//               as its own IDAT chunk. Rows are filtered adaptively, picking
+//               per row the filter with the smallest sum of absolute values
+//               as libpng does.
+//============================================================================
+
+#include "pngencoder.h"
+#include "idlethreads.h"
+#include "tracer.h"
+#include <QFile>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+#include <zlib.h>
+
+struct PngGroup{
+    QByteArray data; //Compressed bytes, ready to be the body of an IDAT chunk
+    uLong crc = 0; //CRC of the chunk type and body
+    uLong adler = 1;
+    uLong length = 0; //Filtered bytes the group covers
+    bool failed = false;
+};
+
+static QImage pngSource(const QImage &image){
+    //These four are packed row by row as they are, everything else is converted once up front
+    switch(image.format()){
+    case QImage::Format_Grayscale8:
+    case QImage::Format_RGB888:
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+        return image;
+    default:
+        return image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+    }
+}
+
+static int pngChannelsFor(QImage::Format format){
+    switch(format){
+    case QImage::Format_Grayscale8:
+        return 1;
+    case QImage::Format_ARGB32:
+        return 4;
+    default:
+        return 3;
+    }
+}
+
+static void packRow(const QImage &image, int row, uchar *packed){
+    //PNG wants R, G, B(, A) in byte order, which 32-bit QImage rows are not
+    int width = image.width();
+    const uchar *scanLine = image.constScanLine(row);
+    if(image.format() == QImage::Format_RGB32 || image.format() == QImage::Format_ARGB32){
+        const QRgb *pixels = reinterpret_cast<const QRgb *>(scanLine);
+        bool alpha = image.format() == QImage::Format_ARGB32;
+        for(int column = 0; column < width; column++){
+            *packed++ = static_cast<uchar>(qRed(pixels[column]));
+            *packed++ = static_cast<uchar>(qGreen(pixels[column]));
+            *packed++ = static_cast<uchar>(qBlue(pixels[column]));
+            if(alpha){
+                *packed++ = static_cast<uchar>(qAlpha(pixels[column]));
+            }
+        }
+    } else {
+        memcpy(packed, scanLine, static_cast<size_t>(width) * pngChannelsFor(image.format()));
+    }
+}
+
+static int paethPredictor(int left, int up, int upLeft){
+    int estimate = left + up - upLeft;
+    int leftDistance = abs(estimate - left);
+    int upDistance = abs(estimate - up);
+    int upLeftDistance = abs(estimate - upLeft);
+    if(leftDistance <= upDistance && leftDistance <= upLeftDistance){
+        return left;
+    }
+    return upDistance <= upLeftDistance ? up : upLeft;
+}
+
+static void filterRow(const uchar *row, const uchar *previous, int bytes, int bytesPerPixel, vector<uchar> candidates[4], uchar *filtered){
+    //Try Sub, Up, Average and Paeth next to None, and keep whichever looks the most compressible
+    uchar *sub = candidates[0].data();
+    uchar *up = candidates[1].data();
+    uchar *average = candidates[2].data();
+    uchar *paeth = candidates[3].data();
+    for(int index = 0; index < bytes; index++){
+        int left = index >= bytesPerPixel ? row[index - bytesPerPixel] : 0;
+        int upLeft = index >= bytesPerPixel ? previous[index - bytesPerPixel] : 0;
+        sub[index] = static_cast<uchar>(row[index] - left);
+        up[index] = static_cast<uchar>(row[index] - previous[index]);
+        average[index] = static_cast<uchar>(row[index] - ((left + previous[index]) >> 1));
+        paeth[index] = static_cast<uchar>(row[index] - paethPredictor(left, previous[index], upLeft));
+    }
+    const uchar *choices[5] = {row, sub, up, average, paeth};
+    int best = 0;
+    long bestSum = -1;
+    for(int choice = 0; choice < 5; choice++){
+        long sum = 0;
+        for(int index = 0; index < bytes; index++){
+            sum += abs(static_cast<signed char>(choices[choice][index]));
+        }
+        if(bestSum < 0 || sum < bestSum){
+            best = choice;
+            bestSum = sum;
+        }
+    }
+    filtered[0] = static_cast<uchar>(best);
+    memcpy(filtered + 1, choices[best], static_cast<size_t>(bytes));
+}
+
+static void encodeGroup(const QImage &image, bool bottomUp, int level, int firstRow, int lastRow, bool finalGroup, PngGroup *group){
+    TraceScope trace("PngEncoder::group", "worker");
+    //Filter the group plus enough rows before it for the dictionary, then deflate just the group
+    int height = image.height();
+    int rowBytes = image.width() * pngChannelsFor(image.format());
+    int stride = rowBytes + 1;
+    int dictionaryRows = min(firstRow, (PngEncoder::dictionaryBytes + stride - 1) / stride);
+    int startRow = firstRow - dictionaryRows;
+    vector<uchar> filtered(static_cast<size_t>(lastRow - startRow) * stride);
+    vector<uchar> current(rowBytes);
+    vector<uchar> previous(rowBytes, 0);
+    vector<uchar> candidates[4] = {vector<uchar>(rowBytes), vector<uchar>(rowBytes), vector<uchar>(rowBytes), vector<uchar>(rowBytes)};
+    if(startRow > 0){
+        packRow(image, bottomUp ? height - startRow : startRow - 1, previous.data());
+    }
+    for(int row = startRow; row < lastRow; row++){
+        packRow(image, bottomUp ? height - 1 - row : row, current.data());
+        filterRow(current.data(), previous.data(), rowBytes, pngChannelsFor(image.format()), candidates, filtered.data() + static_cast<size_t>(row - startRow) * stride);
+        swap(current, previous);
+    }
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if(deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK){
+        group->failed = true;
+        return;
+    }
+    size_t dictionaryLength = min(static_cast<size_t>(PngEncoder::dictionaryBytes), static_cast<size_t>(dictionaryRows) * stride);
+    const uchar *input = filtered.data() + static_cast<size_t>(dictionaryRows) * stride;
+    if(dictionaryLength > 0 && deflateSetDictionary(&stream, input - dictionaryLength, static_cast<uInt>(dictionaryLength)) != Z_OK){
+        deflateEnd(&stream);
+        group->failed = true;
+        return;
+    }
+    group->length = static_cast<uLong>(lastRow - firstRow) * stride;
+    group->adler = adler32(adler32(0, Z_NULL, 0), input, static_cast<uInt>(group->length));
+
+    //The first group carries the zlib header, its level hint follows RFC 1950
+    QByteArray &data = group->data;
+    size_t headerBytes = 0;
+    if(firstRow == 0){
+        int levelHint = level == Z_DEFAULT_COMPRESSION ? 2 : (level < 2 ? 0 : (level < 6 ? 1 : (level == 6 ? 2 : 3)));
+        int header = (0x78 << 8) | (levelHint << 6);
+        header += 31 - header % 31;
+        data.append(static_cast<char>(header >> 8));
+        data.append(static_cast<char>(header & 0xff));
+        headerBytes = 2;
+    }
+    data.resize(static_cast<int>(headerBytes + deflateBound(&stream, group->length) + 16));
+    stream.next_in = const_cast<Bytef *>(input);
+    stream.avail_in = static_cast<uInt>(group->length);
+    stream.next_out = reinterpret_cast<Bytef *>(data.data() + headerBytes);
+    stream.avail_out = static_cast<uInt>(data.size() - headerBytes);
+    int flush = finalGroup ? Z_FINISH : Z_SYNC_FLUSH;
+    while(true){
+        int status = deflate(&stream, flush);
+        if(status == Z_STREAM_ERROR){
+            group->failed = true;
+            break;
+        }
+        //A sync flush is complete once deflate leaves output space unused, a finish once the stream ends
+        if(finalGroup ? status == Z_STREAM_END : stream.avail_out != 0){
+            break;
+        }
+        if(stream.avail_out == 0){
+            size_t used = data.size() - stream.avail_out;
+            data.resize(data.size() * 2);
+            stream.next_out = reinterpret_cast<Bytef *>(data.data() + used);
+            stream.avail_out = static_cast<uInt>(data.size() - used);
+        }
+    }
+    data.resize(static_cast<int>(data.size() - stream.avail_out));
+    deflateEnd(&stream);
+    group->crc = crc32(crc32(0, reinterpret_cast<const Bytef *>("IDAT"), 4), reinterpret_cast<const Bytef *>(data.constData()), static_cast<uInt>(data.size()));
+}
+
+static void appendBigEndian(QByteArray *bytes, quint32 value){
+    for(int shift = 24; shift >= 0; shift -= 8){
+        bytes->append(static_cast<char>((value >> shift) & 0xff));
+    }
+}
+
+static void appendChunk(QByteArray *png, const char *type, const QByteArray &data, uLong crc){
+    appendBigEndian(png, static_cast<quint32>(data.size()));
+    png->append(type, 4);
+    png->append(data);
+    appendBigEndian(png, static_cast<quint32>(crc));
+}
+
+static void appendChunk(QByteArray *png, const char *type, const QByteArray &data){
+    uLong crc = crc32(crc32(0, reinterpret_cast<const Bytef *>(type), 4), reinterpret_cast<const Bytef *>(data.constData()), static_cast<uInt>(data.size()));
+    appendChunk(png, type, data, crc);
+}
+
+QByteArray PngEncoder::encode(const QImage &image, bool bottomUp, int compressionLevel, QThreadPool *pool, int chunkRows){
+    TraceScope trace("PngEncoder::encode");
+    //Encode the image as an 8-bit gray, RGB or RGBA PNG, rows in display order
+    QImage source = pngSource(image);
+    if(source.isNull()){
+        throw string("The file was unable to be saved");
+    }
+    int width = source.width();
+    int height = source.height();
+    int channels = pngChannelsFor(source.format());
+    int stride = width * channels + 1;
+    int level = compressionLevel < 0 ? Z_DEFAULT_COMPRESSION : min(compressionLevel, 9);
+    if(chunkRows < 1){
+        chunkRows = max(1, (minChunkBytes + stride - 1) / stride);
+    }
+    int groupCount = (height + chunkRows - 1) / chunkRows;
+    vector<PngGroup> groups(groupCount);
+
+    //Hand out groups in order to whichever thread asks next, the calling thread included
+    atomic<int> nextGroup{0};
+    function<void()> work = [&](){
+        for(int group = nextGroup.fetch_add(1); group < groupCount; group = nextGroup.fetch_add(1)){
+            int firstRow = group * chunkRows;
+            encodeGroup(source, bottomUp, level, firstRow, min(height, firstRow + chunkRows), group == groupCount - 1, &groups[group]);
+        }
+    };
+    //Helpers only start on idle threads, so encoding from inside a busy pool never waits on itself
+    runOnIdleThreads(pool, groupCount - 1, work);
+
+    //Stitch the groups together behind the header
+    QByteArray png("\x89PNG\r\n\x1a\n", 8);
+    QByteArray header;
+    appendBigEndian(&header, static_cast<quint32>(width));
+    appendBigEndian(&header, static_cast<quint32>(height));
+    const char colorTypes[] = {0, 0, 0, 2, 6};
+    header.append(static_cast<char>(8));
+    header.append(colorTypes[channels]);
+    header.append(3, '\0');
+    appendChunk(&png, "IHDR", header);
+    uLong adler = adler32(0, Z_NULL, 0);
+    for(int group = 0; group < groupCount; group++){
+        if(groups[group].failed){
+            throw string("The file was unable to be saved");
+        }
+        adler = group == 0 ? groups[group].adler : adler32_combine(adler, groups[group].adler, static_cast<z_off_t>(groups[group].length));
+    }
+    for(int group = 0; group < groupCount; group++){
+        QByteArray &data = groups[group].data;
+        uLong crc = groups[group].crc;
+        if(group == groupCount - 1){
+            //The stream's Adler-32 trailer is only known now, so it is appended to the last chunk and its CRC carried on
+            QByteArray trailer;
+            appendBigEndian(&trailer, static_cast<quint32>(adler));
+            crc = crc32(crc, reinterpret_cast<const Bytef *>(trailer.constData()), 4);
+            data.append(trailer);
+        }
+        appendChunk(&png, "IDAT", data, crc);
+        data.clear();
+    }
+    appendChunk(&png, "IEND", QByteArray());
+    return png;
+}
+
+void PngEncoder::write(const QImage &image, const string &filePath, bool bottomUp, int compressionLevel){
+    //Encode first so a failed encode leaves any existing file alone
+    QByteArray png = encode(image, bottomUp, compressionLevel);
+    QFile file(QString::fromStdString(filePath));
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(png) != png.size()){
+        throw string("The file was unable to be saved: ") + file.errorString().toStdString();
+    }
+    file.close();
+}
@@ -0,0 +1,30 @@
+//============================================================================
+// Name        : pngencoder.h
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is the class definition of PngEncoder. Special note is
+//               that everything is static and the encoder keeps no state
+//               between images, so several threads may encode at once. The
+//               image is split into row groups of at least minChunkBytes of
+//               filtered data, unless chunkRows asks for a fixed size.
+//============================================================================
+
+#ifndef PNGENCODER_H
+#define PNGENCODER_H
+#include <QByteArray>
+#include <QImage>
+#include <QThreadPool>
+#include <string>
+
+using namespace std;
+
+class PngEncoder{
+public:
+    static const int minChunkBytes = 256 * 1024; //Below this, splitting costs more ratio than it saves time
+    static const int dictionaryBytes = 32768; //Deflate window, primed from the rows before each group
+    static QByteArray encode(const QImage &image, bool bottomUp = false, int compressionLevel = -1, QThreadPool *pool = QThreadPool::globalInstance(), int chunkRows = 0);
+    static void write(const QImage &image, const string &filePath, bool bottomUp = false, int compressionLevel = -1);
+};
+
+#endif // PNGENCODER_H
@@ -0,0 +1,55 @@
+//============================================================================
+// Name        : previewrenderer.cpp
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This class is responsible for the live preview shown while
+//               the sliders are being dragged. When an image is opened it
+//               keeps a downscaled proxy of it, no larger than a few hundred
+//               thousand pixels, and every render rectifies that proxy with
+//               its own correction table and resample map. Since the table
+//               only depends on the width, the proxy's rectified shape
+//               matches the full image's at the scale it is displayed at.
+//============================================================================
+
+#include "previewrenderer.h"
+#include "rectifykernel.h"
+#include "tracer.h"
+
+const int PreviewRenderer::maxProxyWidth;
+const int PreviewRenderer::maxProxyHeight;
+
+PreviewRenderer::PreviewRenderer(): correctionFactor(1){
+    //Every slider position is a new parameter set, none of them worth a file on disk
+    this->correctionFactor.setPersistent(false);
+}
+
+void PreviewRenderer::setSource(const QImage *image){
+    //Shrink large images to the proxy bounds, in a format the fast row kernel handles
+    QImage proxy = *image;
+    if(proxy.width() > maxProxyWidth || proxy.height() > maxProxyHeight){
+        proxy = proxy.scaled(maxProxyWidth, maxProxyHeight, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    if(RectifyKernel::isSupportedFormat(proxy.format())){
+        this->proxyImage = proxy;
+    } else {
+        this->proxyImage = proxy.convertToFormat(proxy.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+    }
+    this->correctionFactor.setImageWidth(this->proxyImage.width());
+    this->previewImage = QImage();
+}
+
+const QImage *PreviewRenderer::render(double earthRadius, double satelliteAltitude, int satelliteSwath){
+    TraceScope trace("PreviewRenderer::render");
+    //Rectify the whole proxy on the calling thread, it is small enough to take a few milliseconds
+    if(this->proxyImage.isNull()){
+        return &this->previewImage;
+    }
+    this->correctionFactor.setParameters(earthRadius, satelliteAltitude, satelliteSwath);
+    shared_ptr<const ResampleMap> resampleMap = this->correctionFactor.getResampleMap();
+    if(this->previewImage.width() != resampleMap->getRectifiedWidth() || this->previewImage.height() != this->proxyImage.height()){
+        this->previewImage = QImage(resampleMap->getRectifiedWidth(), this->proxyImage.height(), this->proxyImage.format());
+    }
+    RectifyKernel::rectifyRows(&this->proxyImage, &this->previewImage, *resampleMap, 0, this->proxyImage.height());
+    return &this->previewImage;
+}
@@ -0,0 +1,35 @@
+//============================================================================
+// Name        : previewrenderer.h
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is the class definition of PreviewRenderer. Special note
+//               is that it only ever rectifies a small proxy of the opened
+//               image, so a render is cheap enough to run on the GUI thread
+//               for every slider move.
+//============================================================================
+
+#ifndef PREVIEWRENDERER_H
+#define PREVIEWRENDERER_H
+#include <QImage>
+#include "correctionfactor.h"
+
+using namespace std;
+
+class PreviewRenderer{
+private:
+    QImage proxyImage;
+    QImage previewImage;
+    CorrectionFactor correctionFactor;
+public:
+    static const int maxProxyWidth = 512;
+    static const int maxProxyHeight = 1024;
+    PreviewRenderer();
+    void setSource(const QImage *image);
+    void setFilter(ResampleFilter filter){this->correctionFactor.setFilter(filter);}
+    const QImage *render(double earthRadius, double satelliteAltitude, int satelliteSwath);
+    const QImage *getProxyImagePtr() const {return &this->proxyImage;}
+    const QImage *getPreviewImagePtr() const {return &this->previewImage;}
+};
+
+#endif // PREVIEWRENDERER_H
@@ -0,0 +1,527 @@
+//============================================================================
+// Name        : rectifykernel.cpp
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This class is responsible for the per-row rectification
+//               math. Every row is produced by gathering the start and end
+//               pixel of each rectified column from a ResampleMap and
+//               blending them with the map's fixed point weights. The fast
+//               path works directly on scanline pointers of 32-bit images and
+//               blends all four channels of four pixels per iteration using
+//               SSE2, or eight pixels with AVX2 gathers when the compiler
+//               targets it. The fixed point blend gives exactly the same
+//               truncated result as the integer division of the original
+//               code.
+//
+//               Grayscale8 and RGB888 images have their own row kernel that
+//               blends the 1 or 3 bytes of each pixel in place, so single
+//               channel passes are never widened to 32 bits per pixel. Gray
+//               rows blend eight columns per iteration with SSE2. Which
+//               kernel runs is decided from the QImage format of each band.
+//
+//               Maps built with the cubic or Lanczos-3 filter run a tap
+//               kernel instead. The source row is first copied into a padded
+//               buffer with its edge pixels repeated, so no tap ever needs a
+//               bounds check, and every rectified column is the dot product
+//               of its taps with one row of the map's polyphase bank. For
+//               32-bit pixels two taps of all four channels are summed per
+//               SSE2 multiply-add.
+//
+//               Since no column depends on its neighbours, every kernel also
+//               takes a span of rectified columns, and rectifyTile() fills
+//               any rectangle of the output on its own. Tiles of one image
+//               can be rectified on different threads at once, and a region
+//               of interest costs only its own pixels; a filtered span only
+//               pads the source columns its taps reach.
+//
+//               The output is bit-identical to the reference path for every
+//               opaque pixel. The only documented differences are the alpha
+//               channel of translucent ARGB32 pixels, which is blended like
+//               the color channels instead of ORing the start alpha with the
+//               blue value of the previously written pixel (the reference
+//               never clears working_pixel between pixels, so that blue byte
+//               leaks into the next alpha after the three 8-bit shifts; it
+//               only shows when the start alpha is not already 0xFF, and the
+//               native 1 and 3 byte kernels have no alpha to leak), and the
+//               columns at the very edges the reference never writes, which
+//               are set to zero instead of being left untouched.
+//
+//               The reference path is the original per-pixel implementation
+//               using QImage::pixel() and QImage::setPixel(). It is no longer
+//               used by the application, but kept so the fast paths can be
+//               verified against it.
+//============================================================================
+
+#include "rectifykernel.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+int RectifyKernel::bytesPerPixelFor(QImage::Format format){
+    //Bytes per pixel of the native row kernel for a format, 0 when it has to go through QImage::pixel()/setPixel()
+    switch(format){
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        return 4;
+    case QImage::Format_RGB888:
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    case QImage::Format_BGR888:
+#endif
+        return 3;
+    case QImage::Format_Grayscale8:
+    case QImage::Format_Alpha8:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+bool RectifyKernel::isSupportedFormat(QImage::Format format){
+    //Formats whose channels are plain bytes can be blended straight from their scanlines
+    return bytesPerPixelFor(format) != 0;
+}
+
+QRgb RectifyKernel::blendPixel(QRgb start_pixel, QRgb end_pixel, uint32_t weight, uint32_t reciprocal){
+    //Blend one pixel with the fixed point weights of its rectified column
+    uint32_t start_weight = weight & 0xFFFF;
+    uint32_t end_weight = weight >> 16;
+    QRgb working_pixel = 0;
+    for(int channel = 0; channel < 4; channel++){
+        uint64_t numerator = ((start_pixel >> (channel * 8)) & 255) * start_weight + ((end_pixel >> (channel * 8)) & 255) * end_weight;
+        working_pixel |= static_cast<QRgb>((numerator * reciprocal) >> 32) << (channel * 8);
+    }
+    return working_pixel;
+}
+
+QRgb RectifyKernel::dividePixel(QRgb start_pixel, QRgb end_pixel, int end_weight, int delta){
+    //Blend one pixel of a span too wide for the fixed point weights
+    QRgb working_pixel = 0;
+    for(int channel = 0; channel < 4; channel++){
+        unsigned int start_color = (start_pixel >> (channel * 8)) & 255;
+        unsigned int end_color = (end_pixel >> (channel * 8)) & 255;
+        working_pixel |= static_cast<QRgb>((start_color * (delta - end_weight) + end_color * end_weight) / delta) << (channel * 8);
+    }
+    return working_pixel;
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+//Divide the four 32-bit numerators of one pixel by its reciprocal, quotients stay in the same lanes
+static inline __m128i divideLanes(__m128i numerator, __m128i reciprocal){
+    const __m128i high_mask = _mm_set_epi32(-1, 0, -1, 0);
+    __m128i quotient_even = _mm_srli_epi64(_mm_mul_epu32(numerator, reciprocal), 32);
+    __m128i quotient_odd = _mm_and_si128(_mm_mul_epu32(_mm_srli_epi64(numerator, 32), reciprocal), high_mask);
+    return _mm_or_si128(quotient_even, quotient_odd);
+}
+//Same, but every lane has its own reciprocal
+static inline __m128i divideColumnLanes(__m128i numerator, __m128i reciprocal){
+    const __m128i high_mask = _mm_set_epi32(-1, 0, -1, 0);
+    __m128i quotient_even = _mm_srli_epi64(_mm_mul_epu32(numerator, reciprocal), 32);
+    __m128i quotient_odd = _mm_and_si128(_mm_mul_epu32(_mm_srli_epi64(numerator, 32), _mm_srli_epi64(reciprocal, 32)), high_mask);
+    return _mm_or_si128(quotient_even, quotient_odd);
+}
+#endif
+#if defined(__AVX2__)
+static inline __m256i divideLanes(__m256i numerator, __m256i reciprocal){
+    const __m256i high_mask = _mm256_set1_epi64x(static_cast<long long>(UINT64_C(0xFFFFFFFF00000000)));
+    __m256i quotient_even = _mm256_srli_epi64(_mm256_mul_epu32(numerator, reciprocal), 32);
+    __m256i quotient_odd = _mm256_and_si256(_mm256_mul_epu32(_mm256_srli_epi64(numerator, 32), reciprocal), high_mask);
+    return _mm256_or_si256(quotient_even, quotient_odd);
+}
+#endif
+
+//Filter rows with the polyphase bank of a cubic or Lanczos-3 map, the tap count fixed so the tap loops unroll
+template<int channels, int taps>
+static void filterRowTaps(const uchar *original_row, uchar *rectified_row, const ResampleMap &resample_map, int first_column, int end_column){
+    const int original_width = resample_map.getOriginalWidth();
+    const int32_t *filter_columns = resample_map.getFilterColumns();
+    const int32_t *filter_phases = resample_map.getFilterPhases();
+    const int16_t *filter_bank = resample_map.getFilterBank();
+    const int rounding = 1 << (ResampleMap::filterPrecision - 1);
+    if(first_column >= end_column){
+        return;
+    }
+
+    //Copy just the padded columns the span's taps reach, edge pixels repeated, so no tap needs a bounds check
+    int padded_first = *min_element(filter_columns + first_column, filter_columns + end_column);
+    int padded_end = *max_element(filter_columns + first_column, filter_columns + end_column) + taps;
+    thread_local vector<uchar> padded_row;
+    padded_row.resize((padded_end - padded_first) * channels);
+    uchar *padded = padded_row.data() - padded_first * channels; //Indexed by padded column, like the map
+    int interior_first = max(padded_first, ResampleMap::filterPadding);
+    int interior_end = max(interior_first, min(padded_end, ResampleMap::filterPadding + original_width));
+    for(int pad = padded_first; pad < interior_first; pad++){
+        memcpy(padded + pad * channels, original_row, channels);
+    }
+    memcpy(padded + interior_first * channels, original_row + (interior_first - ResampleMap::filterPadding) * channels, (interior_end - interior_first) * channels);
+    for(int pad = interior_end; pad < padded_end; pad++){
+        memcpy(padded + pad * channels, original_row + (original_width - 1) * channels, channels);
+    }
+
+    int column = first_column;
+#if defined(__SSE2__) || defined(_M_X64)
+    if(channels == 4){
+        //Two neighbouring taps of all four channels per multiply-add, channels interleaved as 16-bit pairs
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i round = _mm_set1_epi32(rounding);
+        for(; column < end_column; column++){
+            const uchar *tap_pixels = padded + filter_columns[column] * 4;
+            const int16_t *weights = filter_bank + filter_phases[column] * taps;
+            __m128i sum = round;
+            for(int tap = 0; tap < taps; tap += 2){
+                __m128i pixels = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(tap_pixels + tap * 4)), zero);
+                __m128i pairs = _mm_unpacklo_epi16(pixels, _mm_srli_si128(pixels, 8));
+                __m128i weight = _mm_set1_epi32(static_cast<uint16_t>(weights[tap]) | (static_cast<uint32_t>(static_cast<uint16_t>(weights[tap + 1])) << 16));
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(pairs, weight));
+            }
+            __m128i result = _mm_srai_epi32(sum, ResampleMap::filterPrecision);
+            result = _mm_packus_epi16(_mm_packs_epi32(result, zero), zero);
+            uint32_t pixel = static_cast<uint32_t>(_mm_cvtsi128_si32(result));
+            memcpy(rectified_row + column * 4, &pixel, 4);
+        }
+    }
+#endif
+    //Remaining columns, or all of them for 1 and 3 byte pixels
+    for(; column < end_column; column++){
+        const uchar *tap_pixels = padded + filter_columns[column] * channels;
+        const int16_t *weights = filter_bank + filter_phases[column] * taps;
+        for(int channel = 0; channel < channels; channel++){
+            int sum = rounding;
+            for(int tap = 0; tap < taps; tap++){
+                sum += tap_pixels[tap * channels + channel] * weights[tap];
+            }
+            rectified_row[column * channels + channel] = static_cast<uchar>(qBound(0, sum >> ResampleMap::filterPrecision, 255));
+        }
+    }
+}
+
+template<int channels>
+static void filterRowChannels(const uchar *original_row, uchar *rectified_row, const ResampleMap &resample_map, int first_column, int end_column){
+    if(resample_map.getFilterTaps() == 4){
+        filterRowTaps<channels, 4>(original_row, rectified_row, resample_map, first_column, end_column);
+    } else {
+        filterRowTaps<channels, 6>(original_row, rectified_row, resample_map, first_column, end_column);
+    }
+}
+
+void RectifyKernel::rectifyRow(const QRgb *original_row, QRgb *rectified_row, const ResampleMap &resample_map){
+    rectifyPixelSpan(original_row, rectified_row, resample_map, 0, resample_map.getRectifiedWidth());
+}
+
+void RectifyKernel::rectifyPixelSpan(const QRgb *original_row, QRgb *rectified_row, const ResampleMap &resample_map, int first_column, int end_column){
+    if(resample_map.getFilter() != ResampleFilter::Linear){
+        filterRowChannels<4>(reinterpret_cast<const uchar *>(original_row), reinterpret_cast<uchar *>(rectified_row), resample_map, first_column, end_column);
+        return;
+    }
+    const int32_t *start_columns = resample_map.getStartColumns();
+    const int32_t *end_columns = resample_map.getEndColumns();
+    const uint32_t *weights = resample_map.getWeights();
+    const uint32_t *reciprocals = resample_map.getReciprocals();
+    int column = first_column;
+#if defined(__AVX2__)
+    //Eight rectified columns per iteration, start and end pixels fetched with hardware gathers
+    const __m256i zero_256 = _mm256_setzero_si256();
+    for(; column + 8 <= end_column; column += 8){
+        __m256i start = _mm256_i32gather_epi32(reinterpret_cast<const int *>(original_row), _mm256_loadu_si256(reinterpret_cast<const __m256i *>(start_columns + column)), 4);
+        __m256i end = _mm256_i32gather_epi32(reinterpret_cast<const int *>(original_row), _mm256_loadu_si256(reinterpret_cast<const __m256i *>(end_columns + column)), 4);
+        __m256i weight = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weights + column));
+        __m256i reciprocal = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(reciprocals + column));
+        //Interleave start and end channels as 16-bit pairs, one pixel per 128-bit lane half
+        __m256i pairs_low = _mm256_unpacklo_epi8(start, end);
+        __m256i pairs_high = _mm256_unpackhi_epi8(start, end);
+        __m256i quotient_0 = divideLanes(_mm256_madd_epi16(_mm256_unpacklo_epi8(pairs_low, zero_256), _mm256_shuffle_epi32(weight, 0x00)), _mm256_shuffle_epi32(reciprocal, 0x00));
+        __m256i quotient_1 = divideLanes(_mm256_madd_epi16(_mm256_unpackhi_epi8(pairs_low, zero_256), _mm256_shuffle_epi32(weight, 0x55)), _mm256_shuffle_epi32(reciprocal, 0x55));
+        __m256i quotient_2 = divideLanes(_mm256_madd_epi16(_mm256_unpacklo_epi8(pairs_high, zero_256), _mm256_shuffle_epi32(weight, 0xAA)), _mm256_shuffle_epi32(reciprocal, 0xAA));
+        __m256i quotient_3 = divideLanes(_mm256_madd_epi16(_mm256_unpackhi_epi8(pairs_high, zero_256), _mm256_shuffle_epi32(weight, 0xFF)), _mm256_shuffle_epi32(reciprocal, 0xFF));
+        __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(quotient_0, quotient_1), _mm256_packs_epi32(quotient_2, quotient_3));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(rectified_row + column), packed);
+    }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+    //Four rectified columns per iteration, all channels of a pixel blended in one register
+    const __m128i zero = _mm_setzero_si128();
+    for(; column + 4 <= end_column; column += 4){
+        __m128i start = _mm_setr_epi32(static_cast<int>(original_row[start_columns[column]]), static_cast<int>(original_row[start_columns[column + 1]]),
+                                       static_cast<int>(original_row[start_columns[column + 2]]), static_cast<int>(original_row[start_columns[column + 3]]));
+        __m128i end = _mm_setr_epi32(static_cast<int>(original_row[end_columns[column]]), static_cast<int>(original_row[end_columns[column + 1]]),
+                                     static_cast<int>(original_row[end_columns[column + 2]]), static_cast<int>(original_row[end_columns[column + 3]]));
+        __m128i weight = _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights + column));
+        __m128i reciprocal = _mm_loadu_si128(reinterpret_cast<const __m128i *>(reciprocals + column));
+        __m128i pairs_low = _mm_unpacklo_epi8(start, end);
+        __m128i pairs_high = _mm_unpackhi_epi8(start, end);
+        __m128i quotient_0 = divideLanes(_mm_madd_epi16(_mm_unpacklo_epi8(pairs_low, zero), _mm_shuffle_epi32(weight, 0x00)), _mm_shuffle_epi32(reciprocal, 0x00));
+        __m128i quotient_1 = divideLanes(_mm_madd_epi16(_mm_unpackhi_epi8(pairs_low, zero), _mm_shuffle_epi32(weight, 0x55)), _mm_shuffle_epi32(reciprocal, 0x55));
+        __m128i quotient_2 = divideLanes(_mm_madd_epi16(_mm_unpacklo_epi8(pairs_high, zero), _mm_shuffle_epi32(weight, 0xAA)), _mm_shuffle_epi32(reciprocal, 0xAA));
+        __m128i quotient_3 = divideLanes(_mm_madd_epi16(_mm_unpackhi_epi8(pairs_high, zero), _mm_shuffle_epi32(weight, 0xFF)), _mm_shuffle_epi32(reciprocal, 0xFF));
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(quotient_0, quotient_1), _mm_packs_epi32(quotient_2, quotient_3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(rectified_row + column), packed);
+    }
+#endif
+    //Remaining columns, or all of them without SIMD
+    for(; column < end_column; column++){
+        rectified_row[column] = blendPixel(original_row[start_columns[column]], original_row[end_columns[column]], weights[column], reciprocals[column]);
+    }
+    //Spans too wide for the fixed point weights
+    for(int wide = 0; wide < resample_map.getWideColumnCount(); wide++){
+        column = resample_map.getWideColumns()[wide];
+        if(column < first_column || column >= end_column){
+            continue;
+        }
+        rectified_row[column] = dividePixel(original_row[start_columns[column]], original_row[end_columns[column]],
+                                            resample_map.getWideEndWeights()[wide], resample_map.getWideDeltas()[wide]);
+    }
+}
+
+//Blend rows of 1 or 3 byte pixels channel by channel, with the same fixed point weights as the 32-bit kernel
+template<int channels>
+static void rectifyRowChannels(const uchar *original_row, uchar *rectified_row, const ResampleMap &resample_map, int first_column, int end_column){
+    const int32_t *start_columns = resample_map.getStartColumns();
+    const int32_t *end_columns = resample_map.getEndColumns();
+    const uint32_t *weights = resample_map.getWeights();
+    const uint32_t *reciprocals = resample_map.getReciprocals();
+    int column = first_column;
+#if defined(__SSE2__) || defined(_M_X64)
+    if(channels == 1){
+        //Eight gray columns per iteration, the start and end sample of a column packed as a 16-bit pair for one madd
+        for(; column + 8 <= end_column; column += 8){
+            __m128i pairs_0 = _mm_setr_epi32(original_row[start_columns[column]] | (original_row[end_columns[column]] << 16),
+                                             original_row[start_columns[column + 1]] | (original_row[end_columns[column + 1]] << 16),
+                                             original_row[start_columns[column + 2]] | (original_row[end_columns[column + 2]] << 16),
+                                             original_row[start_columns[column + 3]] | (original_row[end_columns[column + 3]] << 16));
+            __m128i pairs_1 = _mm_setr_epi32(original_row[start_columns[column + 4]] | (original_row[end_columns[column + 4]] << 16),
+                                             original_row[start_columns[column + 5]] | (original_row[end_columns[column + 5]] << 16),
+                                             original_row[start_columns[column + 6]] | (original_row[end_columns[column + 6]] << 16),
+                                             original_row[start_columns[column + 7]] | (original_row[end_columns[column + 7]] << 16));
+            __m128i quotient_0 = divideColumnLanes(_mm_madd_epi16(pairs_0, _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights + column))),
+                                                   _mm_loadu_si128(reinterpret_cast<const __m128i *>(reciprocals + column)));
+            __m128i quotient_1 = divideColumnLanes(_mm_madd_epi16(pairs_1, _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights + column + 4))),
+                                                   _mm_loadu_si128(reinterpret_cast<const __m128i *>(reciprocals + column + 4)));
+            __m128i packed = _mm_packus_epi16(_mm_packs_epi32(quotient_0, quotient_1), _mm_setzero_si128());
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(rectified_row + column), packed);
+        }
+    }
+#endif
+    //Remaining columns, or every column of 3 byte pixels
+    for(; column < end_column; column++){
+        const uchar *start_pixel = original_row + start_columns[column] * channels;
+        const uchar *end_pixel = original_row + end_columns[column] * channels;
+        uchar *rectified_pixel = rectified_row + column * channels;
+        uint32_t start_weight = weights[column] & 0xFFFF;
+        uint32_t end_weight = weights[column] >> 16;
+        for(int channel = 0; channel < channels; channel++){
+            uint64_t numerator = start_pixel[channel] * start_weight + end_pixel[channel] * end_weight;
+            rectified_pixel[channel] = static_cast<uchar>((numerator * reciprocals[column]) >> 32);
+        }
+    }
+    //Spans too wide for the fixed point weights
+    for(int wide = 0; wide < resample_map.getWideColumnCount(); wide++){
+        column = resample_map.getWideColumns()[wide];
+        if(column < first_column || column >= end_column){
+            continue;
+        }
+        int end_weight = resample_map.getWideEndWeights()[wide];
+        int delta = resample_map.getWideDeltas()[wide];
+        const uchar *start_pixel = original_row + start_columns[column] * channels;
+        const uchar *end_pixel = original_row + end_columns[column] * channels;
+        uchar *rectified_pixel = rectified_row + column * channels;
+        for(int channel = 0; channel < channels; channel++){
+            rectified_pixel[channel] = static_cast<uchar>((start_pixel[channel] * (delta - end_weight) + end_pixel[channel] * end_weight) / delta);
+        }
+    }
+}
+
+void RectifyKernel::rectifyRowBytes(const uchar *original_row, uchar *rectified_row, int bytes_per_pixel, const ResampleMap &resample_map){
+    rectifySpan(original_row, rectified_row, bytes_per_pixel, resample_map, 0, resample_map.getRectifiedWidth());
+}
+
+void RectifyKernel::rectifySpan(const uchar *original_row, uchar *rectified_row, int bytes_per_pixel, const ResampleMap &resample_map, int first_column, int end_column){
+    //Only rectified columns first_column..end_column-1 of the row are written
+    bool filtered = resample_map.getFilter() != ResampleFilter::Linear;
+    switch(bytes_per_pixel){
+    case 1:
+        if(filtered){
+            filterRowChannels<1>(original_row, rectified_row, resample_map, first_column, end_column);
+        } else {
+            rectifyRowChannels<1>(original_row, rectified_row, resample_map, first_column, end_column);
+        }
+        break;
+    case 3:
+        if(filtered){
+            filterRowChannels<3>(original_row, rectified_row, resample_map, first_column, end_column);
+        } else {
+            rectifyRowChannels<3>(original_row, rectified_row, resample_map, first_column, end_column);
+        }
+        break;
+    default:
+        rectifyPixelSpan(reinterpret_cast<const QRgb *>(original_row), reinterpret_cast<QRgb *>(rectified_row), resample_map, first_column, end_column);
+        break;
+    }
+}
+
+void RectifyKernel::rectifyRowGeneric(const QImage *original_pixels, QImage *rectified_pixels, const ResampleMap &resample_map, int row){
+    rectifyGenericSpan(original_pixels, rectified_pixels, resample_map, row, 0, resample_map.getRectifiedWidth());
+}
+
+void RectifyKernel::rectifyGenericSpan(const QImage *original_pixels, QImage *rectified_pixels, const ResampleMap &resample_map, int row, int first_column, int end_column){
+    //Same blend as rectifyRow(), but through QImage::pixel()/setPixel() so any format works
+    if(resample_map.getFilter() != ResampleFilter::Linear){
+        //Filtered maps go through the 32-bit tap kernel on a converted copy of the row
+        vector<QRgb> original_row(resample_map.getOriginalWidth());
+        vector<QRgb> rectified_row(resample_map.getRectifiedWidth());
+        for(int column = 0; column < resample_map.getOriginalWidth(); column++){
+            original_row[column] = original_pixels->pixel(column, row);
+        }
+        rectifyPixelSpan(original_row.data(), rectified_row.data(), resample_map, first_column, end_column);
+        for(int column = first_column; column < end_column; column++){
+            rectified_pixels->setPixel(column, row, rectified_row[column]);
+        }
+        return;
+    }
+    const int32_t *start_columns = resample_map.getStartColumns();
+    const int32_t *end_columns = resample_map.getEndColumns();
+    const uint32_t *weights = resample_map.getWeights();
+    const uint32_t *reciprocals = resample_map.getReciprocals();
+    for(int column = first_column; column < end_column; column++){
+        QRgb working_pixel = blendPixel(original_pixels->pixel(start_columns[column], row), original_pixels->pixel(end_columns[column], row), weights[column], reciprocals[column]);
+        rectified_pixels->setPixel(column, row, working_pixel);
+    }
+    for(int wide = 0; wide < resample_map.getWideColumnCount(); wide++){
+        int column = resample_map.getWideColumns()[wide];
+        if(column < first_column || column >= end_column){
+            continue;
+        }
+        QRgb working_pixel = dividePixel(original_pixels->pixel(start_columns[column], row), original_pixels->pixel(end_columns[column], row),
+                                         resample_map.getWideEndWeights()[wide], resample_map.getWideDeltas()[wide]);
+        rectified_pixels->setPixel(column, row, working_pixel);
+    }
+}
+
+void RectifyKernel::rectifyRows(const QImage *original_pixels, QImage *rectified_pixels, const ResampleMap &resample_map, int start_row, int end_row){
+    rectifyTile(original_pixels, rectified_pixels, resample_map, QRect(0, start_row, resample_map.getRectifiedWidth(), end_row - start_row));
+}
+
+void RectifyKernel::rectifyTile(const QImage *original_pixels, QImage *rectified_pixels, const ResampleMap &resample_map, const QRect &tile){
+    //Walk scanlines with the native kernel when both images share a format it handles, otherwise go through QImage::pixel()/setPixel()
+    int bytes_per_pixel = bytesPerPixelFor(original_pixels->format());
+    bool scanline_kernel = bytes_per_pixel != 0 && rectified_pixels->format() == original_pixels->format();
+    int first_column = max(tile.left(), 0);
+    int end_column = min(tile.left() + tile.width(), resample_map.getRectifiedWidth());
+    for(int row = tile.top(); row < tile.top() + tile.height(); row++){
+        if(scanline_kernel){
+            rectifySpan(original_pixels->constScanLine(row), rectified_pixels->scanLine(row), bytes_per_pixel, resample_map, first_column, end_column);
+        } else {
+            rectifyGenericSpan(original_pixels, rectified_pixels, resample_map, row, first_column, end_column);
+        }
+    }
+}
+
+void RectifyKernel::composeRow(const QImage *red_pixels, const QImage *green_pixels, const QImage *blue_pixels, QImage *composite_pixels, int row){
+    composeTile(red_pixels, green_pixels, blue_pixels, composite_pixels, QRect(0, row, composite_pixels->width(), 1));
+}
+
+void RectifyKernel::composeTile(const QImage *red_pixels, const QImage *green_pixels, const QImage *blue_pixels, QImage *composite_pixels, const QRect &tile){
+    //Pack a tile of three single channel images into an RGB32 composite
+    int first_column = max(tile.left(), 0);
+    int end_column = min(tile.left() + tile.width(), composite_pixels->width());
+    bool gray = red_pixels->format() == QImage::Format_Grayscale8 && green_pixels->format() == QImage::Format_Grayscale8 && blue_pixels->format() == QImage::Format_Grayscale8;
+    for(int row = tile.top(); row < tile.top() + tile.height(); row++){
+        QRgb *composite_row = reinterpret_cast<QRgb *>(composite_pixels->scanLine(row));
+        if(gray){
+            const uchar *red_row = red_pixels->constScanLine(row);
+            const uchar *green_row = green_pixels->constScanLine(row);
+            const uchar *blue_row = blue_pixels->constScanLine(row);
+            for(int column = first_column; column < end_column; column++){
+                composite_row[column] = qRgb(red_row[column], green_row[column], blue_row[column]);
+            }
+        } else {
+            //Channels stored in another format contribute their gray level
+            for(int column = first_column; column < end_column; column++){
+                composite_row[column] = qRgb(qGray(red_pixels->pixel(column, row)), qGray(green_pixels->pixel(column, row)), qGray(blue_pixels->pixel(column, row)));
+            }
+        }
+    }
+}
+
+void RectifyKernel::rectifyRowReference(const QImage *original_pixels, QImage *rectified_pixels, int rectified_width, const CorrectionTable &correction_factor, int row){
+    QRgb start_pixel, end_pixel, working_pixel;
+    working_pixel = 0;
+    int column_rectified;
+    double target_column;
+    int delta;
+    unsigned int working_color= 0;
+    unsigned int start_color = 0;
+    unsigned int end_color = 0;
+    //First pass, center to right side
+    //Push R, G, B onto the start_pixel vector from original_pixels at halfway point of original image
+    start_pixel = original_pixels->pixel((original_pixels->width() / 2), row);
+    //Calculate the current working column at halfway point of rectified image
+    column_rectified = static_cast<int>(rectified_width / 2);
+    //Calculate the target of widening
+    target_column = column_rectified;
+    for(int column_original = static_cast<int>((original_pixels->width() / 2)); column_original < original_pixels->width(); column_original++){ //From center to the right edge of the original picture
+        target_column += correction_factor[column_original]; //Add correction factor for column
+        end_pixel = original_pixels->pixel(column_original, row);
+        delta = static_cast<int>(target_column) - column_rectified; //Calculate the difference between the target column and current column
+        for(int i = 0; i < delta; i++){ //For each pixel between the current column of the original and the target column of the rectified..
+            working_color = (unsigned int)start_pixel >> 24; //Alpha value.. We don't mess with transparency, so we'll use the original
+            working_pixel = working_pixel | working_color; // Shift into the pixel ARGB value
+
+            start_color = (unsigned int)start_pixel >> 16 & 255; //Red color value of start pixel
+            end_color = (unsigned int)end_pixel >> 16 & 255; //Red color value of end pixel
+            working_color = ((start_color * (delta - i) + end_color * i) / delta); // Linearly interpolate red value
+            working_pixel = working_pixel << 8 | working_color; // Shift into the pixel ARGB value
+
+            start_color = (unsigned int)start_pixel >> 8 & 255; //Green color value of start pixel
+            end_color = (unsigned int)end_pixel >> 8 & 255; //Green color value of end pixel
+            working_color = ((start_color * (delta - i) + end_color * i) / delta); // Linearly interpolate green value
+            working_pixel = working_pixel << 8 | working_color; // Shift into the pixel ARGB value
+
+            start_color = (unsigned int)start_pixel & 255; //Blue color value of start pixel
+            end_color = (unsigned int)end_pixel & 255; //Blue color value of end pixel
+            working_color = ((start_color * (delta - i) + end_color * i) / delta); // Linearly interpolate blue value
+            working_pixel = working_pixel << 8 | working_color; // Shift into the pixel ARGB value
+
+            rectified_pixels->setPixel(column_rectified, row, working_pixel);
+
+            column_rectified++;
+        }
+        start_pixel = end_pixel;
+    }
+    //Second pass, center to left side
+    start_pixel = original_pixels->pixel((original_pixels->width() / 2), row);
+    column_rectified = static_cast<int>(rectified_width / 2);
+    target_column = column_rectified;
+    for(int column_original = static_cast<int>(original_pixels->width() / 2) -1; column_original > -1; column_original--){ //From center to left edge of the original picture
+        target_column -= correction_factor[column_original]; //Remove correction factor for column
+        end_pixel = original_pixels->pixel(column_original, row);
+        delta = column_rectified - static_cast<int>(target_column);
+        for(int i = 0; i < delta; i++){
+            working_color = (unsigned int)start_pixel >> 24; //Alpha value.. We don't mess with transparency, so we'll use the original
+            working_pixel = working_pixel | working_color; // Shift into the pixel ARGB value
+
+            start_color = (unsigned int)start_pixel >> 16 & 255; //Red color value of start pixel
+            end_color = (unsigned int)end_pixel >> 16 & 255; //Red color value of end pixel
+            working_color = ((start_color * (delta - i) + end_color * i) / delta); // Linearly interpolate red value
+            working_pixel = working_pixel << 8 | working_color; // Shift into the pixel ARGB value
+
+            start_color = (unsigned int)start_pixel >> 8 & 255; //Green color value of start pixel
+            end_color = (unsigned int)end_pixel >> 8 & 255; //Green color value of end pixel
+            working_color = ((start_color * (delta - i) + end_color * i) / delta); // Linearly interpolate green value
+            working_pixel = working_pixel << 8 | working_color; // Shift into the pixel ARGB value
+
+            start_color = (unsigned int)start_pixel & 255; //Blue color value of start pixel
+            end_color = (unsigned int)end_pixel & 255; //Blue color value of end pixel
+            working_color = ((start_color * (delta - i) + end_color * i) / delta); // Linearly interpolate blue value
+            working_pixel = working_pixel << 8 | working_color; // Shift into the pixel ARGB value
+            rectified_pixels->setPixel(column_rectified, row, working_pixel);
+            column_rectified--;
+        }
+        start_pixel = end_pixel;
+    }
+}
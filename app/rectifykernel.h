@@ -0,0 +1,45 @@
+//============================================================================
+// Name        : rectifykernel.h
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is the class definition of RectifyKernel. Special note
+//               is the reference row path, which is the original per-pixel
+//               implementation kept verbatim so the fast paths can always be
+//               checked against it, and that every format with a native row
+//               kernel works on its own bytes per pixel. Tiles and spans are
+//               given in rectified coordinates; the whole source row of every
+//               tile row has to be readable.
+//============================================================================
+
+#ifndef RECTIFYKERNEL_H
+#define RECTIFYKERNEL_H
+#include <QImage>
+#include <QRect>
+#include <vector>
+#include "correctiontable.h"
+#include "resamplemap.h"
+
+using namespace std;
+
+class RectifyKernel{
+private:
+    static QRgb blendPixel(QRgb start_pixel, QRgb end_pixel, uint32_t weight, uint32_t reciprocal);
+    static QRgb dividePixel(QRgb start_pixel, QRgb end_pixel, int end_weight, int delta);
+    static void rectifyPixelSpan(const QRgb *original_row, QRgb *rectified_row, const ResampleMap &resample_map, int first_column, int end_column);
+    static void rectifyGenericSpan(const QImage *original_pixels, QImage *rectified_pixels, const ResampleMap &resample_map, int row, int first_column, int end_column);
+public:
+    static int bytesPerPixelFor(QImage::Format format);
+    static bool isSupportedFormat(QImage::Format format);
+    static void rectifyRow(const QRgb *original_row, QRgb *rectified_row, const ResampleMap &resample_map);
+    static void rectifyRowBytes(const uchar *original_row, uchar *rectified_row, int bytes_per_pixel, const ResampleMap &resample_map);
+    static void rectifySpan(const uchar *original_row, uchar *rectified_row, int bytes_per_pixel, const ResampleMap &resample_map, int first_column, int end_column);
+    static void rectifyRowGeneric(const QImage *original_pixels, QImage *rectified_pixels, const ResampleMap &resample_map, int row);
+    static void rectifyRows(const QImage *original_pixels, QImage *rectified_pixels, const ResampleMap &resample_map, int start_row, int end_row);
+    static void rectifyTile(const QImage *original_pixels, QImage *rectified_pixels, const ResampleMap &resample_map, const QRect &tile);
+    static void composeRow(const QImage *red_pixels, const QImage *green_pixels, const QImage *blue_pixels, QImage *composite_pixels, int row);
+    static void composeTile(const QImage *red_pixels, const QImage *green_pixels, const QImage *blue_pixels, QImage *composite_pixels, const QRect &tile);
+    static void rectifyRowReference(const QImage *original_pixels, QImage *rectified_pixels, int rectified_width, const CorrectionTable &correction_factor, int row);
+};
+
+#endif // RECTIFYKERNEL_H
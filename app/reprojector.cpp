@@ -0,0 +1,307 @@
+//============================================================================
+// Name        : reprojector.cpp
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This class is responsible for putting a rectified pass onto
+//               a latitude/longitude grid, so passes can be overlaid on maps
+//               and on each other. Every row is a scan taken lineSeconds
+//               after the one before, from wherever the orbit puts the
+//               satellite then; every column is a fixed angle across the
+//               ground track, measured at the Earth's centre. Propagating
+//               the orbit for every pixel would take far too long, so the
+//               exact position is only worked out on a sparse control grid,
+//               every gridStep columns and rows. Each grid cell is split
+//               into two triangles, and the output pixels inside a triangle
+//               take their source position by interpolating its corners,
+//               which is as close as the grid is fine. The output is filled
+//               in bands of rows, on whichever pool threads are idle, with
+//               every band only visiting the triangles that reach into it.
+//               Longitudes are unwrapped from each grid point to the next,
+//               so a polar pass stays continuous even when it covers more
+//               than half the globe. Cells across the one jump left beside
+//               a pole are unwrapped on their own and drawn where they land;
+//               only a cell around the pole itself, whose corners no
+//               unwrapping can bring together, is left out rather than
+//               smeared across the output.
+//============================================================================
+
+#include "reprojector.h"
+#include "bufferpool.h"
+#include "idlethreads.h"
+#include "tracer.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <atomic>
+#include <cmath>
+#include <functional>
+
+static const double pi = 3.14159265358979323846;
+const double Reprojector::defaultLineSeconds = 0.1536;
+const double Reprojector::maxCellLongitudes = 180;
+
+//A control grid triangle, corners in output pixels (u, v) and source pixels (x, y)
+struct ReprojectTriangle{
+    double u[3];
+    double v[3];
+    double x[3];
+    double y[3];
+};
+
+static GeoPoint groundPoint(const Vector3 &nadir, const Vector3 &right, double angle){
+    //Turn the nadir direction towards the right of the track by the centre angle
+    Vector3 ground = nadir * cos(angle) + right * sin(angle);
+    return {asin(max(-1.0, min(1.0, ground.z))) * 180 / pi, atan2(ground.y, ground.x) * 180 / pi};
+}
+
+static void scanFrame(const Orbit &orbit, double secondsSinceEpoch, Vector3 *nadir, Vector3 *right){
+    //Nadir and across-track directions of one scan, the latter perpendicular to the ground track
+    Vector3 position;
+    Vector3 velocity;
+    orbit.stateAt(secondsSinceEpoch, &position, &velocity);
+    *nadir = position.normalized();
+    *right = velocity.cross(*nadir).normalized();
+}
+
+static vector<int> gridLines(int size, int step){
+    //Every step-th line, always ending on the last one
+    vector<int> lines;
+    for(int line = 0; line < size - 1; line += step){
+        lines.push_back(line);
+    }
+    lines.push_back(size - 1);
+    return lines;
+}
+
+Reprojector::Reprojector(const Orbit &orbit, const QDateTime &startTime): orbit(orbit), startTime(startTime), lineSeconds(defaultLineSeconds){
+}
+
+GeoPoint Reprojector::locate(double column, double row, int width) const{
+    //Exact position of a rectified pixel centre
+    double seconds = this->orbit.getElements().epoch.msecsTo(this->startTime) / 1000.0 + row * this->lineSeconds;
+    Vector3 nadir;
+    Vector3 right;
+    scanFrame(this->orbit, seconds, &nadir, &right);
+    double angle = ((column + 0.5) / width - 0.5) * this->satelliteSwath / this->earthRadius;
+    return groundPoint(nadir, right, angle);
+}
+
+ControlGrid Reprojector::controlGrid(int width, int height) const{
+    //One orbit state per grid row, longitudes unwrapped against neighbouring points so the grid only jumps by 360 next to a pole
+    ControlGrid grid;
+    if(width < 1 || height < 1){
+        return grid;
+    }
+    grid.columns = gridLines(width, this->gridStep);
+    grid.rows = gridLines(height, this->gridStep);
+    grid.points.reserve(grid.columns.size() * grid.rows.size());
+    double start = this->orbit.getElements().epoch.msecsTo(this->startTime) / 1000.0;
+    double swath_angle = this->satelliteSwath / this->earthRadius;
+    //A polar pass can cover more than 180 degrees of longitude, so only neighbours are close enough to unwrap against.
+    //Each row is unwrapped outwards from the ground track, which never comes near a pole, and the track from row to row
+    int grid_columns = static_cast<int>(grid.columns.size());
+    int centre = grid_columns / 2;
+    vector<GeoPoint> row_points(grid_columns);
+    for(int row : grid.rows){
+        Vector3 nadir;
+        Vector3 right;
+        scanFrame(this->orbit, start + row * this->lineSeconds, &nadir, &right);
+        for(int index = 0; index < grid_columns; index++){
+            row_points[index] = groundPoint(nadir, right, ((grid.columns[index] + 0.5) / width - 0.5) * swath_angle);
+        }
+        if(!grid.points.empty()){
+            const GeoPoint &above = grid.points[grid.points.size() - grid_columns + centre];
+            row_points[centre].longitude += 360 * round((above.longitude - row_points[centre].longitude) / 360);
+        }
+        for(int index = centre + 1; index < grid_columns; index++){
+            row_points[index].longitude += 360 * round((row_points[index - 1].longitude - row_points[index].longitude) / 360);
+        }
+        for(int index = centre - 1; index >= 0; index--){
+            row_points[index].longitude += 360 * round((row_points[index + 1].longitude - row_points[index].longitude) / 360);
+        }
+        grid.points.insert(grid.points.end(), row_points.begin(), row_points.end());
+    }
+    return grid;
+}
+
+Reprojection Reprojector::reproject(const QImage &rectifiedImage, bool bottomUp, QThreadPool *pool) const{
+    TraceScope trace("Reprojector::reproject");
+    //Sample straight from the formats the row kernel writes, anything else is converted once
+    QImage source = rectifiedImage;
+    switch(source.format()){
+    case QImage::Format_Grayscale8:
+    case QImage::Format_RGB888:
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        break;
+    default:
+        source = source.convertToFormat(source.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+        break;
+    }
+    int width = source.width();
+    int height = source.height();
+    if(width < 2 || height < 2){
+        throw string("The image is too small to reproject");
+    }
+
+    //Size the output around the grid, at about the rectified image's own resolution unless told otherwise
+    ControlGrid grid = this->controlGrid(width, height);
+    Reprojection reprojection;
+    reprojection.degreesPerPixel = this->degreesPerPixel > 0 ? this->degreesPerPixel : this->satelliteSwath / this->earthRadius / width * 180 / pi;
+    double west = grid.points.front().longitude;
+    double east = west;
+    double north = grid.points.front().latitude;
+    double south = north;
+    for(const GeoPoint &point : grid.points){
+        west = min(west, point.longitude);
+        east = max(east, point.longitude);
+        north = max(north, point.latitude);
+        south = min(south, point.latitude);
+    }
+    reprojection.west = west;
+    reprojection.north = north;
+    double degrees = reprojection.degreesPerPixel;
+    qint64 output_width = static_cast<qint64>(floor((east - west) / degrees)) + 1;
+    qint64 output_height = static_cast<qint64>(floor((north - south) / degrees)) + 1;
+    if(output_width * output_height > maxOutputPixels){
+        throw string("The reprojected image would be too large, pick a coarser resolution");
+    }
+    reprojection.image = BufferPool::instance().acquireImage(static_cast<int>(output_width), static_cast<int>(output_height), source.format());
+    if(reprojection.image.isNull()){
+        throw string("Unable to allocate the reprojected image");
+    }
+    if(source.hasAlphaChannel()){
+        reprojection.image.fill(0);
+    } else {
+        reprojection.image.fill(Qt::black);
+    }
+
+    //Two triangles per grid cell, each listed in every band of output rows it reaches
+    int bands = static_cast<int>((output_height + bandRows - 1) / bandRows);
+    vector<ReprojectTriangle> triangles;
+    vector<vector<int>> bandTriangles(bands);
+    int grid_columns = static_cast<int>(grid.columns.size());
+    const int corners[2][3][2] = {{{0, 0}, {1, 0}, {1, 1}}, {{0, 0}, {1, 1}, {0, 1}}};
+    for(int grid_row = 0; grid_row + 1 < static_cast<int>(grid.rows.size()); grid_row++){
+        for(int grid_column = 0; grid_column + 1 < grid_columns; grid_column++){
+            for(const auto &triangle_corners : corners){
+                ReprojectTriangle triangle;
+                double longitudes[3];
+                double top = 1e300;
+                double bottom = -1e300;
+                for(int corner = 0; corner < 3; corner++){
+                    int corner_column = grid_column + triangle_corners[corner][0];
+                    int corner_row = grid_row + triangle_corners[corner][1];
+                    const GeoPoint &point = grid.at(corner_column, corner_row);
+                    //Corners are unwrapped against the first one, which mends the cells across the grid's jump beside a pole
+                    longitudes[corner] = corner == 0 ? point.longitude : point.longitude + 360 * round((longitudes[0] - point.longitude) / 360);
+                    triangle.v[corner] = (north - point.latitude) / degrees;
+                    triangle.x[corner] = grid.columns[corner_column];
+                    triangle.y[corner] = grid.rows[corner_row];
+                    top = min(top, triangle.v[corner]);
+                    bottom = max(bottom, triangle.v[corner]);
+                }
+                double leftmost = min(longitudes[0], min(longitudes[1], longitudes[2]));
+                double rightmost = max(longitudes[0], max(longitudes[1], longitudes[2]));
+                //A cell around the pole itself has no consistent longitudes, it would be smeared across the whole output
+                if(rightmost - leftmost > maxCellLongitudes){
+                    continue;
+                }
+                //Mended cells may sit a turn away from the rest, and an output wider than a turn shows some places twice
+                for(int turn = -1; turn <= 1; turn++){
+                    if(rightmost + 360 * turn < west || leftmost + 360 * turn > east){
+                        continue;
+                    }
+                    for(int corner = 0; corner < 3; corner++){
+                        triangle.u[corner] = (longitudes[corner] + 360 * turn - west) / degrees;
+                    }
+                    int index = static_cast<int>(triangles.size());
+                    triangles.push_back(triangle);
+                    int first_band = max(0, static_cast<int>(ceil(top)) / bandRows);
+                    int last_band = min(bands - 1, static_cast<int>(floor(bottom)) / bandRows);
+                    for(int band = first_band; band <= last_band; band++){
+                        bandTriangles[band].push_back(index);
+                    }
+                }
+            }
+        }
+    }
+
+    //Fill the bands, each output pixel inside a triangle sampling the source bilinearly at its interpolated position
+    const uchar *source_pixels = source.constBits();
+    int source_bytes_per_line = source.bytesPerLine();
+    int bytes_per_pixel = source.depth() / 8;
+    uchar *output_pixels = reprojection.image.bits();
+    int output_bytes_per_line = reprojection.image.bytesPerLine();
+    int columns = reprojection.image.width();
+    atomic<int> nextBand{0};
+    function<void()> work = [&](){
+        for(int band = nextBand.fetch_add(1); band < bands; band = nextBand.fetch_add(1)){
+            int band_first_row = band * bandRows;
+            int band_end_row = static_cast<int>(min<qint64>(output_height, band_first_row + bandRows));
+            for(int index : bandTriangles[band]){
+                const ReprojectTriangle &triangle = triangles[index];
+                const double *u = triangle.u;
+                const double *v = triangle.v;
+                double denominator = (v[1] - v[2]) * (u[0] - u[2]) + (u[2] - u[1]) * (v[0] - v[2]);
+                if(fabs(denominator) < 1e-12){
+                    continue;
+                }
+                int first_row = max(band_first_row, static_cast<int>(ceil(min(v[0], min(v[1], v[2])))));
+                int end_row = min(band_end_row, static_cast<int>(floor(max(v[0], max(v[1], v[2])))) + 1);
+                int first_column = max(0, static_cast<int>(ceil(min(u[0], min(u[1], u[2])))));
+                int end_column = min(columns, static_cast<int>(floor(max(u[0], max(u[1], u[2])))) + 1);
+                for(int row = first_row; row < end_row; row++){
+                    uchar *output_row = output_pixels + static_cast<qint64>(row) * output_bytes_per_line;
+                    for(int column = first_column; column < end_column; column++){
+                        double weight_0 = ((v[1] - v[2]) * (column - u[2]) + (u[2] - u[1]) * (row - v[2])) / denominator;
+                        double weight_1 = ((v[2] - v[0]) * (column - u[2]) + (u[0] - u[2]) * (row - v[2])) / denominator;
+                        double weight_2 = 1 - weight_0 - weight_1;
+                        if(weight_0 < -1e-9 || weight_1 < -1e-9 || weight_2 < -1e-9){
+                            continue;
+                        }
+                        double x = weight_0 * triangle.x[0] + weight_1 * triangle.x[1] + weight_2 * triangle.x[2];
+                        double y = weight_0 * triangle.y[0] + weight_1 * triangle.y[1] + weight_2 * triangle.y[2];
+                        x = max(0.0, min(x, width - 1.0));
+                        y = max(0.0, min(y, height - 1.0));
+                        int left = static_cast<int>(x);
+                        int top = static_cast<int>(y);
+                        int right = min(left + 1, width - 1);
+                        int bottom = min(top + 1, height - 1);
+                        double x_weight = x - left;
+                        double y_weight = y - top;
+                        if(bottomUp){
+                            top = height - 1 - top;
+                            bottom = height - 1 - bottom;
+                        }
+                        const uchar *top_row = source_pixels + static_cast<qint64>(top) * source_bytes_per_line;
+                        const uchar *bottom_row = source_pixels + static_cast<qint64>(bottom) * source_bytes_per_line;
+                        uchar *output = output_row + column * bytes_per_pixel;
+                        for(int channel = 0; channel < bytes_per_pixel; channel++){
+                            double upper = top_row[left * bytes_per_pixel + channel] + (top_row[right * bytes_per_pixel + channel] - top_row[left * bytes_per_pixel + channel]) * x_weight;
+                            double lower = bottom_row[left * bytes_per_pixel + channel] + (bottom_row[right * bytes_per_pixel + channel] - bottom_row[left * bytes_per_pixel + channel]) * x_weight;
+                            output[channel] = static_cast<uchar>(upper + (lower - upper) * y_weight + 0.5);
+                        }
+                    }
+                }
+            }
+        }
+    };
+    runOnIdleThreads(pool, bands - 1, work);
+    return reprojection;
+}
+
+void Reprojection::writeWorldFile(const string &imagePath) const{
+    //ESRI world file next to the image: pixel size, rotation terms and the centre of the top left pixel
+    QFileInfo imageInfo(QString::fromStdString(imagePath));
+    QFile file(imageInfo.dir().filePath(imageInfo.completeBaseName() + ".wld"));
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)){
+        throw string("The world file was unable to be saved");
+    }
+    QTextStream stream(&file);
+    stream << QString::number(this->degreesPerPixel, 'g', 12) << "\n0\n0\n" << QString::number(-this->degreesPerPixel, 'g', 12) << "\n"
+           << QString::number(this->west, 'g', 12) << "\n" << QString::number(this->north, 'g', 12) << "\n";
+}
@@ -0,0 +1,77 @@
+//============================================================================
+// Name        : reprojector.h
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is the class definition of Reprojector, along with the
+//               ControlGrid it geolocates and the Reprojection it produces.
+//               Special note is that it works on rectified images: their
+//               columns are taken to be evenly spread over the swath, as
+//               CorrectionFactor makes them, and column 0 lies left of the
+//               direction of flight. Latitudes are geocentric, on a sphere
+//               of the same radius the rectification uses.
+//============================================================================
+
+#ifndef REPROJECTOR_H
+#define REPROJECTOR_H
+#include <QDateTime>
+#include <QImage>
+#include <QThreadPool>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "orbit.h"
+
+using namespace std;
+
+struct GeoPoint{
+    double latitude; //Degrees
+    double longitude; //Degrees, kept continuous across the antimeridian within a grid
+};
+
+//Exact geolocation of every gridStep-th column and row, plus the last ones
+struct ControlGrid{
+    vector<int> columns;
+    vector<int> rows;
+    vector<GeoPoint> points; //Row major, rows.size() by columns.size()
+    const GeoPoint &at(int gridColumn, int gridRow) const {return this->points[gridRow * this->columns.size() + gridColumn];}
+};
+
+//An equirectangular image, pixel (0, 0) centred on west, north
+struct Reprojection{
+    QImage image;
+    double west;
+    double north;
+    double degreesPerPixel;
+    void writeWorldFile(const string &imagePath) const;
+};
+
+class Reprojector{
+private:
+    Orbit orbit;
+    QDateTime startTime; //UTC time of the first row
+    double lineSeconds;
+    double earthRadius = 6371.0;
+    int satelliteSwath = 2800;
+    int gridStep = defaultGridStep;
+    double degreesPerPixel = 0; //0 matches the rectified image's own resolution
+public:
+    static const double defaultLineSeconds; //MSU-MR scan period
+    static const int defaultGridStep = 32;
+    static const int bandRows = 64; //Output rows each thread fills at a time
+    static const qint64 maxOutputPixels = 1 << 28;
+    static const double maxCellLongitudes; //Grid triangles spanning more degrees of longitude are left out
+    Reprojector(const Orbit &orbit, const QDateTime &startTime);
+    void setStartTime(const QDateTime &startTime){this->startTime = startTime;}
+    void setLineSeconds(double lineSeconds){this->lineSeconds = lineSeconds;}
+    void setEarthRadius(double earthRadius){this->earthRadius = earthRadius;}
+    void setSatelliteSwath(int satelliteSwath){this->satelliteSwath = satelliteSwath;}
+    void setGridStep(int gridStep){this->gridStep = max(1, gridStep);}
+    void setDegreesPerPixel(double degreesPerPixel){this->degreesPerPixel = degreesPerPixel;}
+    int getGridStep() const {return this->gridStep;}
+    GeoPoint locate(double column, double row, int width) const;
+    ControlGrid controlGrid(int width, int height) const;
+    Reprojection reproject(const QImage &rectifiedImage, bool bottomUp = false, QThreadPool *pool = QThreadPool::globalInstance()) const;
+};
+
+#endif // REPROJECTOR_H
@@ -0,0 +1,206 @@
+//============================================================================
+// Name        : resamplemap.cpp
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This class is responsible for turning a correction factor
+//               vector into a column resampling map. It walks the columns
+//               exactly like the original per-pixel loop did, from the
+//               center to the right and then from the center to the left,
+//               accumulating the correction factors in the same order and
+//               precision. Instead of writing pixels, it records for each
+//               rectified column which two original columns get blended and
+//               with what weights. This is done once per parameter set, so
+//               the per-row work is reduced to a gather and a blend.
+//
+//               Weights are stored so that the blend of a channel is
+//               ((start * startWeight + end * endWeight) * reciprocal) >> 32
+//               which is exactly the truncated integer division of the
+//               original code. Spans wider than maxFixedPointDelta are
+//               listed separately and divided the slow way.
+//
+//               The cubic (Catmull-Rom) and Lanczos-3 filters sample the
+//               same source positions the linear blend interpolates between,
+//               but over 4 or 6 taps. The fractional part of each position
+//               is quantised to filterPhaseCount phases and the weights of
+//               every phase are computed once into a bank, so rows never
+//               evaluate the kernel. An extra all-zero phase keeps unmapped
+//               columns black like the linear path.
+//============================================================================
+
+#include "resamplemap.h"
+#include "tracer.h"
+#include <cmath>
+
+static const double pi = 3.14159265358979323846;
+
+const int ResampleMap::filterPadding;
+
+ResampleMap::ResampleMap(int originalWidth, int rectifiedWidth, const CorrectionTable &correctionFactor, ResampleFilter filter){
+    TraceScope trace("ResampleMap::ResampleMap");
+    this->originalWidth = originalWidth;
+    this->rectifiedWidth = rectifiedWidth;
+    this->filter = filter;
+
+    //Walk the original loop once, remembering the last write to each rectified column
+    vector<int32_t> columnStart(rectifiedWidth, 0);
+    vector<int32_t> columnEnd(rectifiedWidth, 0);
+    vector<int32_t> columnEndWeight(rectifiedWidth, 0);
+    vector<int32_t> columnDelta(rectifiedWidth, 0); //0 marks a column that is never written
+    int start_column;
+    int column_rectified;
+    double target_column;
+    int delta;
+
+    //First pass, center to right side
+    start_column = originalWidth / 2;
+    column_rectified = static_cast<int>(rectifiedWidth / 2);
+    target_column = column_rectified;
+    for(int column_original = originalWidth / 2; column_original < originalWidth; column_original++){
+        target_column += correctionFactor[column_original]; //Add correction factor for column
+        delta = static_cast<int>(target_column) - column_rectified;
+        for(int i = 0; i < delta; i++){
+            if(column_rectified >= 0 && column_rectified < rectifiedWidth){
+                columnStart[column_rectified] = start_column;
+                columnEnd[column_rectified] = column_original;
+                columnEndWeight[column_rectified] = i;
+                columnDelta[column_rectified] = delta;
+            }
+            column_rectified++;
+        }
+        start_column = column_original;
+    }
+    //Second pass, center to left side
+    start_column = originalWidth / 2;
+    column_rectified = static_cast<int>(rectifiedWidth / 2);
+    target_column = column_rectified;
+    for(int column_original = originalWidth / 2 - 1; column_original > -1; column_original--){
+        target_column -= correctionFactor[column_original]; //Remove correction factor for column
+        delta = column_rectified - static_cast<int>(target_column);
+        for(int i = 0; i < delta; i++){
+            if(column_rectified >= 0 && column_rectified < rectifiedWidth){
+                columnStart[column_rectified] = start_column;
+                columnEnd[column_rectified] = column_original;
+                columnEndWeight[column_rectified] = i;
+                columnDelta[column_rectified] = delta;
+            }
+            column_rectified--;
+        }
+        start_column = column_original;
+    }
+
+    //Pack into the struct-of-arrays form used by the row kernels
+    this->startColumns.resize(rectifiedWidth);
+    this->endColumns.resize(rectifiedWidth);
+    this->weights.resize(rectifiedWidth);
+    this->reciprocals.resize(rectifiedWidth);
+    for(int column = 0; column < rectifiedWidth; column++){
+        uint32_t denominator = columnDelta[column];
+        uint32_t endWeight = columnEndWeight[column];
+        uint32_t startWeight = denominator - endWeight;
+        this->startColumns[column] = columnStart[column];
+        this->endColumns[column] = columnEnd[column];
+        if(denominator == 0 || static_cast<int>(denominator) > maxFixedPointDelta){
+            //Unmapped columns blend to zero, wide ones are fixed up afterwards by division
+            this->weights[column] = 0;
+            this->reciprocals[column] = 0;
+            if(denominator != 0){
+                this->wideColumns.push_back(column);
+                this->wideEndWeights.push_back(endWeight);
+                this->wideDeltas.push_back(denominator);
+            }
+            continue;
+        }
+        if(denominator == 1){ //2^32 does not fit the reciprocal, so scale the fraction to 2 / 2
+            startWeight = 2;
+            denominator = 2;
+        }
+        this->weights[column] = startWeight | (endWeight << 16);
+        this->reciprocals[column] = static_cast<uint32_t>((UINT64_C(0x100000000) + denominator - 1) / denominator);
+    }
+    if(filter != ResampleFilter::Linear){
+        this->buildFilterBank(columnStart, columnEnd, columnEndWeight, columnDelta);
+    }
+}
+
+int ResampleMap::tapsFor(ResampleFilter filter){
+    switch(filter){
+    case ResampleFilter::Cubic:
+        return 4;
+    case ResampleFilter::Lanczos3:
+        return 6;
+    default:
+        return 2;
+    }
+}
+
+double ResampleMap::filterKernel(ResampleFilter filter, double distance){
+    //Weight of a tap at the given distance from the sampled position
+    distance = fabs(distance);
+    if(filter == ResampleFilter::Cubic){
+        if(distance < 1.0){
+            return 1.5 * distance * distance * distance - 2.5 * distance * distance + 1.0;
+        }
+        if(distance < 2.0){
+            return -0.5 * distance * distance * distance + 2.5 * distance * distance - 4.0 * distance + 2.0;
+        }
+        return 0.0;
+    }
+    if(distance < 1e-9){
+        return 1.0;
+    }
+    if(distance >= 3.0){
+        return 0.0;
+    }
+    double x = pi * distance;
+    return 3.0 * sin(x) * sin(x / 3.0) / (x * x);
+}
+
+void ResampleMap::buildFilterBank(const vector<int32_t> &columnStart, const vector<int32_t> &columnEnd, const vector<int32_t> &columnEndWeight, const vector<int32_t> &columnDelta){
+    int taps = tapsFor(this->filter);
+    int leadingTaps = taps / 2 - 1; //Taps left of the integer part of the position
+    this->filterTaps = taps;
+
+    //One row of weights per phase, rounded so every row sums to exactly one
+    this->filterBank.assign((filterPhaseCount + 1) * taps, 0);
+    for(int phase = 0; phase < filterPhaseCount; phase++){
+        double fraction = static_cast<double>(phase) / filterPhaseCount;
+        int16_t *row = &this->filterBank[phase * taps];
+        double sum = 0.0;
+        double values[8];
+        for(int tap = 0; tap < taps; tap++){
+            values[tap] = filterKernel(this->filter, tap - leadingTaps - fraction);
+            sum += values[tap];
+        }
+        int total = 0;
+        int largest = 0;
+        for(int tap = 0; tap < taps; tap++){
+            row[tap] = static_cast<int16_t>(lround(values[tap] / sum * (1 << filterPrecision)));
+            total += row[tap];
+            if(row[tap] > row[largest]){
+                largest = tap;
+            }
+        }
+        row[largest] += (1 << filterPrecision) - total;
+    }
+
+    //Each rectified column samples the position the linear blend would have interpolated
+    this->filterColumns.resize(this->rectifiedWidth);
+    this->filterPhases.resize(this->rectifiedWidth);
+    for(int column = 0; column < this->rectifiedWidth; column++){
+        if(columnDelta[column] == 0){
+            this->filterColumns[column] = 0;
+            this->filterPhases[column] = filterPhaseCount;
+            continue;
+        }
+        double position = columnStart[column] + static_cast<double>(columnEnd[column] - columnStart[column]) * columnEndWeight[column] / columnDelta[column];
+        int base = static_cast<int>(floor(position));
+        int phase = static_cast<int>(lround((position - base) * filterPhaseCount));
+        if(phase == filterPhaseCount){
+            base++;
+            phase = 0;
+        }
+        this->filterColumns[column] = base - leadingTaps + filterPadding;
+        this->filterPhases[column] = phase;
+    }
+}
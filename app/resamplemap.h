@@ -0,0 +1,70 @@
+//============================================================================
+// Name        : resamplemap.h
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is the class definition of ResampleMap. Special note
+//               is that every array is indexed by rectified column, so a
+//               row can be produced by a straight gather from the original
+//               row without carrying any state from pixel to pixel. The cubic
+//               and Lanczos-3 filters share one small polyphase bank, each
+//               column only stores its first tap and which phase it uses.
+//============================================================================
+
+#ifndef RESAMPLEMAP_H
+#define RESAMPLEMAP_H
+#include <cstdint>
+#include <vector>
+#include "correctiontable.h"
+
+using namespace std;
+
+enum class ResampleFilter{
+    Linear,
+    Cubic,
+    Lanczos3
+};
+
+class ResampleMap{
+private:
+    int originalWidth;
+    int rectifiedWidth;
+    ResampleFilter filter;
+    vector<int32_t> startColumns; //Original column blended from, per rectified column
+    vector<int32_t> endColumns; //Original column blended towards, per rectified column
+    vector<uint32_t> weights; //Start weight in the low 16 bits, end weight in the high 16 bits
+    vector<uint32_t> reciprocals; //0.32 fixed point reciprocal of the blend denominator, 0 for unmapped columns
+    vector<int32_t> wideColumns; //Rectified columns whose span is too wide for the fixed point weights
+    vector<int32_t> wideEndWeights;
+    vector<int32_t> wideDeltas;
+    int filterTaps = 0;
+    vector<int32_t> filterColumns; //First tap per rectified column, as an index into the row padded by filterPadding
+    vector<int32_t> filterPhases; //Row of the filter bank per rectified column, filterPhaseCount for unmapped columns
+    vector<int16_t> filterBank; //filterTaps weights per phase, each row summing to 1 << filterPrecision
+    static double filterKernel(ResampleFilter filter, double distance);
+    void buildFilterBank(const vector<int32_t> &columnStart, const vector<int32_t> &columnEnd, const vector<int32_t> &columnEndWeight, const vector<int32_t> &columnDelta);
+public:
+    static const int maxFixedPointDelta = 4096; //Largest span the reciprocal stays exact for (255 * d * d < 2^32)
+    static const int filterPhaseCount = 64; //Sub-pixel positions the filter weights are quantised to
+    static const int filterPrecision = 14; //Fraction bits of the filter weights
+    static const int filterPadding = 4; //Edge pixels replicated on either side of a row, enough for the widest filter
+    ResampleMap(int originalWidth, int rectifiedWidth, const CorrectionTable &correctionFactor, ResampleFilter filter = ResampleFilter::Linear);
+    static int tapsFor(ResampleFilter filter);
+    int getOriginalWidth() const {return this->originalWidth;}
+    int getRectifiedWidth() const {return this->rectifiedWidth;}
+    ResampleFilter getFilter() const {return this->filter;}
+    const int32_t *getStartColumns() const {return this->startColumns.data();}
+    const int32_t *getEndColumns() const {return this->endColumns.data();}
+    const uint32_t *getWeights() const {return this->weights.data();}
+    const uint32_t *getReciprocals() const {return this->reciprocals.data();}
+    int getWideColumnCount() const {return static_cast<int>(this->wideColumns.size());}
+    const int32_t *getWideColumns() const {return this->wideColumns.data();}
+    const int32_t *getWideEndWeights() const {return this->wideEndWeights.data();}
+    const int32_t *getWideDeltas() const {return this->wideDeltas.data();}
+    int getFilterTaps() const {return this->filterTaps;}
+    const int32_t *getFilterColumns() const {return this->filterColumns.data();}
+    const int32_t *getFilterPhases() const {return this->filterPhases.data();}
+    const int16_t *getFilterBank() const {return this->filterBank.data();}
+};
+
+#endif // RESAMPLEMAP_H
@@ -0,0 +1,251 @@
+//============================================================================
+// Name        : rowscheduler.cpp
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This class is responsible for handing out rows to the
+//               rectification workers. Every submitted image is cut into
+//               chunks sized from its height and the worker count, aiming
+//               for several chunks per worker so the last few finish close
+//               together. Workers take chunks round robin across all queued
+//               images, which lets a batch of small images share the cores
+//               instead of waiting on each other in turn. Claiming a chunk
+//               is a few instructions under a short lock; the rows themselves
+//               are rectified without any locking. Cancelling a job's future
+//               stops new chunks from being handed out, and the future only
+//               reports finished once the chunks already claimed are done,
+//               so the caller can reuse the output as soon as it returns.
+//               When an image has too few rows to give every worker several
+//               chunks, each row chunk is also cut into column bands of at
+//               least minTileColumns, which the gather kernels fill on their
+//               own since no rectified column depends on its neighbours.
+//               Progress is still counted in rows, once all bands of a row
+//               chunk are done.
+//============================================================================
+
+#include "rowscheduler.h"
+#include <QMutexLocker>
+#include <algorithm>
+#include <string>
+#include "rectifythread.h"
+#include "tracer.h"
+
+const int RowScheduler::minChunkRows;
+const int RowScheduler::maxChunkRows;
+const int RowScheduler::minTileColumns;
+
+void CompletedRows::add(int startRow, int endRow){
+    QMutexLocker locker(&this->mutex);
+    this->ranges.push_back(make_pair(startRow, endRow));
+}
+
+vector<pair<int, int>> CompletedRows::take(){
+    //Hand over everything logged so far, neighbouring chunks merged into one range
+    vector<pair<int, int>> ranges;
+    {
+        QMutexLocker locker(&this->mutex);
+        ranges.swap(this->ranges);
+    }
+    sort(ranges.begin(), ranges.end());
+    vector<pair<int, int>> merged;
+    for(const pair<int, int> &range : ranges){
+        if(!merged.empty() && range.first <= merged.back().second){
+            merged.back().second = max(merged.back().second, range.second);
+        } else {
+            merged.push_back(range);
+        }
+    }
+    return merged;
+}
+
+RowScheduler::RowScheduler(QThreadPool *threadPool){
+    this->threadPool = threadPool;
+}
+
+RowScheduler::~RowScheduler(){
+    //Workers hold a pointer to the scheduler, so it has to outlive them
+    this->waitForIdle();
+}
+
+int RowScheduler::chunkRowsFor(int rows, int workers){
+    //Several chunks per worker, but never so small the claims start to show
+    workers = max(1, workers);
+    int chunkRows = (rows + workers * chunksPerWorker - 1) / (workers * chunksPerWorker);
+    return min(max(chunkRows, minChunkRows), maxChunkRows);
+}
+
+int RowScheduler::tileColumnsFor(int columns, int rows, int workers){
+    //Full width while the rows alone make enough chunks, otherwise enough bands to make up for them
+    workers = max(1, workers);
+    int chunkRows = chunkRowsFor(rows, workers);
+    int rowChunks = max(1, (rows + chunkRows - 1) / chunkRows);
+    int wantedChunks = workers * chunksPerWorker;
+    if(rowChunks >= wantedChunks || columns <= minTileColumns){
+        return max(columns, 1);
+    }
+    int bands = min((wantedChunks + rowChunks - 1) / rowChunks, columns / minTileColumns);
+    return (columns + bands - 1) / max(bands, 1);
+}
+
+void RowScheduler::setMaxWorkers(int maxWorkers){
+    QMutexLocker locker(&this->jobMutex);
+    this->maxWorkers = max(0, maxWorkers);
+}
+
+int RowScheduler::getMaxWorkers() const{
+    if(this->maxWorkers > 0){
+        return this->maxWorkers;
+    }
+    return max(1, this->threadPool->maxThreadCount());
+}
+
+QFuture<void> RowScheduler::submit(const QImage *originalImage, QImage *rectifiedImage, shared_ptr<const ResampleMap> resampleMap, int rows, atomic<int> *rowsCompleted,
+                                   CompletedRows *completedRows){
+    return this->submitChannels({originalImage}, {rectifiedImage}, nullptr, {{0, 1, 2}}, resampleMap, rows, rowsCompleted, completedRows);
+}
+
+QFuture<void> RowScheduler::submitRegion(const QImage *originalImage, QImage *rectifiedImage, shared_ptr<const ResampleMap> resampleMap, const QRect &region, atomic<int> *rowsCompleted){
+    //Rectify only the part of the output inside region, clipped to the rectified image
+    shared_ptr<RowJob> job = make_shared<RowJob>();
+    job->originalImages = {originalImage};
+    job->rectifiedImages = {rectifiedImage};
+    job->resampleMap = resampleMap;
+    job->region = region.intersected(QRect(0, 0, resampleMap->getRectifiedWidth(), rectifiedImage->height()));
+    job->rowsCompleted = rowsCompleted;
+    return this->enqueue(job);
+}
+
+QFuture<void> RowScheduler::submitChannels(const vector<const QImage *> &originalImages, const vector<QImage *> &rectifiedImages, QImage *compositeImage, array<int, 3> compositeChannels,
+                                           shared_ptr<const ResampleMap> resampleMap, int rows, atomic<int> *rowsCompleted, CompletedRows *completedRows){
+    if(originalImages.size() != rectifiedImages.size()){
+        throw string("Every channel needs its own rectified image");
+    }
+    if(compositeImage != nullptr){
+        if(compositeImage->format() != QImage::Format_RGB32){
+            throw string("The composite image has to be RGB32");
+        }
+        for(int channel : compositeChannels){
+            if(channel < 0 || channel >= static_cast<int>(rectifiedImages.size())){
+                throw string("Composite channel out of range");
+            }
+        }
+    }
+    shared_ptr<RowJob> job = make_shared<RowJob>();
+    job->originalImages = originalImages;
+    job->rectifiedImages = rectifiedImages;
+    job->compositeImage = compositeImage;
+    job->compositeChannels = compositeChannels;
+    job->resampleMap = resampleMap;
+    job->region = QRect(0, 0, resampleMap->getRectifiedWidth(), max(rows, 0));
+    job->rowsCompleted = rowsCompleted;
+    job->completedRows = completedRows;
+    return this->enqueue(job);
+}
+
+QFuture<void> RowScheduler::enqueue(shared_ptr<RowJob> job){
+    //Cut the job's region into tiles and queue it
+    job->traceStartNs = Tracer::instance().isEnabled() ? Tracer::instance().now() : -1;
+    job->futureInterface.reportStarted();
+    QFuture<void> future = job->futureInterface.future();
+    if(job->region.isEmpty()){
+        job->futureInterface.reportFinished();
+        return future;
+    }
+
+    QMutexLocker locker(&this->jobMutex);
+    int workers = this->getMaxWorkers();
+    int rows = job->region.height();
+    job->chunkRows = chunkRowsFor(rows, workers);
+    job->tileColumns = tileColumnsFor(job->region.width(), rows, workers);
+    job->bands = (job->region.width() + job->tileColumns - 1) / job->tileColumns;
+    int rowChunks = (rows + job->chunkRows - 1) / job->chunkRows;
+    job->tiles = rowChunks * job->bands;
+    job->bandsLeft.assign(rowChunks, job->bands);
+    this->jobs.push_back(job);
+
+    //Only start as many workers as are missing, running ones pick the new job up on their next claim
+    int newWorkers = min(workers - this->activeWorkers, job->tiles);
+    for(int worker = 0; worker < newWorkers; worker++){
+        RectifyThread *rectifyThread = new RectifyThread(this);
+        rectifyThread->setAutoDelete(true);
+        this->activeWorkers++;
+        this->threadPool->start(rectifyThread);
+    }
+    return future;
+}
+
+void RowScheduler::finishJob(RowJob *job){
+    //Called with the job mutex held, once nothing of the job is left running
+    if(!job->finished){
+        if(job->traceStartNs >= 0){
+            Tracer::instance().record("RowScheduler::job", "stage", job->traceStartNs, Tracer::instance().now());
+        }
+        job->finished = true;
+        job->futureInterface.reportFinished();
+    }
+}
+
+bool RowScheduler::claimChunk(RowChunk *chunk){
+    //Take the next chunk round robin, dropping jobs that have nothing left to hand out
+    QMutexLocker locker(&this->jobMutex);
+    while(!this->jobs.empty()){
+        if(this->nextJob >= this->jobs.size()){
+            this->nextJob = 0;
+        }
+        RowJob *job = this->jobs[this->nextJob].get();
+        if(!job->cancelled && job->futureInterface.isCanceled()){
+            //Cancelled through its future, hand nothing more out and finish it if no chunk is running
+            job->cancelled = true;
+            if(job->tilesFinished == job->nextTile){
+                this->finishJob(job);
+            }
+        }
+        if(!job->cancelled && job->nextTile < job->tiles){
+            //Bands of a row chunk go out one after the other, so neighbouring tiles share the source rows in cache
+            int rowChunk = job->nextTile / job->bands;
+            int band = job->nextTile % job->bands;
+            const QRect &region = job->region;
+            chunk->job = this->jobs[this->nextJob];
+            chunk->startRow = region.top() + rowChunk * job->chunkRows;
+            chunk->endRow = min(chunk->startRow + job->chunkRows, region.top() + region.height());
+            chunk->startColumn = region.left() + band * job->tileColumns;
+            chunk->endColumn = min(chunk->startColumn + job->tileColumns, region.left() + region.width());
+            job->nextTile++;
+            this->nextJob++;
+            return true;
+        }
+        this->jobs.erase(this->jobs.begin() + this->nextJob);
+    }
+    //No work left, this worker is about to exit
+    this->activeWorkers--;
+    this->idle.wakeAll();
+    return false;
+}
+
+void RowScheduler::finishChunk(const RowChunk &chunk){
+    //Publish the rows once every band of them is written, and finish the job once everything handed out is and nothing more will be
+    RowJob *job = chunk.job.get();
+    QMutexLocker locker(&this->jobMutex);
+    int rowChunk = (chunk.startRow - job->region.top()) / job->chunkRows;
+    if(--job->bandsLeft[rowChunk] == 0){
+        //Logged before the counter moves, so a reader that sees the count also finds the rows
+        if(job->completedRows != nullptr){
+            job->completedRows->add(chunk.startRow, chunk.endRow);
+        }
+        if(job->rowsCompleted != nullptr){
+            job->rowsCompleted->fetch_add(chunk.endRow - chunk.startRow, memory_order_release);
+        }
+    }
+    job->tilesFinished++;
+    if(job->tilesFinished == job->nextTile && (job->nextTile >= job->tiles || job->cancelled || job->futureInterface.isCanceled())){
+        job->cancelled = job->nextTile < job->tiles;
+        this->finishJob(job);
+    }
+}
+
+void RowScheduler::waitForIdle(){
+    QMutexLocker locker(&this->jobMutex);
+    while(this->activeWorkers > 0){
+        this->idle.wait(&this->jobMutex);
+    }
+}
@@ -0,0 +1,117 @@
+//============================================================================
+// Name        : rowscheduler.h
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is the class definition of RowScheduler. Special note
+//               is that workers do not own a slice of any image: they keep
+//               claiming small row chunks from whichever queued image is
+//               next in turn, so a slow core or a dense region only ever
+//               holds up one chunk, never a whole slice. Every submitted
+//               image is handed back as a QFuture, which can be waited on or
+//               cancelled; cancellation takes effect at the next chunk.
+//               A job may carry several equally sized channel images that
+//               share one resample map, each chunk rectifies every channel
+//               of a row before moving on to the next row. A chunk is really
+//               a tile: a run of rows across a band of rectified columns.
+//               Tall images are handed out in full width bands, short wide
+//               ones are also split by column so every worker gets a share,
+//               and submitRegion() only rectifies part of the output. A job
+//               can log its row chunks into CompletedRows as they complete,
+//               for whoever wants to show the rows before the job is done.
+//============================================================================
+
+#ifndef ROWSCHEDULER_H
+#define ROWSCHEDULER_H
+#include <QFuture>
+#include <QFutureInterface>
+#include <QImage>
+#include <QMutex>
+#include <QRect>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "resamplemap.h"
+
+using namespace std;
+
+//Row ranges that are fully written, collected from the workers and taken by whoever displays them
+class CompletedRows{
+private:
+    QMutex mutex;
+    vector<pair<int, int>> ranges; //Start and end row of each completed row chunk
+public:
+    void add(int startRow, int endRow);
+    vector<pair<int, int>> take();
+};
+
+//One queued image, or set of channel images, shared by every worker that takes chunks from it
+struct RowJob{
+    vector<const QImage *> originalImages;
+    vector<QImage *> rectifiedImages;
+    QImage *compositeImage = nullptr; //Optional RGB32 composite built from three of the rectified channels
+    array<int, 3> compositeChannels = {{0, 1, 2}}; //Channel used for red, green and blue
+    shared_ptr<const ResampleMap> resampleMap;
+    QRect region; //Part of the rectified images to fill, in rectified coordinates
+    int chunkRows;
+    int tileColumns; //Width of a column band, the region's full width unless it is split
+    int bands; //Column bands per row chunk
+    int tiles; //Row chunks times bands
+    int nextTile = 0; //Guarded by the scheduler's job mutex, as are the members below it
+    int tilesFinished = 0;
+    vector<int> bandsLeft; //Unfinished bands per row chunk, the chunk's rows count as completed once it drops to 0
+    bool cancelled = false;
+    bool finished = false;
+    qint64 traceStartNs = -1; //When the job was queued, if tracing was on
+    atomic<int> *rowsCompleted; //Optional progress counter, may be nullptr
+    CompletedRows *completedRows = nullptr; //Optional log of the completed row chunks
+    QFutureInterface<void> futureInterface; //Reports finished once no chunk of the job is left running
+};
+
+//A claimed tile from one job
+struct RowChunk{
+    shared_ptr<RowJob> job;
+    int startRow;
+    int endRow;
+    int startColumn;
+    int endColumn;
+    QRect tile() const {return QRect(this->startColumn, this->startRow, this->endColumn - this->startColumn, this->endRow - this->startRow);}
+};
+
+class RowScheduler{
+private:
+    QThreadPool *threadPool;
+    QMutex jobMutex;
+    QWaitCondition idle;
+    vector<shared_ptr<RowJob>> jobs; //Jobs that still have unclaimed rows
+    size_t nextJob = 0; //Round robin cursor into jobs
+    int activeWorkers = 0;
+    int maxWorkers = 0; //0 follows the pool's maxThreadCount
+    void finishJob(RowJob *job);
+    QFuture<void> enqueue(shared_ptr<RowJob> job);
+public:
+    static const int chunksPerWorker = 8;
+    static const int minChunkRows = 4;
+    static const int maxChunkRows = 256;
+    static const int minTileColumns = 256; //Narrowest band a row chunk is split into
+    RowScheduler(QThreadPool *threadPool = QThreadPool::globalInstance());
+    ~RowScheduler();
+    static int chunkRowsFor(int rows, int workers);
+    static int tileColumnsFor(int columns, int rows, int workers);
+    void setMaxWorkers(int maxWorkers);
+    int getMaxWorkers() const;
+    QThreadPool *getThreadPool() const {return this->threadPool;}
+    QFuture<void> submit(const QImage *originalImage, QImage *rectifiedImage, shared_ptr<const ResampleMap> resampleMap, int rows, atomic<int> *rowsCompleted,
+                         CompletedRows *completedRows = nullptr);
+    QFuture<void> submitRegion(const QImage *originalImage, QImage *rectifiedImage, shared_ptr<const ResampleMap> resampleMap, const QRect &region, atomic<int> *rowsCompleted);
+    QFuture<void> submitChannels(const vector<const QImage *> &originalImages, const vector<QImage *> &rectifiedImages, QImage *compositeImage, array<int, 3> compositeChannels,
+                                 shared_ptr<const ResampleMap> resampleMap, int rows, atomic<int> *rowsCompleted, CompletedRows *completedRows = nullptr);
+    bool claimChunk(RowChunk *chunk);
+    void finishChunk(const RowChunk &chunk);
+    void waitForIdle();
+};
+
+#endif // ROWSCHEDULER_H
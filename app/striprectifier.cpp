@@ -0,0 +1,513 @@
+//============================================================================
+// Name        : striprectifier.cpp
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This class is responsible for rectifying images as a stream
+//               of row bands. Rectification only ever looks at one row at a
+//               time, so there is no need to hold the whole decoded pass or
+//               the whole rectified pass in memory. Binary PGM/PPM input is
+//               read band by band from any QIODevice, including stdin, and
+//               the next band is read while the current one is rectified on
+//               the thread pool, in Grayscale8 or RGB888 bands that hold the
+//               samples exactly as the file does. The result is written out
+//               incrementally as binary PGM/PPM.
+//
+//               PNG input is inflated row by row with zlib as the bands ask
+//               for it, unfiltered and expanded into the same Grayscale8 or
+//               RGB888 bands, so a PNG pass streams in the same bounded
+//               memory. Any bit depth, palette and alpha layout is read;
+//               alpha is dropped and 16-bit samples keep their high byte.
+//               Interlaced PNGs spread every row over seven passes and
+//               cannot be read a band at a time, so they are refused, as is
+//               every other format, rather than decoded whole behind the
+//               caller's back.
+//============================================================================
+
+#include "striprectifier.h"
+#include <QFile>
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <zlib.h>
+
+static QByteArray readPnmToken(QIODevice *input){
+    //Next whitespace separated header token, skipping comments
+    QByteArray token;
+    char character;
+    while(input->getChar(&character)){
+        if(character == '#'){
+            while(input->getChar(&character) && character != '\n'){}
+            continue;
+        }
+        if(isspace(static_cast<unsigned char>(character))){
+            if(!token.isEmpty()){
+                return token;
+            }
+            continue;
+        }
+        token.append(character);
+    }
+    return token;
+}
+
+static bool readFully(QIODevice *input, char *data, qint64 size){
+    //Pipes hand data over in pieces, keep reading until the band is complete
+    while(size > 0){
+        qint64 received = input->read(data, size);
+        if(received < 0 || (received == 0 && !input->waitForReadyRead(-1))){
+            return false;
+        }
+        data += received;
+        size -= received;
+    }
+    return true;
+}
+
+static const char pngSignature[] = "\x89PNG\r\n\x1a\n";
+
+static quint32 readBigEndian(const uchar *data){
+    return (static_cast<quint32>(data[0]) << 24) | (static_cast<quint32>(data[1]) << 16) | (static_cast<quint32>(data[2]) << 8) | data[3];
+}
+
+//Inflates the image data of a PNG one row at a time, reading chunks only as the rows need them
+class PngRowReader{
+private:
+    QIODevice *input;
+    z_stream stream;
+    bool streamOpen = false;
+    int width = 0;
+    int height = 0;
+    int bitDepth = 0;
+    int colorType = 0;
+    int samplesPerPixel = 1;
+    int filterBytesPerPixel = 1; //Distance back to the same sample of the pixel before, at least a byte
+    int rowBytes = 0;
+    QByteArray palette; //RGB triples
+    quint32 dataLeft = 0; //Bytes of the current IDAT chunk not read yet
+    uLong dataCrc = 0;
+    QByteArray compressed;
+    vector<uchar> previous; //Filter byte and unfiltered bytes of the row before
+    vector<uchar> current;
+    void readChunkHeader(quint32 *length, QByteArray *type);
+    void readChunkData(const QByteArray &type, quint32 length, QByteArray *data);
+    void checkCrc(uLong crc);
+    void inflateBytes(uchar *data, int size);
+    void unfilterRow();
+public:
+    explicit PngRowReader(QIODevice *input);
+    ~PngRowReader();
+    PngRowReader(const PngRowReader &) = delete;
+    PngRowReader &operator=(const PngRowReader &) = delete;
+    int getWidth() const {return this->width;}
+    int getHeight() const {return this->height;}
+    bool isGrayscale() const {return this->colorType == 0 || this->colorType == 4;}
+    void readRows(QImage *band, int rows);
+};
+
+PngRowReader::PngRowReader(QIODevice *input): input(input){
+    //Read up to the first IDAT chunk, keeping the header and the palette
+    char signature[8];
+    if(!readFully(input, signature, 8) || memcmp(signature, pngSignature, 8) != 0){
+        throw string("Input is not a PNG image");
+    }
+    bool headerRead = false;
+    while(true){
+        quint32 length;
+        QByteArray type;
+        this->readChunkHeader(&length, &type);
+        if(type == "IDAT"){
+            if(!headerRead || (this->colorType == 3 && this->palette.isEmpty())){
+                throw string("Malformed PNG header");
+            }
+            this->dataLeft = length;
+            this->dataCrc = crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef *>(type.constData()), 4);
+            break;
+        }
+        //Only the header and the palette are kept, the rest is just checked and skipped
+        QByteArray data;
+        this->readChunkData(type, length, (type == "IHDR" || type == "PLTE") ? &data : nullptr);
+        if(type == "IHDR"){
+            const uchar *header = reinterpret_cast<const uchar *>(data.constData());
+            if(length != 13 || headerRead){
+                throw string("Malformed PNG header");
+            }
+            quint32 storedWidth = readBigEndian(header);
+            quint32 storedHeight = readBigEndian(header + 4);
+            this->bitDepth = header[8];
+            this->colorType = header[9];
+            const int samples[] = {1, 0, 3, 1, 2, 0, 4};
+            bool depthOk = this->bitDepth == 8 || this->bitDepth == 16 || ((this->colorType == 0 || this->colorType == 3) && (this->bitDepth == 1 || this->bitDepth == 2 || this->bitDepth == 4));
+            if(storedWidth < 1 || storedHeight < 1 || storedWidth > INT_MAX / 64 || storedHeight > INT_MAX || this->colorType > 6 || samples[this->colorType] == 0 || !depthOk || (this->colorType == 3 && this->bitDepth == 16) || header[10] != 0 || header[11] != 0){
+                throw string("Malformed PNG header");
+            }
+            if(header[12] != 0){
+                throw string("Interlaced PNG images cannot be streamed, save the image without interlacing first");
+            }
+            this->width = static_cast<int>(storedWidth);
+            this->height = static_cast<int>(storedHeight);
+            this->samplesPerPixel = samples[this->colorType];
+            this->filterBytesPerPixel = max(1, this->samplesPerPixel * this->bitDepth / 8);
+            this->rowBytes = static_cast<int>((static_cast<qint64>(this->width) * this->samplesPerPixel * this->bitDepth + 7) / 8);
+            headerRead = true;
+        } else if(type == "PLTE"){
+            if(length % 3 != 0 || length > 768){
+                throw string("Malformed PNG palette");
+            }
+            this->palette = data;
+        } else if(type == "IEND"){
+            throw string("The PNG image holds no image data");
+        } else if(type[0] >= 'A' && type[0] <= 'Z'){
+            throw string("Unsupported PNG chunk");
+        }
+        //Ancillary chunks (text, gamma, transparency...) are skipped
+    }
+    memset(&this->stream, 0, sizeof(this->stream));
+    if(inflateInit(&this->stream) != Z_OK){
+        throw string("Unable to start decompressing the PNG image");
+    }
+    this->streamOpen = true;
+    this->previous.assign(this->rowBytes + 1, 0);
+    this->current.assign(this->rowBytes + 1, 0);
+}
+
+PngRowReader::~PngRowReader(){
+    if(this->streamOpen){
+        inflateEnd(&this->stream);
+    }
+}
+
+void PngRowReader::readChunkHeader(quint32 *length, QByteArray *type){
+    uchar header[8];
+    if(!readFully(this->input, reinterpret_cast<char *>(header), 8)){
+        throw string("Unexpected end of image data");
+    }
+    *length = readBigEndian(header);
+    *type = QByteArray(reinterpret_cast<const char *>(header + 4), 4);
+    if(*length > 0x7FFFFFFFu){
+        throw string("Malformed PNG chunk");
+    }
+}
+
+void PngRowReader::readChunkData(const QByteArray &type, quint32 length, QByteArray *data){
+    //Body of a chunk ahead of the image data, checked against its CRC and kept only when data is given
+    uLong crc = crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef *>(type.constData()), 4);
+    QByteArray piece;
+    for(quint32 left = length; left > 0;){
+        //Large ancillary chunks, such as ICC profiles, are read in pieces
+        int size = static_cast<int>(min<quint32>(left, 65536));
+        piece.resize(size);
+        if(!readFully(this->input, piece.data(), size)){
+            throw string("Unexpected end of image data");
+        }
+        crc = crc32(crc, reinterpret_cast<const Bytef *>(piece.constData()), static_cast<uInt>(size));
+        if(data != nullptr){
+            data->append(piece);
+        }
+        left -= static_cast<quint32>(size);
+    }
+    this->checkCrc(crc);
+}
+
+void PngRowReader::checkCrc(uLong crc){
+    uchar stored[4];
+    if(!readFully(this->input, reinterpret_cast<char *>(stored), 4)){
+        throw string("Unexpected end of image data");
+    }
+    if(readBigEndian(stored) != static_cast<quint32>(crc)){
+        throw string("Corrupt PNG chunk");
+    }
+}
+
+void PngRowReader::inflateBytes(uchar *data, int size){
+    //Inflate exactly size bytes, pulling in IDAT chunks as the compressed data runs out
+    this->stream.next_out = data;
+    this->stream.avail_out = static_cast<uInt>(size);
+    while(this->stream.avail_out > 0){
+        if(this->stream.avail_in == 0){
+            while(this->dataLeft == 0){
+                //Image data carries on in the next chunk, which has to be another IDAT
+                this->checkCrc(this->dataCrc);
+                quint32 length;
+                QByteArray type;
+                this->readChunkHeader(&length, &type);
+                if(type != "IDAT"){
+                    throw string("Unexpected end of image data");
+                }
+                this->dataLeft = length;
+                this->dataCrc = crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef *>(type.constData()), 4);
+            }
+            int pieceSize = static_cast<int>(min<quint32>(this->dataLeft, 65536));
+            this->compressed.resize(pieceSize);
+            if(!readFully(this->input, this->compressed.data(), pieceSize)){
+                throw string("Unexpected end of image data");
+            }
+            this->dataCrc = crc32(this->dataCrc, reinterpret_cast<const Bytef *>(this->compressed.constData()), static_cast<uInt>(pieceSize));
+            this->dataLeft -= static_cast<quint32>(pieceSize);
+            this->stream.next_in = reinterpret_cast<Bytef *>(this->compressed.data());
+            this->stream.avail_in = static_cast<uInt>(pieceSize);
+        }
+        int result = inflate(&this->stream, Z_NO_FLUSH);
+        if(result == Z_STREAM_END && this->stream.avail_out > 0){
+            throw string("Unexpected end of image data");
+        }
+        if(result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR){
+            throw string("Corrupt PNG image data");
+        }
+    }
+}
+
+void PngRowReader::unfilterRow(){
+    //Undo the filter named by the row's first byte, against the row before
+    uchar *row = this->current.data() + 1;
+    const uchar *above = this->previous.data() + 1;
+    int back = this->filterBytesPerPixel;
+    switch(this->current[0]){
+    case 0:
+        break;
+    case 1:
+        for(int index = back; index < this->rowBytes; index++){
+            row[index] = static_cast<uchar>(row[index] + row[index - back]);
+        }
+        break;
+    case 2:
+        for(int index = 0; index < this->rowBytes; index++){
+            row[index] = static_cast<uchar>(row[index] + above[index]);
+        }
+        break;
+    case 3:
+        for(int index = 0; index < this->rowBytes; index++){
+            int left = index >= back ? row[index - back] : 0;
+            row[index] = static_cast<uchar>(row[index] + ((left + above[index]) >> 1));
+        }
+        break;
+    case 4:
+        for(int index = 0; index < this->rowBytes; index++){
+            int left = index >= back ? row[index - back] : 0;
+            int up = above[index];
+            int upLeft = index >= back ? above[index - back] : 0;
+            int estimate = left + up - upLeft;
+            int leftDistance = abs(estimate - left);
+            int upDistance = abs(estimate - up);
+            int upLeftDistance = abs(estimate - upLeft);
+            int predicted = (leftDistance <= upDistance && leftDistance <= upLeftDistance) ? left : (upDistance <= upLeftDistance ? up : upLeft);
+            row[index] = static_cast<uchar>(row[index] + predicted);
+        }
+        break;
+    default:
+        throw string("Corrupt PNG image data");
+    }
+}
+
+void PngRowReader::readRows(QImage *band, int rows){
+    //Next rows of the image, into a Grayscale8 band for gray images and an RGB888 band for the rest
+    int maxValue = (1 << min(this->bitDepth, 8)) - 1;
+    int bytesPerSample = this->bitDepth == 16 ? 2 : 1;
+    int paletteColors = this->palette.size() / 3;
+    const uchar *paletteData = reinterpret_cast<const uchar *>(this->palette.constData());
+    for(int row = 0; row < rows; row++){
+        this->inflateBytes(this->current.data(), this->rowBytes + 1);
+        this->unfilterRow();
+        const uchar *samples = this->current.data() + 1;
+        uchar *line = band->scanLine(row);
+        for(int column = 0; column < this->width; column++){
+            int values[3] = {0, 0, 0};
+            if(this->bitDepth < 8){
+                //Packed from the most significant bit, one sample per pixel
+                int bit = column * this->bitDepth;
+                values[0] = (samples[bit / 8] >> (8 - this->bitDepth - bit % 8)) & maxValue;
+            } else {
+                //Alpha is the last sample and never read, 16-bit samples keep their high byte
+                for(int channel = 0; channel < min(this->samplesPerPixel, 3); channel++){
+                    values[channel] = samples[(column * this->samplesPerPixel + channel) * bytesPerSample];
+                }
+            }
+            if(this->isGrayscale()){
+                line[column] = static_cast<uchar>(this->bitDepth < 8 ? values[0] * 255 / maxValue : values[0]);
+                continue;
+            }
+            if(this->colorType == 3){
+                //Indices past the end of the palette come out black
+                int index = values[0];
+                for(int channel = 0; channel < 3; channel++){
+                    values[channel] = index < paletteColors ? paletteData[index * 3 + channel] : 0;
+                }
+            }
+            line[column * 3] = static_cast<uchar>(values[0]);
+            line[column * 3 + 1] = static_cast<uchar>(values[1]);
+            line[column * 3 + 2] = static_cast<uchar>(values[2]);
+        }
+        swap(this->previous, this->current);
+    }
+}
+
+StripRectifier::StripRectifier(QThreadPool *threadPool): rowScheduler(threadPool){
+    //Start out with the same defaults the GUI uses
+    CorrectionFactor defaults(1);
+    this->earthRadius = defaults.getDefaultEarthRadius();
+    this->satelliteAltitude = defaults.getDefaultSatelliteAltitude();
+    this->satelliteSwath = defaults.getDefaultSatelliteSwath();
+}
+
+void StripRectifier::setBandRows(int bandRows){
+    if(bandRows < 1){
+        throw string("Band must hold at least one row");
+    }
+    this->bandRows = bandRows;
+}
+
+shared_ptr<const ResampleMap> StripRectifier::prepareResampleMap(int imageWidth){
+    CorrectionFactor correctionFactor(imageWidth);
+    correctionFactor.setParameters(this->earthRadius, this->satelliteAltitude, this->satelliteSwath);
+    correctionFactor.setFilter(this->filter);
+    return correctionFactor.getResampleMap();
+}
+
+void StripRectifier::readPnmHeader(QIODevice *input, bool *grayscale, int *width, int *height){
+    QByteArray magic = readPnmToken(input);
+    if(magic != "P5" && magic != "P6"){
+        throw string("Input is not a binary PGM or PPM image");
+    }
+    bool widthOk, heightOk, maxValueOk;
+    *grayscale = magic == "P5";
+    *width = readPnmToken(input).toInt(&widthOk);
+    *height = readPnmToken(input).toInt(&heightOk);
+    int maxValue = readPnmToken(input).toInt(&maxValueOk);
+    if(!widthOk || !heightOk || !maxValueOk || *width < 1 || *height < 1){
+        throw string("Malformed PGM/PPM header");
+    }
+    if(maxValue != 255){
+        throw string("Only 8-bit PGM/PPM images are supported");
+    }
+}
+
+void StripRectifier::readPnmBand(QIODevice *input, QImage *band, int rows, bool grayscale, QByteArray *buffer){
+    //Read rows of raw samples straight into the Grayscale8 or RGB888 band, which stores them the same way
+    int rowBytes = band->width() * (grayscale ? 1 : 3);
+    buffer->resize(rows * rowBytes);
+    if(!readFully(input, buffer->data(), buffer->size())){
+        throw string("Unexpected end of image data");
+    }
+    const char *samples = buffer->constData();
+    for(int row = 0; row < rows; row++){
+        memcpy(band->scanLine(row), samples + row * rowBytes, rowBytes);
+    }
+}
+
+void StripRectifier::writePnmHeader(QIODevice *output, bool grayscale, int width, int height){
+    QByteArray header = QByteArray(grayscale ? "P5" : "P6") + "\n" + QByteArray::number(width) + " " + QByteArray::number(height) + "\n255\n";
+    if(output->write(header) != header.size()){
+        throw string("The image was unable to be written");
+    }
+}
+
+void StripRectifier::writePnmBand(QIODevice *output, const QImage *rectifiedBand, int rows, bool grayscale, QByteArray *buffer){
+    //Pack the rectified rows back into raw samples and write them in one go
+    int channels = grayscale ? 1 : 3;
+    int width = rectifiedBand->width();
+    buffer->resize(rows * width * channels);
+    uchar *samples = reinterpret_cast<uchar *>(buffer->data());
+    if(rectifiedBand->format() == (grayscale ? QImage::Format_Grayscale8 : QImage::Format_RGB888)){
+        //Native bands already hold the samples in file order
+        for(int row = 0; row < rows; row++){
+            memcpy(samples + row * width * channels, rectifiedBand->constScanLine(row), width * channels);
+        }
+    } else {
+        for(int row = 0; row < rows; row++){
+            const QRgb *line = reinterpret_cast<const QRgb *>(rectifiedBand->constScanLine(row));
+            for(int column = 0; column < width; column++){
+                if(grayscale){
+                    samples[0] = qGray(line[column]);
+                } else {
+                    samples[0] = qRed(line[column]);
+                    samples[1] = qGreen(line[column]);
+                    samples[2] = qBlue(line[column]);
+                }
+                samples += channels;
+            }
+        }
+    }
+    if(output->write(*buffer) != buffer->size()){
+        throw string("The image was unable to be written");
+    }
+}
+
+void StripRectifier::rectifyBands(const function<void(QImage *, int)> &readBand, bool grayscale, int width, int height, QIODevice *output){
+    shared_ptr<const ResampleMap> resampleMap = this->prepareResampleMap(width);
+    writePnmHeader(output, grayscale, resampleMap->getRectifiedWidth(), height);
+
+    //Two input bands so the next one can be read while the current one is rectified
+    int bandHeight = min(this->bandRows, height);
+    //Bands keep the file's own 1 or 3 bytes per pixel, so the samples are never widened to 32 bits
+    QImage::Format bandFormat = grayscale ? QImage::Format_Grayscale8 : QImage::Format_RGB888;
+    QImage bands[2] = {QImage(width, bandHeight, bandFormat), QImage(width, bandHeight, bandFormat)};
+    QImage rectifiedBand(resampleMap->getRectifiedWidth(), bandHeight, bandFormat);
+    QByteArray outputBuffer;
+    int current = 0;
+    int rows = bandHeight;
+    this->rowsWritten = 0;
+    readBand(&bands[current], rows);
+    int row = 0;
+    while(row < height){
+        QFuture<void> bandDone = this->rowScheduler.submit(&bands[current], &rectifiedBand, resampleMap, rows, nullptr);
+        int nextRows = min(this->bandRows, height - row - rows);
+        try {
+            if(nextRows > 0){
+                readBand(&bands[1 - current], nextRows);
+            }
+        }  catch (string &e) {
+            bandDone.cancel();
+            bandDone.waitForFinished(); //Workers still point at the bands
+            throw;
+        }
+        bandDone.waitForFinished();
+        writePnmBand(output, &rectifiedBand, rows, grayscale, &outputBuffer);
+        this->rowsWritten += rows;
+        row += rows;
+        rows = nextRows;
+        current = 1 - current;
+    }
+}
+
+void StripRectifier::rectifyPnm(QIODevice *input, QIODevice *output){
+    bool grayscale;
+    int width, height;
+    readPnmHeader(input, &grayscale, &width, &height);
+    QByteArray inputBuffer;
+    this->rectifyBands([&](QImage *band, int rows){
+        readPnmBand(input, band, rows, grayscale, &inputBuffer);
+    }, grayscale, width, height, output);
+}
+
+void StripRectifier::rectifyPng(QIODevice *input, QIODevice *output){
+    PngRowReader reader(input);
+    this->rectifyBands([&](QImage *band, int rows){
+        reader.readRows(band, rows);
+    }, reader.isGrayscale(), reader.getWidth(), reader.getHeight(), output);
+}
+
+void StripRectifier::rectify(QIODevice *input, QIODevice *output){
+    //Pick the reader from the first bytes, nothing is consumed until then
+    QByteArray magic = input->peek(8);
+    while(magic.size() < 8 && input->waitForReadyRead(-1)){
+        magic = input->peek(8);
+    }
+    if(magic == QByteArray(pngSignature, 8)){
+        this->rectifyPng(input, output);
+    } else if(magic.startsWith("P5") || magic.startsWith("P6")){
+        this->rectifyPnm(input, output);
+    } else {
+        throw string("Stream mode only reads binary PGM/PPM and non-interlaced PNG images");
+    }
+}
+
+void StripRectifier::rectifyFile(const QString &inputPath, QIODevice *output){
+    QFile input(inputPath);
+    if(!input.open(QIODevice::ReadOnly)){
+        throw string("The file was unable to be opened");
+    }
+    this->rectify(&input, output);
+}
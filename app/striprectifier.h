@@ -0,0 +1,55 @@
+//============================================================================
+// Name        : striprectifier.h
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is the class definition of StripRectifier. Special note
+//               is that it never holds more than two input bands and one
+//               output band, so memory use does not depend on how long the
+//               pass is. Only binary PGM/PPM and non-interlaced PNG input
+//               can be read that way, anything else is refused.
+//============================================================================
+
+#ifndef STRIPRECTIFIER_H
+#define STRIPRECTIFIER_H
+#include <QByteArray>
+#include <QIODevice>
+#include <QImage>
+#include <QThreadPool>
+#include <functional>
+#include <memory>
+#include "correctionfactor.h"
+#include "rowscheduler.h"
+
+using namespace std;
+
+class StripRectifier{
+private:
+    double earthRadius;
+    double satelliteAltitude;
+    int satelliteSwath;
+    int bandRows = 256;
+    ResampleFilter filter = ResampleFilter::Linear;
+    RowScheduler rowScheduler;
+    qint64 rowsWritten = 0;
+    shared_ptr<const ResampleMap> prepareResampleMap(int imageWidth);
+    void rectifyBands(const function<void(QImage *, int)> &readBand, bool grayscale, int width, int height, QIODevice *output);
+    static void readPnmHeader(QIODevice *input, bool *grayscale, int *width, int *height);
+    static void readPnmBand(QIODevice *input, QImage *band, int rows, bool grayscale, QByteArray *buffer);
+    static void writePnmHeader(QIODevice *output, bool grayscale, int width, int height);
+    static void writePnmBand(QIODevice *output, const QImage *rectifiedBand, int rows, bool grayscale, QByteArray *buffer);
+public:
+    StripRectifier(QThreadPool *threadPool = QThreadPool::globalInstance());
+    void setEarthRadius(double earthRadius){this->earthRadius = earthRadius;}
+    void setSatelliteAltitude(double satelliteAltitude){this->satelliteAltitude = satelliteAltitude;}
+    void setSatelliteSwath(int satelliteSwath){this->satelliteSwath = satelliteSwath;}
+    void setBandRows(int bandRows);
+    void setFilter(ResampleFilter filter){this->filter = filter;}
+    void rectifyPnm(QIODevice *input, QIODevice *output);
+    void rectifyPng(QIODevice *input, QIODevice *output);
+    void rectify(QIODevice *input, QIODevice *output);
+    void rectifyFile(const QString &inputPath, QIODevice *output);
+    qint64 getRowsWritten() const {return this->rowsWritten;}
+};
+
+#endif // STRIPRECTIFIER_H
@@ -4,59 +4,73 @@
 // Date        : 12/14/2020
 // E-Mail      : tgyk@tgyk.net
 // Description : This class is responsible for the handling of threads which
-//               perform image processing. It will determine the number of
-//               threads to spawn upon construction. The prepare() method is
-//               used to create threads to be used within image processing-
-//               parameter values are calculated or otherwise passed to each
-//               thread, which in turn is created within a vector of unique
-//               pointers. The run() method is responsible for starting this
-//               list of threads on work. This class also handles the signals
-//               from each thread, calculating progress to be emitted as a
-//               signal, as well as emitting a signal when all work has been
-//               completed.
+//               perform image processing. They come from a WorkerPool owned
+//               by the manager, one per usable CPU unless configured
+//               otherwise, and optionally pinned. The prepare() method is
+//               used to reset progress and take the rectified image from
+//               the BufferPool, reusing the last one's memory when it fits,
+//               and the run() method queues the image on the RowScheduler,
+//               whose threads pull small row chunks from it until it is
+//               done, all sharing the same ResampleMap. The job can be
+//               waited on or cancelled through the returned QFuture, and
+//               preparing again supersedes it. This class also samples the
+//               row counter the threads share at a bounded rate, calculating
+//               progress to be emitted as a signal, as well as emitting a
+//               signal when all work has been completed.
 //============================================================================
 
 #include "threadmanager.h"
+#include "bufferpool.h"
+#include "tracer.h"
 
-ThreadManager::ThreadManager(){
-    this->numberThreads = std::thread::hardware_concurrency();
-    if(this->numberThreads < 1){
-        this->numberThreads = 1;
-    }
+ThreadManager::ThreadManager(): rowScheduler(&workerPool){
+    this->numberThreads = this->workerPool.maxThreadCount();
+    this->progressTimer.setInterval(progressIntervalMs);
+    QObject::connect(&progressTimer, SIGNAL(timeout()), this, SLOT(setProgress()));
 }
 
 void ThreadManager::prepare(){
-    //(re)set initial values in preparation for creating the threads
-    this->startRow = 0;
+    TraceScope trace("ThreadManager::prepare");
+    //A job still writing into the rectified image is cancelled, and finishes its claimed chunks before the image is touched
+    this->cancel();
+
+    //(re)set initial values in preparation for queueing the image
     this->progress = 0;
+    this->oldProgress = 0;
+    this->progressTimer.stop();
     this->rowsCompleted = 0;
-    this->workers.clear(); //Potential memory leak? (unique pointers not destroyed, QObject connections not destroyed)??
-    int height = originalImage->height();
-    *rectifiedImage = QImage(this->rectifiedWidth, originalImage->height(), originalImage->format()); //Almost definite memory leak with subsequent rectifications..
-
-    //Calculate some starting parameters
-    this->workerRows = ceil(height / this->numberThreads);
-    this->endRow = this->workerRows;
-
-    //Create threads
-    do{
-        this->workers.push_back(make_unique<RectifyThread>(&*originalImage, &*rectifiedImage, rectifiedWidth, correctionFactorVector, endRow, startRow, &rowsCompleted));
-        this->startRow = this->endRow;
-
-        if((this->endRow + this->workerRows) < height){
-            this->endRow = this->startRow + this->workerRows;
-        } else {
-            this->endRow = height;
-        }
-        QObject::connect(&*workers[workers.size() - 1], SIGNAL(rowCompleted()), this, SLOT(setProgress()), Qt::DirectConnection);
-    }while(static_cast<int>(workers.size()) < this->numberThreads);
+    this->rowsSignalled = 0;
+    this->completedRows.take(); //Whatever the superseded job logged is stale now
+    //The old image goes back first so its buffer can be reused, unless a save or a pyramid build still holds it
+    //A fresh buffer is left untouched here, each row's pages are first written by the worker that rectifies it, on that worker's NUMA node
+    *rectifiedImage = QImage();
+    *rectifiedImage = BufferPool::instance().acquireImage(this->resampleMap->getRectifiedWidth(), originalImage->height(), originalImage->format());
+
+    //The scheduler sizes chunks from the height and thread count, rather than one slice per thread
+    this->rowScheduler.setMaxWorkers(this->numberThreads);
+    this->chunkRows = RowScheduler::chunkRowsFor(originalImage->height(), this->numberThreads);
+}
+
+QFuture<void> ThreadManager::run(){
+    //Queue the image, idle pool threads start claiming chunks straight away
+    this->running = true;
+    this->job = this->rowScheduler.submit(originalImage, rectifiedImage, resampleMap, originalImage->height(), &rowsCompleted, &completedRows);
+    //Sample progress from here on instead of having every thread report every row
+    this->progressTimer.start();
+    return this->job;
+}
+
+void ThreadManager::setWorkerConfig(const WorkerConfig &config){
+    //A render in flight is cancelled, the pool can only be resized and placed while idle
+    this->cancel();
+    this->workerPool.configure(config);
+    this->numberThreads = this->workerPool.maxThreadCount();
 }
 
-void ThreadManager::run(){
-    //Start threads
-    QThreadPool::globalInstance()->setExpiryTimeout(-1);
-    for(int workerNumber = 0; workerNumber < this->numberThreads; workerNumber++){
-        workers[workerNumber]->setAutoDelete(false);
-        QThreadPool::globalInstance()->start(&*workers[workerNumber]);
-    }
+void ThreadManager::cancel(){
+    //Stop handing out chunks and wait for the ones already claimed, which takes at most one chunk per thread
+    this->progressTimer.stop();
+    this->running = false;
+    this->job.cancel();
+    this->job.waitForFinished();
 }
@@ -4,10 +4,15 @@
 // Date        : 12/14/2020
 // E-Mail      : tgyk@tgyk.net
 // Description : This is the class definition of ThreadManager. Special note
-//               is the slot used to handle work signals from threads as well
-//               as calculate overall progress. This slot will emit a signal
+//               is that run() hands back the job as a QFuture, and that a
+//               new prepare() supersedes a job still in flight. Also of note
+//               is the slot used to sample the shared row counter on a timer
+//               and calculate overall progress. This slot will emit a signal
 //               for each progress update, as well as when the overall work is
-//               finished. This class definition uses a specific preprocessor
+//               finished, and one whenever more rows are ready to be shown.
+//               The rows are rectified on a WorkerPool of the manager's own,
+//               sized and placed by setWorkerConfig().
+//               This class definition uses a specific preprocessor
 //               directive to modify the access for private class members to
 //               simplify testing- No accessors to private class members were
 //               created for use in the main application, and as such, there
@@ -24,12 +29,16 @@
 #endif
 
 #include <QThread>
+#include <QFuture>
 #include <QDebug>
 #include <QImage>
 #include <QObject>
+#include <QTimer>
+#include <atomic>
 #include <vector>
 #include <math.h>
-#include "rectifythread.h"
+#include "rowscheduler.h"
+#include "workerpool.h"
 
 using namespace std;
 
@@ -40,29 +49,47 @@ Q_OBJECT
 ACCESS:
     int progress = 0;
     int oldProgress = progress;
-    int rowsCompleted = 0;
+    atomic<int> rowsCompleted{0};
+    int rowsSignalled = 0; //Rows completed when rowsRectified() was last emitted
+    CompletedRows completedRows; //Row chunks finished since takeRectifiedRows() was last called
+    bool running = false; //Between run() and the last row being sampled
     int numberThreads = 1;
-    int startRow = 0;
-    int workerRows;
-    int endRow;
-    int rectifiedWidth;
+    int chunkRows = RowScheduler::minChunkRows;
     const QImage *originalImage;
     QImage *rectifiedImage;
-    vector<long double> correctionFactorVector;
-    vector<unique_ptr<RectifyThread>> workers;
+    shared_ptr<const ResampleMap> resampleMap;
+    WorkerPool workerPool; //Declared before rowScheduler, which runs its workers on it
+    RowScheduler rowScheduler; //Chunks are claimed by however many threads the pool runs
+    QFuture<void> job; //The image currently being rectified, if any
+    QTimer progressTimer; //Samples rowsCompleted on the thread that owns the manager
 public:
+    static const int progressIntervalMs = 33; //At most ~30 progress updates per second
     ThreadManager();
     virtual ~ThreadManager() {};
     void setOriginalImage(const QImage *originalImage){this->originalImage = originalImage;}
     void setRectImage(QImage *rectifiedImage){this->rectifiedImage = rectifiedImage;}
-    void setCorrectionFactorVector(vector<long double> correctionFactorVector){this->correctionFactorVector = correctionFactorVector;}
-    void setRectifiedWidth(int rectifiedWidth){this->rectifiedWidth = rectifiedWidth;}
+    void setResampleMap(shared_ptr<const ResampleMap> resampleMap){this->resampleMap = resampleMap;}
+    void setWorkerConfig(const WorkerConfig &config);
+    const WorkerConfig &getWorkerConfig() const {return this->workerPool.getConfig();}
+    int getThreadCount() const {return this->numberThreads;}
     void prepare();
-    void run();
+    QFuture<void> run();
+    void cancel();
+    bool isRunning() const {return this->running;}
+    vector<pair<int, int>> takeRectifiedRows(){return this->completedRows.take();}
 public slots:
-    //This slot is responsible for catching the "I did some work" signal from threads, and updating progress accordingly
+    //This slot is responsible for sampling the rows completed by the threads, and updating progress accordingly
     void setProgress(){
-        this->progress = (static_cast<double>(this->rowsCompleted) / this->originalImage->height()) * 100;
+        int rows = this->rowsCompleted.load(memory_order_acquire);
+        this->progress = (static_cast<double>(rows) / this->originalImage->height()) * 100;
+        if(rows >= this->originalImage->height()){
+            this->progressTimer.stop();
+            this->running = false;
+        }
+        if(rows > this->rowsSignalled){ //New rows are announced at most once per tick, whatever the progress did
+            this->rowsSignalled = rows;
+            emit rowsRectified();
+        }
         if(this->progress != this->oldProgress){ //Only emit a new progress signal when there is some new progress to provide
             this->oldProgress = this->progress;
             if(this->progress == 100){
@@ -74,6 +101,7 @@ public slots:
 signals:
     void progressMade(int);
     void processingDone();
+    void rowsRectified();
 };
 
 #endif // THREADMANAGER_H
@@ -0,0 +1,136 @@
+//============================================================================
+// Name        : tracer.cpp
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This class collects the timing of each processing stage and
+//               of every chunk the workers rectify, so where the time goes
+//               can be seen per thread. Events are complete spans with a
+//               start and a duration, appended under a short lock; a render
+//               produces a few hundred at most. The recorded spans can be
+//               written as Chrome trace JSON, which chrome://tracing and
+//               Perfetto open directly, or summed up per stage as text for
+//               the log box and the CLI.
+//============================================================================
+
+#include "tracer.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <algorithm>
+
+Tracer::Tracer(){
+    this->clock.start();
+}
+
+Tracer &Tracer::instance(){
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::setEnabled(bool enabled){
+    this->enabled.store(enabled, memory_order_relaxed);
+}
+
+int Tracer::currentThread(){
+    //Ids are handed out on a thread's first event and named then, pool threads all look alike to Qt
+    thread_local int thread = -1;
+    if(thread < 0){
+        thread = this->nextThread.fetch_add(1);
+        QCoreApplication *application = QCoreApplication::instance();
+        QString name = application != nullptr && QThread::currentThread() == application->thread() ? QString("main") : QString("worker %1").arg(thread);
+        QMutexLocker locker(&this->mutex);
+        this->threadNames[thread] = name;
+    }
+    return thread;
+}
+
+void Tracer::record(const char *name, const char *category, qint64 startNs, qint64 endNs){
+    TraceEvent event = {name, category, startNs, endNs - startNs, this->currentThread()};
+    QMutexLocker locker(&this->mutex);
+    this->events.push_back(event);
+}
+
+void Tracer::clear(){
+    QMutexLocker locker(&this->mutex);
+    this->events.clear();
+}
+
+vector<TraceEvent> Tracer::snapshot(){
+    QMutexLocker locker(&this->mutex);
+    return this->events;
+}
+
+QString Tracer::summary(){
+    //Count, total, mean and longest span per name, the stages that took longest first
+    struct StageTotal{
+        const char *name;
+        int count;
+        qint64 totalNs;
+        qint64 maxNs;
+    };
+    vector<StageTotal> stages;
+    for(const TraceEvent &event : this->snapshot()){
+        auto found = find_if(stages.begin(), stages.end(), [&](const StageTotal &stage){return qstrcmp(stage.name, event.name) == 0;});
+        if(found == stages.end()){
+            stages.push_back({event.name, 1, event.durationNs, event.durationNs});
+        } else {
+            found->count++;
+            found->totalNs += event.durationNs;
+            found->maxNs = max(found->maxNs, event.durationNs);
+        }
+    }
+    if(stages.empty()){
+        return "No timings recorded";
+    }
+    sort(stages.begin(), stages.end(), [](const StageTotal &a, const StageTotal &b){return a.totalNs > b.totalNs;});
+    QString text = "Stage timings:";
+    for(const StageTotal &stage : stages){
+        text += QString("\n  %1: %2 x, %3 ms total, %4 ms mean, %5 ms max").arg(stage.name).arg(stage.count)
+                .arg(stage.totalNs / 1e6, 0, 'f', 2).arg(stage.totalNs / 1e6 / stage.count, 0, 'f', 2).arg(stage.maxNs / 1e6, 0, 'f', 2);
+    }
+    return text;
+}
+
+void Tracer::writeChromeTrace(const string &filePath){
+    //Complete ("X") events in microseconds, plus the thread names as metadata events
+    QJsonArray traceEvents;
+    vector<TraceEvent> events = this->snapshot();
+    map<int, QString> threadNames;
+    {
+        QMutexLocker locker(&this->mutex);
+        threadNames = this->threadNames;
+    }
+    for(const auto &thread : threadNames){
+        QJsonObject metadata;
+        metadata["name"] = "thread_name";
+        metadata["ph"] = "M";
+        metadata["pid"] = 1;
+        metadata["tid"] = thread.first;
+        metadata["args"] = QJsonObject{{"name", thread.second}};
+        traceEvents.append(metadata);
+    }
+    for(const TraceEvent &event : events){
+        QJsonObject span;
+        span["name"] = event.name;
+        span["cat"] = event.category;
+        span["ph"] = "X";
+        span["ts"] = event.startNs / 1000.0;
+        span["dur"] = event.durationNs / 1000.0;
+        span["pid"] = 1;
+        span["tid"] = event.thread;
+        traceEvents.append(span);
+    }
+    QJsonObject trace;
+    trace["traceEvents"] = traceEvents;
+    trace["displayTimeUnit"] = "ms";
+
+    QFile file(QString::fromStdString(filePath));
+    QByteArray json = QJsonDocument(trace).toJson(QJsonDocument::Compact);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) != json.size()){
+        throw string("The trace was unable to be saved");
+    }
+}
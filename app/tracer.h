@@ -0,0 +1,74 @@
+//============================================================================
+// Name        : tracer.h
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is the class definition of Tracer and TraceScope.
+//               Special note is that event names and categories are kept as
+//               plain pointers, so they have to be string literals. While
+//               tracing is disabled a TraceScope costs one relaxed atomic
+//               load and records nothing.
+//============================================================================
+
+#ifndef TRACER_H
+#define TRACER_H
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//One timed span on one thread
+struct TraceEvent{
+    const char *name;
+    const char *category;
+    qint64 startNs; //Since the tracer was created
+    qint64 durationNs;
+    int thread; //Small sequential id, in order of each thread's first event
+};
+
+class Tracer{
+private:
+    atomic<bool> enabled{false};
+    QElapsedTimer clock;
+    QMutex mutex;
+    vector<TraceEvent> events;
+    map<int, QString> threadNames;
+    atomic<int> nextThread{0};
+    Tracer();
+    int currentThread();
+public:
+    static Tracer &instance();
+    bool isEnabled() const {return this->enabled.load(memory_order_relaxed);}
+    void setEnabled(bool enabled);
+    qint64 now() const {return this->clock.nsecsElapsed();}
+    void record(const char *name, const char *category, qint64 startNs, qint64 endNs);
+    void clear();
+    vector<TraceEvent> snapshot();
+    QString summary();
+    void writeChromeTrace(const string &filePath);
+};
+
+//Times the enclosing scope, recording it only if tracing was on when the scope was entered
+class TraceScope{
+private:
+    const char *name;
+    const char *category;
+    qint64 startNs;
+public:
+    explicit TraceScope(const char *name, const char *category = "stage"): name(name), category(category),
+        startNs(Tracer::instance().isEnabled() ? Tracer::instance().now() : -1){}
+    ~TraceScope(){
+        if(this->startNs >= 0){
+            Tracer::instance().record(this->name, this->category, this->startNs, Tracer::instance().now());
+        }
+    }
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+};
+
+#endif // TRACER_H
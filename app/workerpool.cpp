@@ -0,0 +1,279 @@
+//============================================================================
+// Name        : workerpool.cpp
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This class is responsible for the threads the rectification
+//               runs on. Unlike the global pool it is owned by whoever
+//               rectifies, so its size can be limited on a machine shared
+//               with decoders and SDR software, and nothing else in Qt takes
+//               threads from it. Its threads never expire, which lets each
+//               one be pinned once to a CPU of its own: compact placement
+//               fills one NUMA node before the next, spread placement takes
+//               the nodes in turn for their memory bandwidth. The node
+//               layout is read from sysfs and limited to the CPUs the
+//               process is allowed on, so taskset and cgroup limits are
+//               honoured. Output rows are allocated untouched and first
+//               written by the worker that rectifies them, so with pinned
+//               workers their pages end up on that worker's node. Pinning is
+//               only implemented on Linux, elsewhere the thread count is
+//               still applied and threads are left where they are.
+//============================================================================
+
+#include "workerpool.h"
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+#include <QThread>
+#include <algorithm>
+#ifdef Q_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+const int WorkerPool::maxCpus;
+
+WorkerConfig WorkerConfig::load(const QSettings &settings){
+    //Anything missing or unreadable keeps its default
+    WorkerConfig config;
+    config.threads = max(0, settings.value("workers/threads", 0).toInt());
+    WorkerPool::parseAffinity(settings.value("workers/affinity", "none").toString(), &config.affinity);
+    if(!WorkerPool::parseCpuList(settings.value("workers/cpus").toString(), &config.cpus)){
+        config.cpus.clear();
+    }
+    return config;
+}
+
+void WorkerConfig::save(QSettings &settings) const{
+    settings.setValue("workers/threads", this->threads);
+    settings.setValue("workers/affinity", WorkerPool::affinityName(this->affinity));
+    settings.setValue("workers/cpus", WorkerPool::formatCpuList(this->cpus));
+}
+
+static bool setThreadCpus(const vector<int> &cpus){
+    //Restrict the calling thread to cpus
+#ifdef Q_OS_LINUX
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(int cpu : cpus){
+        if(cpu >= 0 && cpu < CPU_SETSIZE){
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    Q_UNUSED(cpus);
+    return false;
+#endif
+}
+
+WorkerPool::WorkerPool(QObject *parent): QThreadPool(parent){
+    //Threads stay for the life of the pool, so their placement does too
+    this->setExpiryTimeout(-1);
+    this->configure(WorkerConfig());
+}
+
+void WorkerPool::configure(const WorkerConfig &config){
+    //Nothing may be running while the placement changes under it
+    this->waitForDone();
+    this->config = config;
+    vector<int> usable = usableCpus();
+    this->allowedCpus.clear();
+    for(int cpu : config.cpus){
+        if(binary_search(usable.begin(), usable.end(), cpu)){
+            this->allowedCpus.push_back(cpu);
+        }
+    }
+    if(this->allowedCpus.empty()){
+        this->allowedCpus = usable;
+    }
+    this->placement = placementFor(numaNodes(this->allowedCpus), config.affinity);
+    this->setMaxThreadCount(config.threads > 0 ? config.threads : max(1, static_cast<int>(this->allowedCpus.size())));
+    this->nextSlot = 0;
+    this->generation.fetch_add(1, memory_order_release);
+}
+
+bool WorkerPool::placeCurrentThread(){
+    //Once per thread and configuration, returns whether the thread was (re)placed just now
+    thread_local const WorkerPool *placedPool = nullptr;
+    thread_local int placedGeneration = 0;
+    int current = this->generation.load(memory_order_acquire);
+    if(placedPool == this && placedGeneration == current){
+        return false;
+    }
+    bool placedBefore = placedPool == this;
+    placedPool = this;
+    placedGeneration = current;
+    if(!this->placement.empty()){
+        //Slots are handed out in order, more threads than CPUs wrap around
+        int slot = this->nextSlot.fetch_add(1) % static_cast<int>(this->placement.size());
+        return setThreadCpus({this->placement[slot]});
+    }
+    if(placedBefore || !this->config.cpus.empty()){
+        //Not pinned one each, but kept to the allowed CPUs, which also undoes an earlier pinning
+        return setThreadCpus(this->allowedCpus);
+    }
+    return false;
+}
+
+void WorkerPool::placeOn(QThreadPool *pool){
+    //Tasks that may run on any pool call this first, only a WorkerPool places its threads
+    WorkerPool *workerPool = dynamic_cast<WorkerPool *>(pool);
+    if(workerPool != nullptr){
+        workerPool->placeCurrentThread();
+    }
+}
+
+vector<int> WorkerPool::usableCpus(){
+    //The process's CPUs, taken once from whichever thread asks first, normally the main thread before any pinning
+    static const vector<int> cpus = [](){
+        vector<int> usable;
+#ifdef Q_OS_LINUX
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if(sched_getaffinity(0, sizeof(set), &set) == 0){
+            for(int cpu = 0; cpu < min(CPU_SETSIZE, maxCpus); cpu++){
+                if(CPU_ISSET(cpu, &set)){
+                    usable.push_back(cpu);
+                }
+            }
+        }
+#endif
+        if(usable.empty()){
+            for(int cpu = 0; cpu < max(1, QThread::idealThreadCount()); cpu++){
+                usable.push_back(cpu);
+            }
+        }
+        return usable;
+    }();
+    return cpus;
+}
+
+vector<vector<int>> WorkerPool::numaNodes(const vector<int> &cpus){
+    //CPUs of each NUMA node that are among cpus, which are taken to be sorted, as one node when there is no layout to read
+    vector<vector<int>> nodes;
+    vector<int> placed;
+    QDir nodeDirectory("/sys/devices/system/node");
+    QStringList nodeNames = nodeDirectory.entryList(QStringList() << "node*", QDir::Dirs);
+    sort(nodeNames.begin(), nodeNames.end(), [](const QString &first, const QString &second){
+        return first.mid(4).toInt() < second.mid(4).toInt();
+    });
+    for(const QString &nodeName : nodeNames){
+        QFile cpuListFile(nodeDirectory.filePath(nodeName + "/cpulist"));
+        vector<int> nodeCpus;
+        if(!cpuListFile.open(QIODevice::ReadOnly) || !parseCpuList(QString::fromLatin1(cpuListFile.readAll()), &nodeCpus)){
+            continue;
+        }
+        vector<int> node;
+        for(int cpu : nodeCpus){
+            if(binary_search(cpus.begin(), cpus.end(), cpu)){
+                node.push_back(cpu);
+                placed.push_back(cpu);
+            }
+        }
+        if(!node.empty()){
+            nodes.push_back(node);
+        }
+    }
+    //CPUs no node claimed, or all of them without sysfs, make up one more node
+    sort(placed.begin(), placed.end());
+    vector<int> rest;
+    for(int cpu : cpus){
+        if(!binary_search(placed.begin(), placed.end(), cpu)){
+            rest.push_back(cpu);
+        }
+    }
+    if(!rest.empty()){
+        nodes.push_back(rest);
+    }
+    return nodes;
+}
+
+vector<int> WorkerPool::placementFor(const vector<vector<int>> &nodes, CpuAffinity affinity){
+    //Order in which threads are pinned to CPUs
+    vector<int> placement;
+    if(affinity == CpuAffinity::Compact){
+        for(const vector<int> &node : nodes){
+            placement.insert(placement.end(), node.begin(), node.end());
+        }
+    } else if(affinity == CpuAffinity::Spread){
+        size_t largest = 0;
+        for(const vector<int> &node : nodes){
+            largest = max(largest, node.size());
+        }
+        for(size_t index = 0; index < largest; index++){
+            for(const vector<int> &node : nodes){
+                if(index < node.size()){
+                    placement.push_back(node[index]);
+                }
+            }
+        }
+    }
+    return placement;
+}
+
+bool WorkerPool::parseCpuList(const QString &text, vector<int> *cpus){
+    //Kernel cpulist format, such as 0-3,8,10-11, into a sorted list without duplicates, CPUs past maxCpus are refused
+    vector<int> parsed;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    QStringList parts = text.trimmed().split(',', Qt::SkipEmptyParts);
+#else
+    QStringList parts = text.trimmed().split(',', QString::SkipEmptyParts);
+#endif
+    for(const QString &part : parts){
+        QStringList range = part.trimmed().split('-');
+        bool firstOk = false;
+        bool lastOk = range.size() == 1;
+        int first = range[0].trimmed().toInt(&firstOk);
+        int last = range.size() == 2 ? range[1].trimmed().toInt(&lastOk) : first;
+        if(!firstOk || !lastOk || range.size() > 2 || first < 0 || last < first || last >= maxCpus){
+            return false;
+        }
+        for(int cpu = first; cpu <= last; cpu++){
+            parsed.push_back(cpu);
+        }
+    }
+    sort(parsed.begin(), parsed.end());
+    parsed.erase(unique(parsed.begin(), parsed.end()), parsed.end());
+    *cpus = parsed;
+    return true;
+}
+
+QString WorkerPool::formatCpuList(const vector<int> &cpus){
+    //Back into the cpulist format, runs collapsed into ranges
+    QStringList parts;
+    for(size_t index = 0; index < cpus.size();){
+        size_t end = index + 1;
+        while(end < cpus.size() && cpus[end] == cpus[end - 1] + 1){
+            end++;
+        }
+        parts << (end - index > 1 ? QString("%1-%2").arg(cpus[index]).arg(cpus[end - 1]) : QString::number(cpus[index]));
+        index = end;
+    }
+    return parts.join(',');
+}
+
+bool WorkerPool::parseAffinity(const QString &text, CpuAffinity *affinity){
+    QString name = text.trimmed().toLower();
+    if(name == "none"){
+        *affinity = CpuAffinity::None;
+    } else if(name == "compact"){
+        *affinity = CpuAffinity::Compact;
+    } else if(name == "spread"){
+        *affinity = CpuAffinity::Spread;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+QString WorkerPool::affinityName(CpuAffinity affinity){
+    switch(affinity){
+    case CpuAffinity::Compact:
+        return "compact";
+    case CpuAffinity::Spread:
+        return "spread";
+    default:
+        return "none";
+    }
+}
@@ -0,0 +1,65 @@
+//============================================================================
+// Name        : workerpool.h
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is the class definition of WorkerPool, along with the
+//               WorkerConfig it is set up from. Special note is that threads
+//               are only pinned when a task asks for it through
+//               placeCurrentThread(), as QThreadPool has no hook for its
+//               threads starting, and that configure() waits for the tasks
+//               already running, so it should not be called while more are
+//               being queued.
+//============================================================================
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+#include <QSettings>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <vector>
+
+using namespace std;
+
+enum class CpuAffinity{
+    None, //Threads go wherever the scheduler puts them
+    Compact, //One CPU per thread, filling a NUMA node before the next
+    Spread //One CPU per thread, taking the NUMA nodes in turn
+};
+
+//How many workers to run and where, as set from the GUI, the command line or the settings file
+struct WorkerConfig{
+    int threads = 0; //0 for one per usable CPU
+    CpuAffinity affinity = CpuAffinity::None;
+    vector<int> cpus; //CPUs the workers may use, empty for all the process may use
+    static WorkerConfig load(const QSettings &settings);
+    void save(QSettings &settings) const;
+};
+
+class WorkerPool: public QThreadPool{
+private:
+    WorkerConfig config;
+    vector<int> allowedCpus; //CPUs of the config the process may actually use
+    vector<int> placement; //CPU for each worker slot in turn, empty when threads are not pinned
+    atomic<int> nextSlot{0};
+    atomic<int> generation{0}; //Bumped by every configure(), threads placed before are placed again on their next task
+public:
+    static const int maxCpus = 1024; //CPU numbers from here on are refused, same as glibc's CPU_SETSIZE
+    explicit WorkerPool(QObject *parent = nullptr);
+    void configure(const WorkerConfig &config);
+    const WorkerConfig &getConfig() const {return this->config;}
+    const vector<int> &getAllowedCpus() const {return this->allowedCpus;}
+    const vector<int> &getPlacement() const {return this->placement;}
+    bool placeCurrentThread();
+    static void placeOn(QThreadPool *pool);
+    static vector<int> usableCpus();
+    static vector<vector<int>> numaNodes(const vector<int> &cpus);
+    static vector<int> placementFor(const vector<vector<int>> &nodes, CpuAffinity affinity);
+    static bool parseCpuList(const QString &text, vector<int> *cpus);
+    static QString formatCpuList(const vector<int> &cpus);
+    static bool parseAffinity(const QString &text, CpuAffinity *affinity);
+    static QString affinityName(CpuAffinity affinity);
+};
+
+#endif // WORKERPOOL_H
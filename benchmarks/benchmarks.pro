@@ -0,0 +1,41 @@
+QT += testlib
+QT += core gui
+
+CONFIG += c++14 console thread
+CONFIG -= app_bundle
+
+LIBS += -lz
+
+TARGET = meteor_rectifyBenchmarks
+
+INCLUDEPATH += ../app
+SOURCES +=  tst_benchmarks.cpp \
+            ../app/bufferpool.cpp \
+            ../app/correctionfactor.cpp \
+            ../app/correctiontable.cpp \
+            ../app/correctiontablecache.cpp \
+            ../app/filemanager.cpp \
+            ../app/idlethreads.cpp \
+            ../app/pngencoder.cpp \
+            ../app/rectifykernel.cpp \
+            ../app/rectifythread.cpp \
+            ../app/resamplemap.cpp \
+            ../app/rowscheduler.cpp \
+            ../app/threadmanager.cpp \
+            ../app/tracer.cpp \
+            ../app/workerpool.cpp
+
+HEADERS +=  ../app/bufferpool.h \
+            ../app/correctionfactor.h \
+            ../app/correctiontable.h \
+            ../app/correctiontablecache.h \
+            ../app/filemanager.h \
+            ../app/idlethreads.h \
+            ../app/pngencoder.h \
+            ../app/rectifykernel.h \
+            ../app/rectifythread.h \
+            ../app/resamplemap.h \
+            ../app/rowscheduler.h \
+            ../app/threadmanager.h \
+            ../app/tracer.h \
+            ../app/workerpool.h
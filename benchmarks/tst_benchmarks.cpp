@@ -0,0 +1,266 @@
+//============================================================================
+// Name        : tst_benchmarks.cpp
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is the benchmark suite. It times every stage of the
+//               rectification on synthetic images between 500 and 8000
+//               columns wide: building the correction vector (or loading it
+//               from the table cache) and resample map, the row kernel, the
+//               whole ThreadManager pipeline at 1..N threads, PNG
+//               decode/encode through FileManager and the parallel PNG
+//               encoder at 1..N threads.
+//               Unless an output is given with -o, results are written to
+//               benchmarks.csv next to the usual text log, so runs from
+//               different builds can be compared. Pass -o file.xml,xml (or
+//               any other QtTest format) to override.
+//============================================================================
+
+#define TESTING
+#include <QtTest>
+#include <QCoreApplication>
+#include <QTemporaryDir>
+#include <threadmanager.h>
+#include <filemanager.h>
+#include <rectifykernel.h>
+#include <pngencoder.h>
+
+const int BENCHMARK_ROWS = 1024;
+
+class benchmarkMain : public QObject{
+    Q_OBJECT
+
+public:
+    static QImage syntheticImage(int width, int height);
+
+private slots:
+    void initTestCase();
+    //CorrectionFactor benchmarks
+    void benchmarkCorrectionVector_data();
+    void benchmarkCorrectionVector();
+    void benchmarkCorrectionTableLoad_data();
+    void benchmarkCorrectionTableLoad();
+    void benchmarkResampleMap_data();
+    void benchmarkResampleMap();
+    //RectifyKernel benchmarks
+    void benchmarkRectifyRow_data();
+    void benchmarkRectifyRow();
+    //ThreadManager benchmarks
+    void benchmarkThreadManager_data();
+    void benchmarkThreadManager();
+    //FileManager benchmarks
+    void benchmarkDecode_data();
+    void benchmarkDecode();
+    void benchmarkEncode_data();
+    void benchmarkEncode();
+    //PngEncoder benchmarks
+    void benchmarkEncodeThreads_data();
+    void benchmarkEncodeThreads();
+
+private:
+    QTemporaryDir temporaryDir;
+    static void addImageWidths();
+};
+
+QImage benchmarkMain::syntheticImage(int width, int height){
+    //Smooth gradients with some texture, so PNG compression behaves like it does on a real pass
+    QImage image(width, height, QImage::Format_RGB32);
+    for(int row = 0; row < height; row++){
+        QRgb *pixels = reinterpret_cast<QRgb *>(image.scanLine(row));
+        for(int column = 0; column < width; column++){
+            int texture = (column * 7 + row * 13) % 23;
+            pixels[column] = qRgb((column * 255 / width + texture) % 256, (row + texture) % 256, (column ^ row) % 256);
+        }
+    }
+    return image;
+}
+
+void benchmarkMain::initTestCase(){
+    QVERIFY(this->temporaryDir.isValid());
+    //Time the computation itself unless a benchmark asks for the disk cache
+    CorrectionTableCache::instance().setDirectory("");
+}
+
+void benchmarkMain::addImageWidths(){
+    QTest::addColumn<int>("width");
+    for(int width : {500, 1000, 1568, 2000, 4000, 8000}){
+        QTest::newRow(QByteArray::number(width)) << width;
+    }
+}
+
+void benchmarkMain::benchmarkCorrectionVector_data(){
+    addImageWidths();
+}
+
+void benchmarkMain::benchmarkCorrectionVector(){
+    QFETCH(int, width);
+    QBENCHMARK{
+        CorrectionTableCache::instance().clearMemory();
+        CorrectionFactor correctionFactor(width);
+        correctionFactor.getRectifiedWidth();
+    }
+}
+
+void benchmarkMain::benchmarkCorrectionTableLoad_data(){
+    addImageWidths();
+}
+
+void benchmarkMain::benchmarkCorrectionTableLoad(){
+    //What a later run pays instead of the computation above
+    QFETCH(int, width);
+    CorrectionTableCache &cache = CorrectionTableCache::instance();
+    cache.setDirectory(this->temporaryDir.path());
+    CorrectionFactor(width).getRectifiedWidth();
+    QBENCHMARK{
+        cache.clearMemory();
+        CorrectionFactor correctionFactor(width);
+        correctionFactor.getRectifiedWidth();
+    }
+    cache.setDirectory("");
+    cache.clearMemory();
+}
+
+void benchmarkMain::benchmarkResampleMap_data(){
+    addImageWidths();
+}
+
+void benchmarkMain::benchmarkResampleMap(){
+    QFETCH(int, width);
+    CorrectionFactor correctionFactor(width);
+    shared_ptr<const CorrectionTable> correctionTable = correctionFactor.getTable();
+    QBENCHMARK{
+        ResampleMap resampleMap(width, correctionFactor.getRectifiedWidth(), *correctionTable);
+        Q_UNUSED(resampleMap);
+    }
+}
+
+void benchmarkMain::benchmarkRectifyRow_data(){
+    //Every format with a native row kernel, at each width
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("format");
+    const QImage::Format formats[] = {QImage::Format_RGB32, QImage::Format_RGB888, QImage::Format_Grayscale8};
+    const char *formatNames[] = {"rgb32", "rgb888", "gray8"};
+    for(int width : {500, 1000, 1568, 2000, 4000, 8000}){
+        for(int format = 0; format < 3; format++){
+            QTest::newRow(QByteArray::number(width) + "/" + formatNames[format]) << width << static_cast<int>(formats[format]);
+        }
+    }
+}
+
+void benchmarkMain::benchmarkRectifyRow(){
+    //One row per iteration, the cost every worker pays per row it claims
+    QFETCH(int, width);
+    QFETCH(int, format);
+    CorrectionFactor correctionFactor(width);
+    shared_ptr<const ResampleMap> resampleMap = correctionFactor.getResampleMap();
+    QImage original = syntheticImage(width, 1).convertToFormat(static_cast<QImage::Format>(format));
+    QImage rectified(resampleMap->getRectifiedWidth(), 1, original.format());
+    QBENCHMARK{
+        RectifyKernel::rectifyRows(&original, &rectified, *resampleMap, 0, 1);
+    }
+}
+
+void benchmarkMain::benchmarkThreadManager_data(){
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("threads");
+    int maxThreads = max(1, QThread::idealThreadCount());
+    for(int width : {500, 1568, 8000}){
+        for(int threads = 1; threads < maxThreads * 2; threads *= 2){
+            QTest::newRow(QString("%1px/%2t").arg(width).arg(threads).toLatin1()) << width << threads;
+        }
+        if((maxThreads & (maxThreads - 1)) != 0){
+            QTest::newRow(QString("%1px/%2t").arg(width).arg(maxThreads).toLatin1()) << width << maxThreads;
+        }
+    }
+}
+
+void benchmarkMain::benchmarkThreadManager(){
+    //Whole image from prepare() to the last row, as the GUI runs it
+    QFETCH(int, width);
+    QFETCH(int, threads);
+    QImage original = syntheticImage(width, BENCHMARK_ROWS);
+    CorrectionFactor correctionFactor(width);
+    QImage rectified;
+    ThreadManager threadManager;
+    threadManager.setResampleMap(correctionFactor.getResampleMap());
+    threadManager.setOriginalImage(&original);
+    threadManager.setRectImage(&rectified);
+    //The manager rectifies on its own pool, sized here rather than through the global one
+    WorkerConfig workerConfig;
+    workerConfig.threads = threads;
+    threadManager.setWorkerConfig(workerConfig);
+    QBENCHMARK{
+        threadManager.prepare();
+        threadManager.run().waitForFinished();
+    }
+    QCOMPARE(threadManager.rowsCompleted.load(), original.height());
+}
+
+void benchmarkMain::benchmarkDecode_data(){
+    addImageWidths();
+}
+
+void benchmarkMain::benchmarkDecode(){
+    QFETCH(int, width);
+    string inputPath = this->temporaryDir.filePath(QString("decode-%1.png").arg(width)).toStdString();
+    QVERIFY(syntheticImage(width, BENCHMARK_ROWS).save(QString::fromStdString(inputPath)));
+    FileManager fileManager;
+    fileManager.setInputFilePath(&inputPath);
+    QBENCHMARK{
+        fileManager.open();
+    }
+    QCOMPARE(fileManager.getImagePtr()->width(), width);
+}
+
+void benchmarkMain::benchmarkEncode_data(){
+    addImageWidths();
+}
+
+void benchmarkMain::benchmarkEncode(){
+    QFETCH(int, width);
+    string outputPath = this->temporaryDir.filePath(QString("encode-%1.png").arg(width)).toStdString();
+    FileManager fileManager;
+    fileManager.setOutputFilePath(&outputPath);
+    *fileManager.getRectImagePtr() = syntheticImage(width, BENCHMARK_ROWS);
+    QBENCHMARK{
+        fileManager.save();
+    }
+    QVERIFY(QFile::exists(QString::fromStdString(outputPath)));
+}
+
+void benchmarkMain::benchmarkEncodeThreads_data(){
+    //Widest image only, thread counts as for the ThreadManager benchmark
+    QTest::addColumn<int>("threads");
+    int maxThreads = max(1, QThread::idealThreadCount());
+    for(int threads = 1; threads < maxThreads * 2; threads *= 2){
+        QTest::newRow(QString("8000px/%1t").arg(threads).toLatin1()) << threads;
+    }
+    if((maxThreads & (maxThreads - 1)) != 0){
+        QTest::newRow(QString("8000px/%1t").arg(maxThreads).toLatin1()) << maxThreads;
+    }
+}
+
+void benchmarkMain::benchmarkEncodeThreads(){
+    QFETCH(int, threads);
+    QImage image = syntheticImage(8000, BENCHMARK_ROWS);
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads - 1); //The calling thread deflates too
+    QByteArray png;
+    QBENCHMARK{
+        png = PngEncoder::encode(image, false, -1, threads > 1 ? &pool : nullptr);
+    }
+    QCOMPARE(QImage::fromData(png, "PNG").width(), image.width());
+}
+
+int main(int argc, char *argv[]){
+    QCoreApplication a(argc, argv);
+    benchmarkMain benchmarks;
+    QStringList arguments = a.arguments();
+    //Default to a CSV file for tracking between builds, keeping the readable log on stdout
+    if(!arguments.contains("-o")){
+        arguments << "-o" << "benchmarks.csv,csv" << "-o" << "-,txt";
+    }
+    return QTest::qExec(&benchmarks, arguments);
+}
+
+#include "tst_benchmarks.moc"
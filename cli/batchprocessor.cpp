@@ -0,0 +1,339 @@
+//============================================================================
+// Name        : batchprocessor.cpp
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This class is responsible for rectifying a whole batch of
+//               images without any GUI. Every input file becomes one task on
+//               the file pool, which opens it through FileManager, rectifies
+//               it and saves it again. The rectification itself is split
+//               into row chunks that run on a second pool, interleaved
+//               between the files in flight, so the cores stay busy whether
+//               the batch holds one huge pass or hundreds of small ones.
+//               Resample maps are built once per image width and shared
+//               between all files of that width. Timings of every stage are
+//               recorded per file for the summary. Reprojection, when asked
+//               for, runs on the row pool too, right after the file is
+//               rectified.
+//
+//               The separate channel images of one pass (APIDs 64, 65 and
+//               68, say) can also be handed over together. They are decoded
+//               and encoded concurrently, but rectified as one job: the map
+//               is looked up once and every row chunk rectifies all channels
+//               of its rows, writing the RGB composite in the same pass when
+//               one is requested.
+//============================================================================
+
+#include "batchprocessor.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QTextStream>
+#include <algorithm>
+#include <functional>
+#include "filemanager.h"
+
+//Processes one input file on the file pool, storing the outcome in its result slot
+class FileTask: public QRunnable{
+private:
+    BatchProcessor *batchProcessor;
+    QString inputPath;
+    BatchResult *result;
+public:
+    FileTask(BatchProcessor *batchProcessor, const QString &inputPath, BatchResult *result):
+        batchProcessor(batchProcessor), inputPath(inputPath), result(result){}
+    void run() override{
+        *result = batchProcessor->processFile(inputPath);
+    }
+};
+
+//Runs any piece of work on the file pool
+class FunctionTask: public QRunnable{
+private:
+    function<void()> work;
+public:
+    FunctionTask(function<void()> work): work(work){}
+    void run() override{
+        this->work();
+    }
+};
+
+BatchProcessor::BatchProcessor(): rowScheduler(&rowPool){
+    //Start out with the same defaults the GUI uses
+    CorrectionFactor defaults(1);
+    this->earthRadius = defaults.getDefaultEarthRadius();
+    this->satelliteAltitude = defaults.getDefaultSatelliteAltitude();
+    this->satelliteSwath = defaults.getDefaultSatelliteSwath();
+    this->setJobs(QThread::idealThreadCount());
+}
+
+void BatchProcessor::setJobs(int jobs){
+    //Number of files in flight, the row pool is sized by the worker config
+    if(jobs < 1){
+        jobs = 1;
+    }
+    this->filePool.setMaxThreadCount(jobs);
+}
+
+QStringList BatchProcessor::expandInputs(const QStringList &patterns){
+    //Turn files, directories and wildcard patterns into a sorted list of files
+    QStringList inputPaths;
+    for(const QString &pattern : patterns){
+        QFileInfo patternInfo(pattern);
+        if(patternInfo.isDir()){
+            QDir directory(pattern);
+            for(const QString &fileName : directory.entryList(QStringList() << "*.png" << "*.pgm" << "*.ppm" << "*.pnm" << "*.bmp", QDir::Files, QDir::Name)){
+                inputPaths << directory.filePath(fileName);
+            }
+        } else if(pattern.contains('*') || pattern.contains('?') || pattern.contains('[')){
+            QDir directory = patternInfo.dir();
+            for(const QString &fileName : directory.entryList(QStringList() << patternInfo.fileName(), QDir::Files, QDir::Name)){
+                inputPaths << directory.filePath(fileName);
+            }
+        } else {
+            inputPaths << pattern;
+        }
+    }
+    inputPaths.removeDuplicates();
+    return inputPaths;
+}
+
+shared_ptr<const ResampleMap> BatchProcessor::getResampleMap(int imageWidth){
+    //Build the map for a width on first use, every later file of that width shares it
+    QMutexLocker locker(&this->resampleMapMutex);
+    auto found = this->resampleMaps.find(imageWidth);
+    if(found != this->resampleMaps.end()){
+        return found->second;
+    }
+    CorrectionFactor correctionFactor(imageWidth);
+    correctionFactor.setParameters(this->earthRadius, this->satelliteAltitude, this->satelliteSwath);
+    correctionFactor.setFilter(this->filter);
+    shared_ptr<const ResampleMap> resampleMap = correctionFactor.getResampleMap();
+    this->resampleMaps[imageWidth] = resampleMap;
+    return resampleMap;
+}
+
+QString BatchProcessor::outputPathFor(const QString &inputPath, const QString &extraSuffix) const{
+    //Same base name plus suffix, next to the input unless an output directory was given
+    QFileInfo inputInfo(inputPath);
+    QString fileName = inputInfo.completeBaseName() + this->suffix + extraSuffix + "." + this->outputFormat;
+    if(this->outputDirectory.isEmpty()){
+        return inputInfo.dir().filePath(fileName);
+    }
+    return QDir(this->outputDirectory).filePath(fileName);
+}
+
+void BatchProcessor::rectifyRows(const QImage *originalImage, QImage *rectifiedImage, shared_ptr<const ResampleMap> resampleMap){
+    //Queue the image alongside any other files in flight and wait for its last chunk
+    this->rowScheduler.submit(originalImage, rectifiedImage, resampleMap, originalImage->height(), nullptr).waitForFinished();
+}
+
+BatchResult BatchProcessor::processFile(const QString &inputPath){
+    BatchResult result;
+    QElapsedTimer totalTimer;
+    QElapsedTimer stageTimer;
+    totalTimer.start();
+    result.inputPath = inputPath;
+    result.outputPath = this->outputPathFor(inputPath);
+
+    FileManager fileManager;
+    string inputFilePath = inputPath.toStdString();
+    string outputFilePath = result.outputPath.toStdString();
+    try {
+        fileManager.setInputFilePath(&inputFilePath);
+        fileManager.setOutputFilePath(&outputFilePath);
+        fileManager.setCompressionLevel(this->compressionLevel);
+
+        //Decode
+        stageTimer.start();
+        fileManager.open();
+        result.decodeMs = stageTimer.elapsed();
+        const QImage *originalImage = fileManager.getImagePtr();
+        result.width = originalImage->width();
+        result.height = originalImage->height();
+
+        //Rectify
+        stageTimer.start();
+        shared_ptr<const ResampleMap> resampleMap = this->getResampleMap(originalImage->width());
+        result.rectifiedWidth = resampleMap->getRectifiedWidth();
+        QImage *rectifiedImage = fileManager.createRectImage(resampleMap->getRectifiedWidth(), originalImage->height(), originalImage->format());
+        this->rectifyRows(originalImage, rectifiedImage, resampleMap);
+        result.rectifyMs = stageTimer.elapsed();
+
+        //Reproject, while the rectified rows are still in memory
+        if(this->reprojector){
+            stageTimer.start();
+            Reprojection reprojection = this->reprojector->reproject(*rectifiedImage, fileManager.isBottomUp(), &this->rowPool);
+            QString reprojectedPath = this->outputPathFor(inputPath, this->reprojectedSuffix);
+            FileManager::writeImage(reprojection.image, reprojectedPath.toStdString(), false, this->compressionLevel);
+            reprojection.writeWorldFile(reprojectedPath.toStdString());
+            result.reprojectedPath = reprojectedPath;
+            result.reprojectMs = stageTimer.elapsed();
+        }
+
+        //Encode
+        stageTimer.start();
+        fileManager.save();
+        result.encodeMs = stageTimer.elapsed();
+    }  catch (string &e) {
+        result.error = QString::fromStdString(e);
+    }
+    result.totalMs = totalTimer.elapsed();
+    return result;
+}
+
+vector<BatchResult> BatchProcessor::run(const QStringList &inputPaths){
+    //Queue every file at once, the file pool limits how many are in flight
+    vector<BatchResult> results(inputPaths.size());
+    for(int file = 0; file < inputPaths.size(); file++){
+        FileTask *task = new FileTask(this, inputPaths[file], &results[file]);
+        task->setAutoDelete(true);
+        this->filePool.start(task);
+    }
+    this->filePool.waitForDone();
+    return results;
+}
+
+vector<BatchResult> BatchProcessor::processChannels(const QStringList &inputPaths, const QString &compositePath, array<int, 3> compositeChannels){
+    //One result per channel, plus one for the composite when it is written
+    QElapsedTimer totalTimer;
+    totalTimer.start();
+    int channels = inputPaths.size();
+    bool composite = !compositePath.isEmpty();
+    vector<BatchResult> results(channels + (composite ? 1 : 0));
+    vector<FileManager> fileManagers(channels + (composite ? 1 : 0));
+    for(int channel = 0; channel < channels; channel++){
+        results[channel].inputPath = inputPaths[channel];
+        results[channel].outputPath = this->outputPathFor(inputPaths[channel]);
+    }
+    if(composite){
+        results[channels].inputPath = compositePath;
+        results[channels].outputPath = compositePath;
+    }
+    auto failAll = [&](const QString &error){
+        for(BatchResult &result : results){
+            if(result.error.isEmpty()){
+                result.error = error;
+            }
+            result.totalMs = totalTimer.elapsed();
+        }
+        return results;
+    };
+
+    //Decode every channel at once
+    for(int channel = 0; channel < channels; channel++){
+        FunctionTask *task = new FunctionTask([&, channel](){
+            QElapsedTimer stageTimer;
+            stageTimer.start();
+            string inputFilePath = results[channel].inputPath.toStdString();
+            string outputFilePath = results[channel].outputPath.toStdString();
+            try {
+                fileManagers[channel].setInputFilePath(&inputFilePath);
+                fileManagers[channel].setOutputFilePath(&outputFilePath);
+                fileManagers[channel].open();
+            }  catch (string &e) {
+                results[channel].error = QString::fromStdString(e);
+            }
+            results[channel].decodeMs = stageTimer.elapsed();
+        });
+        task->setAutoDelete(true);
+        this->filePool.start(task);
+    }
+    this->filePool.waitForDone();
+    for(int channel = 0; channel < channels; channel++){
+        if(!results[channel].error.isEmpty()){
+            return failAll("Another channel failed to decode");
+        }
+        if(fileManagers[channel].getImagePtr()->size() != fileManagers[0].getImagePtr()->size()){
+            return failAll("Channel images differ in size");
+        }
+    }
+    if(channels == 0 || (composite && *max_element(compositeChannels.begin(), compositeChannels.end()) >= channels)){
+        return failAll("Composite channel out of range");
+    }
+
+    //Rectify every channel, and the composite, in a single pass over the rows
+    QElapsedTimer stageTimer;
+    stageTimer.start();
+    int width = fileManagers[0].getImagePtr()->width();
+    int height = fileManagers[0].getImagePtr()->height();
+    shared_ptr<const ResampleMap> resampleMap = this->getResampleMap(width);
+    vector<const QImage *> originalImages;
+    vector<QImage *> rectifiedImages;
+    try {
+        for(int channel = 0; channel < channels; channel++){
+            const QImage *originalImage = fileManagers[channel].getImagePtr();
+            originalImages.push_back(originalImage);
+            rectifiedImages.push_back(fileManagers[channel].createRectImage(resampleMap->getRectifiedWidth(), height, originalImage->format()));
+        }
+        QImage *compositeImage = nullptr;
+        if(composite){
+            string compositeFilePath = compositePath.toStdString();
+            fileManagers[channels].setOutputFilePath(&compositeFilePath);
+            fileManagers[channels].setBottomUp(fileManagers[0].isBottomUp()); //Composite rows come in the channels' row order
+            compositeImage = fileManagers[channels].createRectImage(resampleMap->getRectifiedWidth(), height, QImage::Format_RGB32);
+        }
+        this->rowScheduler.submitChannels(originalImages, rectifiedImages, compositeImage, compositeChannels, resampleMap, height, nullptr).waitForFinished();
+    }  catch (string &e) {
+        return failAll(QString::fromStdString(e));
+    }
+    qint64 rectifyMs = stageTimer.elapsed();
+
+    //Encode everything at once
+    for(size_t file = 0; file < results.size(); file++){
+        results[file].width = width;
+        results[file].height = height;
+        results[file].rectifiedWidth = resampleMap->getRectifiedWidth();
+        results[file].rectifyMs = rectifyMs;
+        FunctionTask *task = new FunctionTask([&, file](){
+            QElapsedTimer encodeTimer;
+            encodeTimer.start();
+            try {
+                fileManagers[file].setCompressionLevel(this->compressionLevel);
+                fileManagers[file].save();
+            }  catch (string &e) {
+                results[file].error = QString::fromStdString(e);
+            }
+            results[file].encodeMs = encodeTimer.elapsed();
+        });
+        task->setAutoDelete(true);
+        this->filePool.start(task);
+    }
+    this->filePool.waitForDone();
+    for(BatchResult &result : results){
+        result.totalMs = totalTimer.elapsed();
+    }
+    return results;
+}
+
+QString BatchProcessor::formatSummary(const vector<BatchResult> &results, qint64 wallMs){
+    //One line per file plus the totals
+    QString summary;
+    QTextStream stream(&summary);
+    int failed = 0;
+    qint64 pixels = 0;
+    for(const BatchResult &result : results){
+        stream << QFileInfo(result.inputPath).fileName() << ": ";
+        if(result.error.isEmpty()){
+            stream << result.width << "x" << result.height << " -> " << result.rectifiedWidth << "x" << result.height
+                   << "  decode " << result.decodeMs << " ms"
+                   << "  rectify " << result.rectifyMs << " ms"
+                   << "  encode " << result.encodeMs << " ms";
+            if(!result.reprojectedPath.isEmpty()){
+                stream << "  reproject " << result.reprojectMs << " ms";
+            }
+            stream << "  total " << result.totalMs << " ms\n";
+            pixels += static_cast<qint64>(result.rectifiedWidth) * result.height;
+        } else {
+            stream << "FAILED (" << result.error << ") after " << result.totalMs << " ms\n";
+            failed++;
+        }
+    }
+    stream << results.size() - failed << " of " << results.size() << " images rectified in " << wallMs << " ms";
+    if(wallMs > 0){
+        stream << " (" << QString::number(pixels / 1000.0 / wallMs, 'f', 1) << " Mpx/s)";
+    }
+    stream << "\n";
+    return summary;
+}
@@ -0,0 +1,90 @@
+//============================================================================
+// Name        : batchprocessor.h
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is the class definition of BatchProcessor. Special note
+//               is the pair of thread pools: one decodes, rectifies and
+//               encodes whole files, the other rectifies row chunks of every
+//               file in flight, so a handful of large files still keeps
+//               every core busy, or as many cores as setWorkerConfig()
+//               allows it. The channels of one pass can instead be
+//               processed as a single job sharing one map and one row pass.
+//               With a Reprojector set, every rectified file is also written
+//               on a latitude/longitude grid, with a world file next to it.
+//============================================================================
+
+#ifndef BATCHPROCESSOR_H
+#define BATCHPROCESSOR_H
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <array>
+#include <map>
+#include <memory>
+#include <vector>
+#include "correctionfactor.h"
+#include "reprojector.h"
+#include "rowscheduler.h"
+#include "workerpool.h"
+
+using namespace std;
+
+struct BatchResult{
+    QString inputPath;
+    QString outputPath;
+    int width = 0;
+    int height = 0;
+    int rectifiedWidth = 0;
+    qint64 decodeMs = 0;
+    qint64 rectifyMs = 0;
+    qint64 encodeMs = 0;
+    qint64 reprojectMs = 0;
+    qint64 totalMs = 0;
+    QString reprojectedPath; //Empty unless the file was also reprojected
+    QString error; //Empty when the file was processed successfully
+};
+
+class BatchProcessor{
+private:
+    QString outputDirectory = "";
+    QString suffix = "-rectified";
+    QString outputFormat = "png"; //Extension of the written files, pgm/ppm/bmp are written through memory mapping
+    double earthRadius;
+    double satelliteAltitude;
+    int satelliteSwath;
+    ResampleFilter filter = ResampleFilter::Linear;
+    int compressionLevel = -1; //zlib level for PNG output, -1 for the encoder's default
+    shared_ptr<const Reprojector> reprojector; //Optional, reprojects every rectified file onto a lat/lon grid
+    QString reprojectedSuffix = "-latlon"; //Appended after suffix for the reprojected files
+    QThreadPool filePool;
+    WorkerPool rowPool; //One thread per usable CPU unless configured otherwise
+    RowScheduler rowScheduler; //Every file in flight queues its rows here, so their chunks interleave on the row pool
+    map<int, shared_ptr<const ResampleMap>> resampleMaps; //One map per image width seen in the batch
+    QMutex resampleMapMutex;
+    shared_ptr<const ResampleMap> getResampleMap(int imageWidth);
+    QString outputPathFor(const QString &inputPath, const QString &extraSuffix = "") const;
+    void rectifyRows(const QImage *originalImage, QImage *rectifiedImage, shared_ptr<const ResampleMap> resampleMap);
+public:
+    BatchProcessor();
+    static QStringList expandInputs(const QStringList &patterns);
+    static QString formatSummary(const vector<BatchResult> &results, qint64 wallMs);
+    void setOutputDirectory(const QString &outputDirectory){this->outputDirectory = outputDirectory;}
+    void setSuffix(const QString &suffix){this->suffix = suffix;}
+    void setOutputFormat(const QString &outputFormat){this->outputFormat = outputFormat;}
+    void setEarthRadius(double earthRadius){this->earthRadius = earthRadius;}
+    void setSatelliteAltitude(double satelliteAltitude){this->satelliteAltitude = satelliteAltitude;}
+    void setSatelliteSwath(int satelliteSwath){this->satelliteSwath = satelliteSwath;}
+    void setFilter(ResampleFilter filter){this->filter = filter;}
+    void setCompressionLevel(int compressionLevel){this->compressionLevel = compressionLevel;}
+    void setReprojector(shared_ptr<const Reprojector> reprojector){this->reprojector = reprojector;}
+    void setJobs(int jobs);
+    void setWorkerConfig(const WorkerConfig &config){this->rowPool.configure(config);}
+    const WorkerConfig &getWorkerConfig() const {return this->rowPool.getConfig();}
+    BatchResult processFile(const QString &inputPath);
+    vector<BatchResult> run(const QStringList &inputPaths);
+    vector<BatchResult> processChannels(const QStringList &inputPaths, const QString &compositePath, array<int, 3> compositeChannels);
+};
+
+#endif // BATCHPROCESSOR_H
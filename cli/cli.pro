@@ -0,0 +1,54 @@
+QT       += core gui
+
+CONFIG += c++14 console thread
+CONFIG -= app_bundle
+
+LIBS += -lz
+
+TARGET = meteor_rectifyCLI
+
+INCLUDEPATH += ../app
+
+SOURCES += \
+    batchprocessor.cpp \
+    main.cpp \
+    ../app/bufferpool.cpp \
+    ../app/correctionfactor.cpp \
+    ../app/correctiontable.cpp \
+    ../app/correctiontablecache.cpp \
+    ../app/filemanager.cpp \
+    ../app/idlethreads.cpp \
+    ../app/orbit.cpp \
+    ../app/pngencoder.cpp \
+    ../app/rectifykernel.cpp \
+    ../app/rectifythread.cpp \
+    ../app/reprojector.cpp \
+    ../app/resamplemap.cpp \
+    ../app/rowscheduler.cpp \
+    ../app/striprectifier.cpp \
+    ../app/tracer.cpp \
+    ../app/workerpool.cpp
+
+HEADERS += \
+    batchprocessor.h \
+    ../app/bufferpool.h \
+    ../app/correctionfactor.h \
+    ../app/correctiontable.h \
+    ../app/correctiontablecache.h \
+    ../app/filemanager.h \
+    ../app/idlethreads.h \
+    ../app/orbit.h \
+    ../app/pngencoder.h \
+    ../app/rectifykernel.h \
+    ../app/rectifythread.h \
+    ../app/reprojector.h \
+    ../app/resamplemap.h \
+    ../app/rowscheduler.h \
+    ../app/striprectifier.h \
+    ../app/tracer.h \
+    ../app/workerpool.h
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,320 @@
+//============================================================================
+// Name        : main.cpp
+// Author      : TGYK
+// Date        : 10/17/2026
+// E-Mail      : tgyk@tgyk.net
+// Description : This is where the headless batch tool starts from. It only
+//               needs QtCore and QtGui, so it starts fast on servers without
+//               a display. Inputs may be files, directories or wildcard
+//               patterns, and every image is rectified with the same
+//               parameters the GUI sliders control. With --stream, a single
+//               PGM/PPM or PNG image is rectified band by band from a file
+//               or stdin and written as PGM/PPM, in constant memory. The
+//               --filter option picks linear, cubic or Lanczos-3 resampling.
+//               With --channels, the inputs are the channels of one pass and
+//               are rectified together, optionally into an RGB composite.
+//               With --trace, stage timings are saved as Chrome trace JSON
+//               and summarised once the run is over. Given --tle and the
+//               --start time of the pass, every rectified image is also
+//               reprojected onto a latitude/longitude grid. The rectifying
+//               threads are set up from the settings file the GUI shares,
+//               or the one --config names, and then from --threads,
+//               --affinity and --cpus.
+//============================================================================
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QTextStream>
+#include <QThread>
+#include "batchprocessor.h"
+#include "filemanager.h"
+#include "reprojector.h"
+#include "striprectifier.h"
+#include "tracer.h"
+#include "workerpool.h"
+
+//Save the recorded timings and print their summary, returns false on failure
+static bool writeTrace(const QString &tracePath, QTextStream &log){
+    try {
+        Tracer::instance().writeChromeTrace(tracePath.toStdString());
+    }  catch (string &e) {
+        log << QString::fromStdString(e) << "\n";
+        return false;
+    }
+    log << Tracer::instance().summary() << "\n";
+    return true;
+}
+
+int main(int argc, char *argv[]){
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("meteor_rectifyCLI");
+    QCoreApplication::setApplicationVersion("1.0");
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    CorrectionFactor defaults(1);
+
+    //Describe the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Rectifies Meteor-M2 images in batch.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("inputs", "Images, directories or wildcard patterns to rectify.", "inputs...");
+    QCommandLineOption outputOption(QStringList() << "o" << "output-dir", "Directory to write rectified images to. Defaults to next to each input.", "dir");
+    QCommandLineOption formatOption("format", "Output format: png, or pgm, ppm, pnm or bmp written through memory mapping.", "format", "png");
+    QCommandLineOption suffixOption("suffix", "Suffix appended to output file names.", "suffix", "-rectified");
+    QCommandLineOption radiusOption("radius", "Earth radius in km.", "km", QString::number(defaults.getDefaultEarthRadius()));
+    QCommandLineOption altitudeOption("altitude", "Satellite altitude in km.", "km", QString::number(defaults.getDefaultSatelliteAltitude()));
+    QCommandLineOption swathOption("swath", "Satellite swath in km.", "km", QString::number(defaults.getDefaultSatelliteSwath()));
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs", "Number of images processed at once.", "n", QString::number(QThread::idealThreadCount()));
+    QCommandLineOption streamOption("stream", "Rectify one PGM/PPM or PNG image (stdin as -) band by band, writing PGM/PPM to the second argument or stdout.");
+    QCommandLineOption bandRowsOption("band-rows", "Rows held in memory per band in stream mode.", "rows", "256");
+    QCommandLineOption channelsOption("channels", "Treat the inputs as equally sized channels of one pass and rectify them in a single job.");
+    QCommandLineOption compositeOption("composite", "With --channels, also write an RGB composite to this file.", "file");
+    QCommandLineOption compositeOrderOption("composite-order", "Inputs (1-based) used for the red, green and blue of the composite.", "r,g,b", "1,2,3");
+    QCommandLineOption compressionOption("compression", "zlib level 0 (fastest) to 9 (smallest) for PNG output, -1 for the default.", "level", "-1");
+    QCommandLineOption traceOption("trace", "Record stage and worker timings, write them to this file as Chrome trace JSON and print a summary.", "file");
+    QCommandLineOption tleOption("tle", "Also reproject each rectified image onto a lat/lon grid, using the orbit in this two-line element file.", "file");
+    QCommandLineOption satelliteOption("satellite", "Name of the element set to use when the file holds several.", "name");
+    QCommandLineOption startOption("start", "UTC time of the first image row for --tle, as ISO 8601 (2021-01-01T12:20:00Z).", "time");
+    QCommandLineOption lineTimeOption("line-time", "Seconds between image rows for --tle.", "seconds", QString::number(Reprojector::defaultLineSeconds));
+    QCommandLineOption gridOption("grid", "Control grid spacing in pixels for --tle, the orbit is only evaluated on this grid.", "pixels", QString::number(Reprojector::defaultGridStep));
+    QCommandLineOption threadsOption("threads", "Rectifying threads, 0 for one per usable CPU.", "n");
+    QCommandLineOption affinityOption("affinity", "Pin rectifying threads: none, compact (fill a NUMA node first) or spread (across nodes).", "mode");
+    QCommandLineOption cpusOption("cpus", "CPUs the rectifying threads may use, such as 0-7,16-23.", "list");
+    QCommandLineOption configOption("config", "Read the worker settings from this INI file instead of the shared settings.", "file");
+    QCommandLineOption resolutionOption("resolution", "Degrees per pixel of the reprojected images, 0 to match the rectified resolution.", "degrees", "0");
+    QCommandLineOption filterOption("filter", "Resampling filter: linear, cubic or lanczos3.", "filter", "linear");
+    parser.addOption(outputOption);
+    parser.addOption(suffixOption);
+    parser.addOption(formatOption);
+    parser.addOption(compressionOption);
+    parser.addOption(radiusOption);
+    parser.addOption(altitudeOption);
+    parser.addOption(swathOption);
+    parser.addOption(jobsOption);
+    parser.addOption(streamOption);
+    parser.addOption(bandRowsOption);
+    parser.addOption(filterOption);
+    parser.addOption(channelsOption);
+    parser.addOption(compositeOption);
+    parser.addOption(compositeOrderOption);
+    parser.addOption(traceOption);
+    parser.addOption(tleOption);
+    parser.addOption(satelliteOption);
+    parser.addOption(startOption);
+    parser.addOption(lineTimeOption);
+    parser.addOption(gridOption);
+    parser.addOption(resolutionOption);
+    parser.addOption(threadsOption);
+    parser.addOption(affinityOption);
+    parser.addOption(cpusOption);
+    parser.addOption(configOption);
+    parser.process(a);
+
+    //Validate the numeric options
+    bool radiusOk, altitudeOk, swathOk, jobsOk, bandRowsOk, compressionOk;
+    double earthRadius = parser.value(radiusOption).toDouble(&radiusOk);
+    double satelliteAltitude = parser.value(altitudeOption).toDouble(&altitudeOk);
+    int satelliteSwath = parser.value(swathOption).toInt(&swathOk);
+    int jobs = parser.value(jobsOption).toInt(&jobsOk);
+    int bandRows = parser.value(bandRowsOption).toInt(&bandRowsOk);
+    int compressionLevel = parser.value(compressionOption).toInt(&compressionOk);
+    if(!radiusOk || !altitudeOk || !swathOk || !jobsOk || !bandRowsOk || !compressionOk || earthRadius <= 0 || satelliteAltitude <= 0 || satelliteSwath <= 0 || bandRows < 1 || compressionLevel < -1 || compressionLevel > 9){
+        err << "Invalid radius, altitude, swath, jobs, band rows or compression value\n";
+        return 2;
+    }
+    QString outputFormat = parser.value(formatOption).toLower();
+    if(outputFormat != "png" && !FileManager::isRawFormat(("output." + outputFormat).toStdString())){
+        err << "Invalid format, expected png, pgm, ppm, pnm or bmp\n";
+        return 2;
+    }
+    ResampleFilter filter;
+    QString filterName = parser.value(filterOption).toLower();
+    if(filterName == "linear"){
+        filter = ResampleFilter::Linear;
+    } else if(filterName == "cubic"){
+        filter = ResampleFilter::Cubic;
+    } else if(filterName == "lanczos3"){
+        filter = ResampleFilter::Lanczos3;
+    } else {
+        err << "Invalid filter, expected linear, cubic or lanczos3\n";
+        return 2;
+    }
+
+    //Worker threads as the settings file has them, the command line overriding
+    WorkerConfig workerConfig;
+    if(parser.isSet(configOption)){
+        if(!QFileInfo(parser.value(configOption)).isFile()){
+            err << "Unable to read config file " << parser.value(configOption) << "\n";
+            return 2;
+        }
+        workerConfig = WorkerConfig::load(QSettings(parser.value(configOption), QSettings::IniFormat));
+    } else {
+        workerConfig = WorkerConfig::load(QSettings("TGYK", "meteor_rectify"));
+    }
+    bool threadsOk = true;
+    if(parser.isSet(threadsOption)){
+        workerConfig.threads = parser.value(threadsOption).toInt(&threadsOk);
+    }
+    bool affinityOk = !parser.isSet(affinityOption) || WorkerPool::parseAffinity(parser.value(affinityOption), &workerConfig.affinity);
+    bool cpusOk = !parser.isSet(cpusOption) || WorkerPool::parseCpuList(parser.value(cpusOption), &workerConfig.cpus);
+    if(!threadsOk || workerConfig.threads < 0 || !affinityOk || !cpusOk){
+        err << "Invalid threads, affinity or cpus value, expected a count, none, compact or spread, and a list such as 0-3,8\n";
+        return 2;
+    }
+
+    //Set up reprojection from the orbit, when asked for
+    shared_ptr<Reprojector> reprojector;
+    if(parser.isSet(tleOption)){
+        if(parser.isSet(streamOption) || parser.isSet(channelsOption)){
+            err << "Reprojection only works on batch runs, not with --stream or --channels\n";
+            return 2;
+        }
+        QDateTime startTime = QDateTime::fromString(parser.value(startOption), Qt::ISODate);
+        if(!startTime.isValid()){
+            err << "Reprojection needs the UTC --start time of the pass, such as 2021-01-01T12:20:00Z\n";
+            return 2;
+        }
+        if(startTime.timeSpec() == Qt::LocalTime){
+            startTime.setTimeSpec(Qt::UTC);
+        }
+        bool lineTimeOk, gridOk, resolutionOk;
+        double lineSeconds = parser.value(lineTimeOption).toDouble(&lineTimeOk);
+        int gridStep = parser.value(gridOption).toInt(&gridOk);
+        double degreesPerPixel = parser.value(resolutionOption).toDouble(&resolutionOk);
+        if(!lineTimeOk || !gridOk || !resolutionOk || lineSeconds <= 0 || gridStep < 1 || degreesPerPixel < 0){
+            err << "Invalid line time, grid or resolution value\n";
+            return 2;
+        }
+        try {
+            Orbit orbit(Orbit::readTle(parser.value(tleOption).toStdString(), parser.value(satelliteOption)));
+            reprojector = make_shared<Reprojector>(orbit, startTime);
+        }  catch (string &e) {
+            err << QString::fromStdString(e) << "\n";
+            return 2;
+        }
+        reprojector->setLineSeconds(lineSeconds);
+        reprojector->setGridStep(gridStep);
+        reprojector->setDegreesPerPixel(degreesPerPixel);
+        reprojector->setEarthRadius(earthRadius);
+        reprojector->setSatelliteSwath(satelliteSwath);
+    }
+
+    //Only record timings when asked, recording costs a lock per event
+    Tracer::instance().setEnabled(parser.isSet(traceOption));
+
+    if(parser.isSet(streamOption)){
+        //Stream a single image, keeping stdout free for the image data
+        QStringList arguments = parser.positionalArguments();
+        if(arguments.isEmpty() || arguments.size() > 2){
+            err << "Stream mode takes one input and an optional output\n";
+            return 2;
+        }
+        WorkerPool workerPool; //Outlives the rectifier, whose scheduler waits for its workers
+        workerPool.configure(workerConfig);
+        StripRectifier stripRectifier(&workerPool);
+        stripRectifier.setEarthRadius(earthRadius);
+        stripRectifier.setSatelliteAltitude(satelliteAltitude);
+        stripRectifier.setSatelliteSwath(satelliteSwath);
+        stripRectifier.setBandRows(bandRows);
+        stripRectifier.setFilter(filter);
+
+        QFile input;
+        QFile output;
+        bool outputOpened;
+        if(arguments.size() == 2 && arguments[1] != "-"){
+            output.setFileName(arguments[1]);
+            outputOpened = output.open(QIODevice::WriteOnly);
+        } else {
+            outputOpened = output.open(stdout, QIODevice::WriteOnly);
+        }
+        if(!outputOpened){
+            err << "Unable to open output\n";
+            return 2;
+        }
+
+        QElapsedTimer streamTimer;
+        streamTimer.start();
+        try {
+            if(arguments[0] == "-"){
+                input.open(stdin, QIODevice::ReadOnly);
+                stripRectifier.rectify(&input, &output);
+            } else {
+                stripRectifier.rectifyFile(arguments[0], &output);
+            }
+        }  catch (string &e) {
+            err << QString::fromStdString(e) << "\n";
+            return 1;
+        }
+        output.flush();
+        err << stripRectifier.getRowsWritten() << " rows streamed in " << streamTimer.elapsed() << " ms\n";
+        if(parser.isSet(traceOption) && !writeTrace(parser.value(traceOption), err)){
+            return 1;
+        }
+        return 0;
+    }
+
+    QStringList inputPaths = BatchProcessor::expandInputs(parser.positionalArguments());
+    if(inputPaths.isEmpty()){
+        err << "No input images\n";
+        err.flush();
+        parser.showHelp(2);
+    }
+    if(parser.isSet(outputOption) && !QDir().mkpath(parser.value(outputOption))){
+        err << "Unable to create output directory " << parser.value(outputOption) << "\n";
+        return 2;
+    }
+
+    //Composite channels are given 1-based on the command line
+    array<int, 3> compositeChannels;
+    QStringList compositeOrder = parser.value(compositeOrderOption).split(',');
+    bool compositeOrderOk = compositeOrder.size() == 3;
+    for(int color = 0; color < 3 && compositeOrderOk; color++){
+        compositeChannels[color] = compositeOrder[color].toInt(&compositeOrderOk) - 1;
+        compositeOrderOk = compositeOrderOk && compositeChannels[color] >= 0 && compositeChannels[color] < inputPaths.size();
+    }
+    if(parser.isSet(channelsOption) && parser.isSet(compositeOption) && !compositeOrderOk){
+        err << "Invalid composite order, expected three input numbers such as 1,2,3\n";
+        return 2;
+    }
+
+    //Rectify everything and report
+    BatchProcessor batchProcessor;
+    batchProcessor.setOutputDirectory(parser.value(outputOption));
+    batchProcessor.setSuffix(parser.value(suffixOption));
+    batchProcessor.setOutputFormat(outputFormat);
+    batchProcessor.setEarthRadius(earthRadius);
+    batchProcessor.setSatelliteAltitude(satelliteAltitude);
+    batchProcessor.setSatelliteSwath(satelliteSwath);
+    batchProcessor.setFilter(filter);
+    batchProcessor.setCompressionLevel(compressionLevel);
+    batchProcessor.setJobs(jobs);
+    batchProcessor.setWorkerConfig(workerConfig);
+    batchProcessor.setReprojector(reprojector);
+
+    QElapsedTimer wallTimer;
+    wallTimer.start();
+    vector<BatchResult> results;
+    if(parser.isSet(channelsOption)){
+        results = batchProcessor.processChannels(inputPaths, parser.value(compositeOption), compositeChannels);
+    } else {
+        results = batchProcessor.run(inputPaths);
+    }
+    out << BatchProcessor::formatSummary(results, wallTimer.elapsed());
+    if(parser.isSet(traceOption) && !writeTrace(parser.value(traceOption), out)){
+        return 1;
+    }
+
+    for(const BatchResult &result : results){
+        if(!result.error.isEmpty()){
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -2,4 +2,6 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
     app \
+    benchmarks \
+    cli \
     tests
@@ -4,22 +4,58 @@ QT += core gui
 
 CONFIG += c++14 thread
 
-INCLUDEPATH += ../app
+LIBS += -lz
+
+INCLUDEPATH += ../app ../cli
 SOURCES +=  tst_testmain.cpp \
+            ../cli/batchprocessor.cpp \
+            ../app/bufferpool.cpp \
             ../app/correctionfactor.cpp \
+            ../app/correctiontable.cpp \
+            ../app/correctiontablecache.cpp \
+            ../app/displaypyramid.cpp \
             ../app/filemanager.cpp \
+            ../app/idlethreads.cpp \
+            ../app/imagewriter.cpp \
             ../app/mainwindow.cpp \
+            ../app/orbit.cpp \
+            ../app/pngencoder.cpp \
+            ../app/previewrenderer.cpp \
+            ../app/rectifykernel.cpp \
             ../app/rectifythread.cpp \
-            ../app/threadmanager.cpp
+            ../app/reprojector.cpp \
+            ../app/resamplemap.cpp \
+            ../app/rowscheduler.cpp \
+            ../app/striprectifier.cpp \
+            ../app/threadmanager.cpp \
+            ../app/tracer.cpp \
+            ../app/workerpool.cpp
 
 RESOURCES += \
     tst_testimage.qrc
 
-HEADERS +=  ../app/correctionfactor.h \
+HEADERS +=  ../cli/batchprocessor.h \
+            ../app/bufferpool.h \
+            ../app/correctionfactor.h \
+            ../app/correctiontable.h \
+            ../app/correctiontablecache.h \
+            ../app/displaypyramid.h \
             ../app/filemanager.h \
+            ../app/idlethreads.h \
+            ../app/imagewriter.h \
             ../app/mainwindow.h \
+            ../app/orbit.h \
+            ../app/pngencoder.h \
+            ../app/previewrenderer.h \
+            ../app/rectifykernel.h \
             ../app/rectifythread.h \
-            ../app/threadmanager.h
+            ../app/reprojector.h \
+            ../app/resamplemap.h \
+            ../app/rowscheduler.h \
+            ../app/striprectifier.h \
+            ../app/threadmanager.h \
+            ../app/tracer.h \
+            ../app/workerpool.h
 
 FORMS += ../app/mainwindow.ui
 
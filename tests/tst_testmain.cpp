@@ -16,8 +16,25 @@
 #include <QtTest>
 #include <QCoreApplication>
 #include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <mainwindow.h>
 #include <rectifythread.h>
+#include <rectifykernel.h>
+#include <batchprocessor.h>
+#include <striprectifier.h>
+#include <previewrenderer.h>
+#include <imagewriter.h>
+#include <pngencoder.h>
+#include <tracer.h>
+#include <displaypyramid.h>
+#include <orbit.h>
+#include <reprojector.h>
+#include <workerpool.h>
+#include <bufferpool.h>
+#include <thread>
+#include <zlib.h>
 
 // add necessary includes here
 const int IMAGE_WIDTH = 1568;
@@ -35,8 +52,6 @@ const string TEST_IMAGE_OUTPUT_PATH = QString(QDir::currentPath() + QString("/te
 const QImage TEST_IMAGE = QImage(":/testimage.png");
 const QImage TEST_IMAGE_RECTIFIED = QImage(":/testimage-rectified.png");
 
-QMutex RectifyThread::mutex;
-
 class testMain : public QObject
 {
     Q_OBJECT
@@ -44,6 +59,8 @@ public:
     testMain();
     ~testMain();
 private slots:
+    //BufferPool tests
+    void testAcquireImage();
     //CorrectionFactor tests
     void testSetImageWidth();
     void testSetEarthRadius();
@@ -57,6 +74,15 @@ private slots:
     void testGetDefaultSatelliteAltitude();
     void testGetDefaultSatelliteSwath();
     void testGetVector();
+    void testGetResampleMap();
+    void testSetParameters();
+    void testCalcReferenceVector();
+    void testGetTable();
+    //CorrectionTableCache tests
+    void testLookup();
+    //DisplayPyramid tests
+    void testHalve();
+    void testBuildPyramid();
     //FileManager tests
     void testSetInputFilePath();
     void testSetOutputFilePath();
@@ -68,15 +94,58 @@ private slots:
     void testGetOutputFilePath();
     void testGetImagePtr();
     void testGetRectImagePtr();
+    void testOpenRaw();
+    void testCreateRectImage();
+    //ImageWriter tests
+    void testEnqueue();
+    //Orbit tests
+    void testParseTle();
+    void testStateAt();
+    //PngEncoder tests
+    void testEncode();
+    //RectifyKernel tests
+    void testRectifyRow();
+    void testRectifyRowBytes();
+    void testRectifyRowFilter();
+    void testRectifyTile();
     //RectifyThread tests
     void testRunRT();
+    //Reprojector tests
+    void testLocate();
+    void testReproject();
+    void testReprojectPolar();
+    //RowScheduler tests
+    void testChunkRowsFor();
+    void testSubmit();
+    void testCancel();
+    void testSubmitChannels();
+    void testTileColumnsFor();
+    void testSubmitRegion();
+    void testCompletedRows();
     //ThreadManager tests
     void testSetOriginalImage();
     void testSetRectImage();
-    void testSetCorrectionFactorVector();
-    void testSetRectifiedWidth();
+    void testSetResampleMap();
     void testPrepare();
     void testRunTM();
+    //Tracer tests
+    void testTracer();
+    //WorkerPool tests
+    void testParseCpuList();
+    void testPlacementFor();
+    void testConfigure();
+    //PreviewRenderer tests
+    void testSetSource();
+    void testRender();
+    //BatchProcessor tests
+    void testExpandInputs();
+    void testProcessFile();
+    void testRunBP();
+    void testProcessChannels();
+    //StripRectifier tests
+    void testRectifyPnm();
+    void testRectifyFile();
+    void testRectifyPng();
     //MainWindow tests --- Not implemented due to use of fileDialog: Unable to find
     //                     resources documenting how to control the fileDialog
     //                     popup window.. All other actions are barred based on use
@@ -90,18 +159,65 @@ private slots:
 };
 
 testMain::testMain(){
+    //Keep cached correction tables away from the user's own cache directory
+    QStandardPaths::setTestModeEnabled(true);
 }
 
 testMain::~testMain(){
 }
 
+void testMain::testAcquireImage(){
+    //Released images hand their buffer to the next one that fits, shallow copies keep it out of the pool
+    BufferPool bufferPool;
+    QImage first = bufferPool.acquireImage(1000, 1100, QImage::Format_Grayscale8);
+    QVERIFY(!first.isNull());
+    QCOMPARE(first.bytesPerLine() % BufferPool::rowAlignment, 0);
+    QCOMPARE(reinterpret_cast<quintptr>(first.constBits()) % BufferPool::rowAlignment, quintptr(0));
+    first.fill(1);
+    const uchar *pixels = first.constBits();
+    QCOMPARE(bufferPool.getAllocationCount(), qint64(1));
+    first = QImage();
+    QCOMPARE(bufferPool.getIdleCount(), 1);
+
+    //A slightly wider image still fits the same buffer
+    QImage wider = bufferPool.acquireImage(1040, 1100, QImage::Format_Grayscale8);
+    QCOMPARE(wider.constBits(), pixels);
+    QCOMPARE(bufferPool.getReuseCount(), qint64(1));
+    QImage copy = wider;
+    wider = QImage();
+    QImage second = bufferPool.acquireImage(1000, 1100, QImage::Format_Grayscale8);
+    QVERIFY(second.constBits() != pixels);
+    QCOMPARE(bufferPool.getAllocationCount(), qint64(2));
+
+    //Small images are not pooled, and idle buffers past the cap are freed
+    QImage small = bufferPool.acquireImage(10, 10, QImage::Format_Grayscale8);
+    QVERIFY(!small.isNull());
+    QCOMPARE(bufferPool.getAllocationCount(), qint64(2));
+    copy = QImage();
+    second = QImage();
+    QCOMPARE(bufferPool.getIdleCount(), 2);
+    bufferPool.setMaxIdleBytes(0);
+    QCOMPARE(bufferPool.getIdleCount(), 0);
+    QCOMPARE(bufferPool.getIdleBytes(), qint64(0));
+
+    //An image may outlive its pool
+    QImage survivor;
+    {
+        BufferPool shortLived;
+        survivor = shortLived.acquireImage(2000, 2000, QImage::Format_RGB32);
+    }
+    survivor.fill(Qt::black);
+    QCOMPARE(survivor.pixel(1999, 1999), qRgb(0, 0, 0));
+}
+
 void testMain::testSetImageWidth(){
     CorrectionFactor correctionFactor(IMAGE_WIDTH);
     double vectorSum = 0;
 
     correctionFactor.setImageWidth(500);
-    for(int i = 0; i < static_cast<int>(correctionFactor.getVector().size()); i++){
-        vectorSum += correctionFactor.getVector()[i];
+    shared_ptr<const CorrectionTable> correctionTable = correctionFactor.getTable();
+    for(int i = 0; i < correctionTable->getSize(); i++){
+        vectorSum += (*correctionTable)[i];
     }
 
     QCOMPARE(correctionFactor.getRectifiedWidth(), 894);
@@ -114,8 +230,9 @@ void testMain::testSetEarthRadius(){
     double vectorSum = 0;
 
     correctionFactor.setEarthRadius(EARTH_RADIUS + 500 );
-    for(int i = 0; i < static_cast<int>(correctionFactor.getVector().size()); i++){
-        vectorSum += correctionFactor.getVector()[i];
+    shared_ptr<const CorrectionTable> correctionTable = correctionFactor.getTable();
+    for(int i = 0; i < correctionTable->getSize(); i++){
+        vectorSum += (*correctionTable)[i];
     }
 
     QCOMPARE(correctionFactor.getEarthRadius(), 6871);
@@ -127,8 +244,9 @@ void testMain::testSetSatelliteAltitude(){
     double vectorSum = 0;
 
     correctionFactor.setSatelliteAltitude(SATELLITE_ALTITUDE + 500);
-    for(int i = 0; i < static_cast<int>(correctionFactor.getVector().size()); i++){
-        vectorSum += correctionFactor.getVector()[i];
+    shared_ptr<const CorrectionTable> correctionTable = correctionFactor.getTable();
+    for(int i = 0; i < correctionTable->getSize(); i++){
+        vectorSum += (*correctionTable)[i];
     }
 
     QCOMPARE(correctionFactor.getSatelliteAltitude(), 1322.5);
@@ -140,8 +258,9 @@ void testMain::testSetSatelliteSwath(){
     double vectorSum = 0;
 
     correctionFactor.setSatelliteSwath(SATELLITE_SWATH + 500);
-    for(int i = 0; i < static_cast<int>(correctionFactor.getVector().size()); i++){
-        vectorSum += correctionFactor.getVector()[i];
+    shared_ptr<const CorrectionTable> correctionTable = correctionFactor.getTable();
+    for(int i = 0; i < correctionTable->getSize(); i++){
+        vectorSum += (*correctionTable)[i];
     }
 
     QCOMPARE(correctionFactor.getSatelliteSwath(), 3300);
@@ -191,13 +310,245 @@ void testMain::testGetVector(){
     CorrectionFactor correctionFactor(IMAGE_WIDTH);
     double vectorSum = 0;
 
-    for(int i = 0; i < static_cast<int>(correctionFactor.getVector().size()); i++){
-        vectorSum += correctionFactor.getVector()[i];
+    shared_ptr<const CorrectionTable> correctionTable = correctionFactor.getTable();
+    for(int i = 0; i < correctionTable->getSize(); i++){
+        vectorSum += (*correctionTable)[i];
     }
 
     QCOMPARE(vectorSum, 2790.3388488805076);
 }
 
+void testMain::testGetResampleMap(){
+    CorrectionFactor correctionFactor(IMAGE_WIDTH);
+    shared_ptr<const ResampleMap> resampleMap = correctionFactor.getResampleMap();
+
+    //Same map for the same parameters, a new one once they change
+    QCOMPARE(correctionFactor.getResampleMap(), resampleMap);
+    QCOMPARE(resampleMap->getOriginalWidth(), IMAGE_WIDTH);
+    QCOMPARE(resampleMap->getRectifiedWidth(), correctionFactor.getRectifiedWidth());
+    QCOMPARE(resampleMap->getWideColumnCount(), 0);
+    for(int column = 0; column < resampleMap->getRectifiedWidth(); column++){
+        QVERIFY(resampleMap->getStartColumns()[column] >= 0 && resampleMap->getStartColumns()[column] < IMAGE_WIDTH);
+        QVERIFY(resampleMap->getEndColumns()[column] >= 0 && resampleMap->getEndColumns()[column] < IMAGE_WIDTH);
+    }
+    //The center of the rectified image is the center of the original
+    QCOMPARE(resampleMap->getStartColumns()[resampleMap->getRectifiedWidth() / 2], IMAGE_WIDTH / 2);
+    correctionFactor.setSatelliteSwath(SATELLITE_SWATH + 500);
+    QVERIFY(correctionFactor.getResampleMap() != resampleMap);
+    QCOMPARE(correctionFactor.getResampleMap()->getRectifiedWidth(), correctionFactor.getRectifiedWidth());
+}
+
+void testMain::testSetParameters(){
+    CorrectionFactor sequential(IMAGE_WIDTH);
+    sequential.setEarthRadius(EARTH_RADIUS + 100);
+    sequential.setSatelliteAltitude(SATELLITE_ALTITUDE + 100);
+    sequential.setSatelliteSwath(SATELLITE_SWATH + 100);
+    shared_ptr<const CorrectionTable> sequentialTable = sequential.getTable();
+
+    //Changing every parameter costs at most one computation, and none when the table is cached
+    CorrectionFactor correctionFactor(IMAGE_WIDTH);
+    int computations = CorrectionTableCache::instance().getComputations();
+    correctionFactor.setParameters(EARTH_RADIUS + 200, SATELLITE_ALTITUDE + 200, SATELLITE_SWATH + 200);
+    correctionFactor.setEarthRadius(EARTH_RADIUS + 100);
+    correctionFactor.setParameters(EARTH_RADIUS + 100, SATELLITE_ALTITUDE + 100, SATELLITE_SWATH + 100);
+    correctionFactor.getRectifiedWidth();
+    correctionFactor.getResampleMap();
+    QCOMPARE(CorrectionTableCache::instance().getComputations(), computations);
+    QCOMPARE(correctionFactor.getTable(), sequentialTable);
+    QCOMPARE(correctionFactor.getRectifiedWidth(), sequential.getRectifiedWidth());
+
+    correctionFactor.setParameters(EARTH_RADIUS + 300, SATELLITE_ALTITUDE + 300, SATELLITE_SWATH + 300);
+    correctionFactor.getTable();
+    correctionFactor.getRectifiedWidth();
+    QVERIFY(CorrectionTableCache::instance().getComputations() <= computations + 1);
+}
+
+void testMain::testCalcReferenceVector(){
+    //The double precision, mirrored, threaded vector stays within a tight bound of the long double one
+    CorrectionTableCache::instance().clearMemory();
+    for(int width : {1, 2, 3, 500, IMAGE_WIDTH, 4001, 8000}){
+        for(int swath : {SATELLITE_SWATH, SATELLITE_SWATH + 500}){
+            CorrectionFactor correctionFactor(width);
+            correctionFactor.setParameters(EARTH_RADIUS + 100, SATELLITE_ALTITUDE, swath);
+            shared_ptr<const CorrectionTable> fastTable = correctionFactor.getTable();
+            vector<long double> referenceVector = correctionFactor.calcReferenceVector();
+            QCOMPARE(fastTable->getSize(), static_cast<int>(referenceVector.size()));
+            long double maxError = 0;
+            for(int column = 0; column <= width; column++){
+                maxError = max(maxError, fabsl(((*fastTable)[column] - referenceVector[column]) / referenceVector[column]));
+                QVERIFY((*fastTable)[column] == (*fastTable)[width - column]);
+            }
+            QVERIFY2(maxError < 1e-12L, qPrintable(QString("width %1: relative error %2").arg(width).arg(static_cast<double>(maxError))));
+            QCOMPARE(correctionFactor.getRectifiedWidth(), static_cast<int>(ceil(accumulate(referenceVector.begin(), referenceVector.end(), 0.0))));
+        }
+    }
+}
+
+void testMain::testGetTable(){
+    //One table per parameter set, shared by every factor, map, worker and job without a single copy
+    CorrectionTableCache::instance().clearMemory();
+    int allocations = CorrectionTable::getAllocationCount();
+    CorrectionFactor correctionFactor(1234);
+    shared_ptr<const CorrectionTable> correctionTable = correctionFactor.getTable();
+    QCOMPARE(CorrectionTable::getAllocationCount(), allocations + 1);
+    QCOMPARE(correctionTable->getSize(), 1235);
+    QCOMPARE(reinterpret_cast<quintptr>(correctionTable->getData()) % CorrectionTable::alignment, quintptr(0));
+
+    CorrectionFactor sameParameters(1234);
+    QCOMPARE(sameParameters.getTable(), correctionTable);
+    QImage original(1234, 512, QImage::Format_RGB32);
+    original.fill(0xFF102030);
+    QImage rectified;
+    ThreadManager threadManager;
+    threadManager.setResampleMap(sameParameters.getResampleMap());
+    threadManager.setOriginalImage(&original);
+    threadManager.setRectImage(&rectified);
+    threadManager.prepare();
+    threadManager.run().waitForFinished();
+    QCOMPARE(correctionFactor.getTable(), correctionTable);
+    QCOMPARE(CorrectionTable::getAllocationCount(), allocations + 1);
+    QVERIFY(correctionTable.use_count() >= 3);
+}
+
+void testMain::testLookup(){
+    QTemporaryDir cacheDir;
+    QVERIFY(cacheDir.isValid());
+    CorrectionTableCache &cache = CorrectionTableCache::instance();
+    cache.setDirectory(cacheDir.path());
+    cache.clearMemory();
+
+    //First use computes and writes the table
+    int computations = cache.getComputations();
+    CorrectionFactor computed(777);
+    shared_ptr<const CorrectionTable> computedTable = computed.getTable();
+    QCOMPARE(cache.getComputations(), computations + 1);
+    QCOMPARE(QDir(cacheDir.path()).entryList(QStringList() << "*.ctab", QDir::Files).size(), 1);
+
+    //A new session loads it from disk, the same session reuses it from memory
+    cache.clearMemory();
+    int diskLoads = cache.getDiskLoads();
+    CorrectionFactor loaded(777);
+    shared_ptr<const CorrectionTable> loadedTable = loaded.getTable();
+    QVERIFY(loadedTable != computedTable);
+    QVERIFY(equal(loadedTable->begin(), loadedTable->end(), computedTable->begin(), computedTable->end()));
+    QCOMPARE(loaded.getRectifiedWidth(), computed.getRectifiedWidth());
+    QCOMPARE(cache.getDiskLoads(), diskLoads + 1);
+    int memoryHits = cache.getMemoryHits();
+    CorrectionFactor remembered(777);
+    QCOMPARE(remembered.getTable(), loadedTable);
+    QCOMPARE(cache.getMemoryHits(), memoryHits + 1);
+    QCOMPARE(cache.getComputations(), computations + 1);
+
+    //A damaged file is ignored and recomputed
+    cache.clearMemory();
+    QString tablePath = QDir(cacheDir.path()).filePath(QDir(cacheDir.path()).entryList(QStringList() << "*.ctab", QDir::Files).first());
+    QFile table(tablePath);
+    QVERIFY(table.open(QIODevice::ReadWrite));
+    QVERIFY(table.resize(table.size() - 1));
+    table.close();
+    CorrectionFactor recomputed(777);
+    QVERIFY(equal(recomputed.getTable()->begin(), recomputed.getTable()->end(), computedTable->begin(), computedTable->end()));
+    QCOMPARE(cache.getComputations(), computations + 2);
+
+    //Tables that are not persistent, like the preview's, never reach the disk
+    QDir tableDir(cacheDir.path());
+    int files = tableDir.entryList(QStringList() << "*.ctab", QDir::Files).size();
+    CorrectionFactor preview(555);
+    preview.setPersistent(false);
+    preview.getTable();
+    QCOMPARE(tableDir.entryList(QStringList() << "*.ctab", QDir::Files).size(), files);
+
+    //Threads asking for the same new table compute it once between them
+    computations = cache.getComputations();
+    vector<shared_ptr<const CorrectionTable>> sharedTables(4);
+    vector<thread> workers;
+    for(int index = 0; index < 4; index++){
+        workers.emplace_back([&sharedTables, index](){
+            CorrectionFactor correctionFactor(4321);
+            sharedTables[index] = correctionFactor.getTable();
+        });
+    }
+    for(thread &worker : workers){
+        worker.join();
+    }
+    QCOMPARE(cache.getComputations(), computations + 1);
+    for(const shared_ptr<const CorrectionTable> &sharedTable : sharedTables){
+        QCOMPARE(sharedTable, sharedTables[0]);
+    }
+
+    //Past the size budget the oldest files are removed
+    QFile oldTable(tableDir.filePath("old.ctab"));
+    QVERIFY(oldTable.open(QIODevice::WriteOnly));
+    QVERIFY(oldTable.resize(CorrectionTableCache::maxDiskBytes));
+    QVERIFY(oldTable.setFileTime(QDateTime::currentDateTime().addDays(-1), QFileDevice::FileModificationTime));
+    oldTable.close();
+    CorrectionFactor(888).getTable();
+    QVERIFY(!oldTable.exists());
+    QVERIFY(tableDir.entryList(QStringList() << "*.ctab", QDir::Files).size() > files);
+
+    cache.setDirectory("");
+    cache.clearMemory();
+}
+
+void testMain::testHalve(){
+    //Each pixel of the half is the rounded mean of its 2x2 block, odd edges repeat their last row and column
+    QImage gray(5, 3, QImage::Format_Grayscale8);
+    for(int row = 0; row < gray.height(); row++){
+        for(int column = 0; column < gray.width(); column++){
+            gray.scanLine(row)[column] = static_cast<uchar>(row * 50 + column * 10);
+        }
+    }
+    QImage half = DisplayPyramid::halve(gray);
+    QCOMPARE(half.size(), QSize(3, 2));
+    QCOMPARE(half.format(), QImage::Format_Grayscale8);
+    QCOMPARE(int(half.constScanLine(0)[0]), (0 + 10 + 50 + 60 + 2) / 4);
+    QCOMPARE(int(half.constScanLine(0)[2]), (40 + 40 + 90 + 90 + 2) / 4);
+    QCOMPARE(int(half.constScanLine(1)[1]), (120 + 130 + 120 + 130 + 2) / 4);
+    QImage mirrored = DisplayPyramid::halve(gray, true);
+    QCOMPARE(int(mirrored.constScanLine(0)[0]), (100 + 110 + 50 + 60 + 2) / 4);
+    QCOMPARE(int(mirrored.constScanLine(1)[0]), (0 + 10 + 0 + 10 + 2) / 4);
+
+    //Band boundaries must not change the result, however many threads took part
+    QThreadPool pool;
+    pool.setMaxThreadCount(4);
+    QImage image = TEST_IMAGE.convertToFormat(QImage::Format_RGB32);
+    QImage threaded = DisplayPyramid::halve(image, false, &pool);
+    QImage single = DisplayPyramid::halve(image, false, nullptr);
+    QCOMPARE(threaded, single);
+    QCOMPARE(threaded.size(), QSize((image.width() + 1) / 2, (image.height() + 1) / 2));
+    QCOMPARE(DisplayPyramid::halve(image.mirrored(), true, &pool), single);
+}
+
+void testMain::testBuildPyramid(){
+    //Levels halve down to the minimum size, and the smallest one covering a view is picked
+    DisplayPyramid pyramid;
+    QSignalSpy readySpy(&pyramid, SIGNAL(levelsReady()));
+    QImage image(1000, 4000, QImage::Format_RGB32);
+    image.fill(qRgb(10, 20, 30));
+    pyramid.build(image);
+    pyramid.waitForDone();
+    QCOMPARE(readySpy.count(), 1);
+    QVERIFY(pyramid.isReady());
+    QCOMPARE(pyramid.getSourceSize(), image.size());
+    QCOMPARE(pyramid.levelCount(), 5); //500x2000 down to 32x125
+    QCOMPARE(pyramid.levelFor(QSize(100, 400)).size(), QSize(125, 500));
+    QCOMPARE(pyramid.levelFor(QSize(126, 400)).size(), QSize(250, 1000));
+    QCOMPARE(pyramid.levelFor(QSize(10, 10)).size(), QSize(32, 125));
+    QVERIFY(pyramid.levelFor(QSize(600, 2000)).isNull());
+    QCOMPARE(pyramid.levelFor(QSize(100, 400)).pixel(3, 3), qRgb(10, 20, 30));
+
+    //A new build replaces the levels, cancelling drops them
+    pyramid.build(image.copy(0, 0, 100, 100));
+    pyramid.waitForDone();
+    QCOMPARE(readySpy.count(), 2);
+    QCOMPARE(pyramid.levelCount(), 0);
+    QVERIFY(pyramid.levelFor(QSize(10, 10)).isNull());
+    pyramid.build(image);
+    pyramid.cancel();
+    QVERIFY(!pyramid.isReady());
+    QCOMPARE(pyramid.levelCount(), 0);
+}
+
 void testMain::testSetInputFilePath(){
     FileManager fileManager;
     fileManager.setInputFilePath(&INPUT_PATH);
@@ -284,27 +635,736 @@ void testMain::testGetRectImagePtr(){
     QCOMPARE(*fileManager.getRectImagePtr(), TEST_IMAGE);
 }
 
+void testMain::testOpenRaw(){
+    //Raw files are wrapped in place and come out the same as through QImage's own decoders
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    const char *suffixes[] = {"pgm", "ppm", "bmp"};
+    for(const char *suffix : suffixes){
+        string filePath = directory.filePath(QString("pass.") + suffix).toStdString();
+        QImage source = QString(suffix) == "pgm" ? TEST_IMAGE.convertToFormat(QImage::Format_Grayscale8) : TEST_IMAGE.convertToFormat(QImage::Format_RGB32);
+        QVERIFY(source.save(QString::fromStdString(filePath)));
+        QVERIFY(FileManager::isRawFormat(filePath));
+        FileManager fileManager;
+        fileManager.setInputFilePath(&filePath);
+        fileManager.open();
+        QImage opened = fileManager.isBottomUp() ? fileManager.getImagePtr()->mirrored() : *fileManager.getImagePtr();
+        QCOMPARE(opened.convertToFormat(source.format()), source);
+    }
+    QVERIFY(!FileManager::isRawFormat(TEST_IMAGE_INPUT_PATH));
+
+    //A truncated raw file is left to QImage, which refuses it
+    QFile truncated(directory.filePath("truncated.pgm"));
+    QVERIFY(truncated.open(QIODevice::WriteOnly));
+    truncated.write("P5\n100 100\n255\n0123");
+    truncated.close();
+    string truncatedPath = truncated.fileName().toStdString();
+    FileManager fileManager;
+    fileManager.setInputFilePath(&truncatedPath);
+    QVERIFY_EXCEPTION_THROWN(fileManager.open(), string);
+
+    //So is a BMP whose header would wrap the row size or the height around
+    QFile validBmp(directory.filePath("pass.bmp"));
+    QVERIFY(validBmp.open(QIODevice::ReadOnly));
+    QByteArray bmp = validBmp.readAll();
+    validBmp.close();
+    const quint32 corruptFields[][2] = {{18, 0x40000000}, {18, 0x80000000}, {22, 0x80000000}, {10, 0}};
+    for(const quint32 *field : corruptFields){
+        QByteArray corrupt = bmp;
+        for(int byte = 0; byte < 4; byte++){
+            corrupt[static_cast<int>(field[0]) + byte] = static_cast<char>(field[1] >> (byte * 8));
+        }
+        QFile corruptFile(directory.filePath("corrupt.bmp"));
+        QVERIFY(corruptFile.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        corruptFile.write(corrupt);
+        corruptFile.close();
+        string corruptPath = corruptFile.fileName().toStdString();
+        FileManager corruptManager;
+        corruptManager.setInputFilePath(&corruptPath);
+        //Refused outright, or decoded by QImage into an image whose every row can be read
+        try {
+            corruptManager.open();
+            const QImage *opened = corruptManager.getImagePtr();
+            QCOMPARE(opened->copy(), *opened);
+        }  catch (string &) {
+        }
+    }
+}
+
+void testMain::testCreateRectImage(){
+    //Rectifying into a mapped output file gives the same file as rectifying in memory and saving
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    QImage gray = TEST_IMAGE.convertToFormat(QImage::Format_Grayscale8);
+    string grayBmpPath = directory.filePath("gray.bmp").toStdString();
+    FileManager writer;
+    writer.setOutputFilePath(&grayBmpPath);
+    *writer.getRectImagePtr() = gray;
+    writer.save();
+    QVERIFY(gray.save(directory.filePath("gray.pgm")));
+    QVERIFY(TEST_IMAGE.convertToFormat(QImage::Format_RGB32).save(directory.filePath("color.bmp")));
+
+    const char *inputs[] = {"gray.pgm", "gray.bmp", "color.bmp"};
+    for(const char *input : inputs){
+        string inputPath = directory.filePath(input).toStdString();
+        string outputPath = directory.filePath(QString("rectified-") + input).toStdString();
+        FileManager fileManager;
+        fileManager.setInputFilePath(&inputPath);
+        fileManager.setOutputFilePath(&outputPath);
+        fileManager.open();
+        const QImage *originalImage = fileManager.getImagePtr();
+        CorrectionFactor correctionFactor(originalImage->width());
+        shared_ptr<const ResampleMap> resampleMap = correctionFactor.getResampleMap();
+        QImage *rectifiedImage = fileManager.createRectImage(resampleMap->getRectifiedWidth(), originalImage->height(), originalImage->format());
+        QCOMPARE(rectifiedImage->format(), originalImage->format());
+        RectifyKernel::rectifyRows(originalImage, rectifiedImage, *resampleMap, 0, originalImage->height());
+        QImage expected = rectifiedImage->copy().convertToFormat(QImage::Format_RGB32);
+        fileManager.save();
+
+        QImage saved(QString::fromStdString(outputPath));
+        QCOMPARE(saved.convertToFormat(QImage::Format_RGB32), fileManager.isBottomUp() ? expected.mirrored() : expected);
+    }
+}
+
+void testMain::testEnqueue(){
+    //Every queued image is written or reported as failed, at whatever compression was asked for
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    ImageWriter imageWriter(1); //One at a time, so the spies are never appended to concurrently
+    QCOMPARE(imageWriter.getCapacity(), 1);
+    QSignalSpy savedSpy(&imageWriter, SIGNAL(saved(QString,qint64)));
+    QSignalSpy failedSpy(&imageWriter, SIGNAL(saveFailed(QString,QString)));
+    QImage image = TEST_IMAGE.convertToFormat(QImage::Format_RGB32);
+    imageWriter.enqueue(image, directory.filePath("fast.png").toStdString(), false, 1);
+    imageWriter.enqueue(image, directory.filePath("small.png").toStdString(), false, 9);
+    imageWriter.enqueue(image, directory.filePath("flipped.pgm").toStdString(), true);
+    imageWriter.enqueue(image, directory.filePath("missing/directory.png").toStdString());
+    imageWriter.waitForDone();
+    QCOMPARE(imageWriter.pendingCount(), 0);
+    QCOMPARE(savedSpy.count(), 3);
+    QCOMPARE(failedSpy.count(), 1);
+    QCOMPARE(failedSpy[0][0].toString(), directory.filePath("missing/directory.png"));
+
+    QCOMPARE(QImage(directory.filePath("fast.png")).convertToFormat(QImage::Format_RGB32), image);
+    QCOMPARE(QImage(directory.filePath("small.png")).convertToFormat(QImage::Format_RGB32), image);
+    QVERIFY(QFileInfo(directory.filePath("small.png")).size() <= QFileInfo(directory.filePath("fast.png")).size());
+    QCOMPARE(QImage(directory.filePath("flipped.pgm")).convertToFormat(QImage::Format_Grayscale8), image.convertToFormat(QImage::Format_Grayscale8).mirrored());
+}
+
+static const char *TEST_TLE = "METEOR-M 2\n"
+                               "1 40069U 14037A   21001.50000000  .00000040  00000-0  37000-4 0  9991\n"
+                               "2 40069  98.5000 100.0000 0005000 200.0000 160.0000 14.20600000345676\n";
+
+static double greatCircleDistance(const GeoPoint &first, const GeoPoint &second){
+    //km on the rectification's sphere
+    const double degrees = 3.14159265358979323846 / 180;
+    double cosine = sin(first.latitude * degrees) * sin(second.latitude * degrees) + cos(first.latitude * degrees) * cos(second.latitude * degrees) * cos((first.longitude - second.longitude) * degrees);
+    return 6371.0 * acos(min(1.0, cosine));
+}
+
+void testMain::testParseTle(){
+    OrbitalElements elements = Orbit::parseTle(TEST_TLE, "meteor");
+    QCOMPARE(elements.name, QString("METEOR-M 2"));
+    QCOMPARE(elements.epoch, QDateTime(QDate(2021, 1, 1), QTime(12, 0), Qt::UTC));
+    QVERIFY(fabs(elements.inclination * 180 / 3.14159265358979323846 - 98.5) < 1e-9);
+    QVERIFY(fabs(elements.eccentricity - 0.0005) < 1e-12);
+    QVERIFY(fabs(elements.meanMotion * 86400 / (2 * 3.14159265358979323846) - 14.206) < 1e-9);
+
+    //A wrong checksum, or no set by that name, is an error rather than a guess
+    QString corrupted = QString(TEST_TLE).replace("0  9991", "0  9992");
+    QVERIFY_EXCEPTION_THROWN(Orbit::parseTle(corrupted), string);
+    QVERIFY_EXCEPTION_THROWN(Orbit::parseTle(TEST_TLE, "NOAA"), string);
+    QVERIFY_EXCEPTION_THROWN(Orbit::readTle("missing.tle"), string);
+}
+
+void testMain::testStateAt(){
+    //A sun-synchronous orbit about 830 km up, whatever the time
+    Orbit orbit(Orbit::parseTle(TEST_TLE));
+    QVERIFY(fabs(orbit.getPeriod() / 60 - 101.4) < 0.5);
+    QVERIFY(fabs(Orbit::siderealTime(QDateTime(QDate(2000, 1, 1), QTime(12, 0), Qt::UTC)) * 180 / 3.14159265358979323846 - 280.46061837) < 1e-6);
+    for(double seconds = 0; seconds < 6000; seconds += 600){
+        Vector3 position, velocity;
+        orbit.stateAt(seconds, &position, &velocity);
+        QVERIFY(position.length() - 6371.0 > 780 && position.length() - 6371.0 < 880);
+        QVERIFY(velocity.length() > 6.9 && velocity.length() < 7.7);
+    }
+}
+
+void testMain::testLocate(){
+    //The centre column sits under the satellite and the edges half a swath to either side
+    Orbit orbit(Orbit::parseTle(TEST_TLE));
+    QDateTime startTime = orbit.getElements().epoch.addSecs(1200);
+    Reprojector reprojector(orbit, startTime);
+    const int width = 2000;
+    GeoPoint centre = reprojector.locate(width / 2.0 - 0.5, 0, width);
+    GeoPoint left = reprojector.locate(-0.5, 0, width);
+    GeoPoint right = reprojector.locate(width - 0.5, 0, width);
+    QVERIFY(fabs(greatCircleDistance(centre, left) - 1400) < 2);
+    QVERIFY(fabs(greatCircleDistance(centre, right) - 1400) < 2);
+    Vector3 position;
+    orbit.stateAt(startTime, &position, nullptr);
+    GeoPoint nadir = {asin(position.z / position.length()) * 180 / 3.14159265358979323846, atan2(position.y, position.x) * 180 / 3.14159265358979323846};
+    QVERIFY(greatCircleDistance(nadir, centre) < 0.01);
+
+    //Grid points are exact, and include the last column and row
+    reprojector.setGridStep(64);
+    ControlGrid grid = reprojector.controlGrid(width, 300);
+    QCOMPARE(grid.columns.back(), width - 1);
+    QCOMPARE(grid.rows.back(), 299);
+    QCOMPARE(static_cast<int>(grid.points.size()), static_cast<int>(grid.columns.size() * grid.rows.size()));
+    QVERIFY(greatCircleDistance(grid.at(1, 1), reprojector.locate(64, 64, width)) < 1e-6);
+}
+
+void testMain::testReproject(){
+    //Each source pixel lands where locate() puts it, for images stored either way up
+    Orbit orbit(Orbit::parseTle(TEST_TLE));
+    Reprojector reprojector(orbit, orbit.getElements().epoch.addSecs(1200));
+    reprojector.setLineSeconds(1.0); //Rows about as far apart as the 7 km columns, so no sample is within an output pixel of the edge
+    QThreadPool pool;
+    pool.setMaxThreadCount(4);
+    const int width = 400, height = 300;
+    QImage image(width, height, QImage::Format_Grayscale8);
+    for(int row = 0; row < height; row++){
+        for(int column = 0; column < width; column++){
+            int value = (column / 4 + row / 3) % 256;
+            image.scanLine(row)[column] = static_cast<uchar>(value > 127 ? 255 - value : value);
+        }
+    }
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    QRandomGenerator random(1568);
+    for(bool bottomUp : {false, true}){
+        Reprojection reprojection = reprojector.reproject(bottomUp ? image.mirrored() : image, bottomUp, &pool);
+        QVERIFY(!reprojection.image.isNull());
+        QVERIFY(reprojection.degreesPerPixel > 0);
+        int worst = 0;
+        for(int sample = 0; sample < 500; sample++){
+            int column = 10 + random.bounded(width - 20);
+            int row = 10 + random.bounded(height - 20);
+            GeoPoint point = reprojector.locate(column, row, width);
+            double longitude = point.longitude + 360 * round((reprojection.west - point.longitude) / 360);
+            if(longitude < reprojection.west - 1){
+                longitude += 360;
+            }
+            int x = static_cast<int>(lround((longitude - reprojection.west) / reprojection.degreesPerPixel));
+            int y = static_cast<int>(lround((reprojection.north - point.latitude) / reprojection.degreesPerPixel));
+            QVERIFY(x >= 0 && y >= 0 && x < reprojection.image.width() && y < reprojection.image.height());
+            worst = max(worst, abs(reprojection.image.constScanLine(y)[x] - image.constScanLine(row)[column]));
+        }
+        QVERIFY(worst <= 12);
+    }
+
+    //The world file carries the pixel size and the top left centre
+    Reprojection reprojection = reprojector.reproject(image, false, &pool);
+    reprojection.writeWorldFile(directory.filePath("pass-latlon.png").toStdString());
+    QFile worldFile(directory.filePath("pass-latlon.wld"));
+    QVERIFY(worldFile.open(QIODevice::ReadOnly | QIODevice::Text));
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    QStringList lines = QString(worldFile.readAll()).split('\n', Qt::SkipEmptyParts);
+#else
+    QStringList lines = QString(worldFile.readAll()).split('\n', QString::SkipEmptyParts);
+#endif
+    QCOMPARE(lines.size(), 6);
+    QVERIFY(fabs(lines[0].toDouble() - reprojection.degreesPerPixel) < 1e-9);
+    QVERIFY(fabs(lines[3].toDouble() + reprojection.degreesPerPixel) < 1e-9);
+    QVERIFY(fabs(lines[4].toDouble() - reprojection.west) < 1e-6);
+    QVERIFY(fabs(lines[5].toDouble() - reprojection.north) < 1e-6);
+
+    //Too few rows to make a triangle is an error
+    reprojector.setDegreesPerPixel(0.01);
+    QVERIFY_EXCEPTION_THROWN(reprojector.reproject(QImage(width, 1, QImage::Format_Grayscale8), false, &pool), string);
+}
+
+void testMain::testReprojectPolar(){
+    //A pass whose swath runs over the north pole spans most longitudes, yet every pixel still lands where locate() puts it
+    Orbit orbit(Orbit::parseTle(TEST_TLE));
+    Reprojector reprojector(orbit, orbit.getElements().epoch.addSecs(1373)); //150 s before the northernmost point of the track
+    reprojector.setLineSeconds(1.0);
+    const int width = 400, height = 300;
+    QImage image(width, height, QImage::Format_Grayscale8);
+    for(int row = 0; row < height; row++){
+        for(int column = 0; column < width; column++){
+            int value = (column / 4 + row / 3) % 256;
+            image.scanLine(row)[column] = static_cast<uchar>(value > 127 ? 255 - value : value);
+        }
+    }
+
+    //Along the rows the grid is continuous, and it reaches the pole
+    ControlGrid grid = reprojector.controlGrid(width, height);
+    double northmost = -90;
+    for(int grid_row = 0; grid_row < static_cast<int>(grid.rows.size()); grid_row++){
+        for(int grid_column = 0; grid_column < static_cast<int>(grid.columns.size()); grid_column++){
+            northmost = max(northmost, grid.at(grid_column, grid_row).latitude);
+            if(grid_column > 0){
+                QVERIFY(fabs(grid.at(grid_column, grid_row).longitude - grid.at(grid_column - 1, grid_row).longitude) < 180);
+            }
+        }
+    }
+    QVERIFY(northmost > 88);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(4);
+    Reprojection reprojection = reprojector.reproject(image, false, &pool);
+    QVERIFY(reprojection.image.width() <= static_cast<int>(360 / reprojection.degreesPerPixel) + 1);
+    QRandomGenerator random(1568);
+    int worst = 0;
+    int checked = 0;
+    for(int sample = 0; sample < 500; sample++){
+        int column = 10 + random.bounded(width - 20);
+        int row = 10 + random.bounded(height - 20);
+        GeoPoint point = reprojector.locate(column, row, width);
+        if(point.latitude > 88){
+            continue; //Output pixels this close to the pole are narrower than the grid is accurate
+        }
+        //The same place may show up a turn to either side, any copy inside the output has to match
+        int best = 256;
+        for(int turn = -1; turn <= 1; turn++){
+            int x = static_cast<int>(lround((point.longitude + 360 * turn - reprojection.west) / reprojection.degreesPerPixel));
+            int y = static_cast<int>(lround((reprojection.north - point.latitude) / reprojection.degreesPerPixel));
+            if(x >= 0 && y >= 0 && x < reprojection.image.width() && y < reprojection.image.height()){
+                best = min(best, abs(reprojection.image.constScanLine(y)[x] - image.constScanLine(row)[column]));
+            }
+        }
+        if(best < 256){
+            checked++;
+            worst = max(worst, best);
+        }
+    }
+    QVERIFY(checked > 400);
+    QVERIFY(worst <= 12);
+}
+
+void testMain::testEncode(){
+    //Row groups deflated on separate threads must still decode to the original, whatever the group size
+    QThreadPool pool;
+    pool.setMaxThreadCount(4);
+    QImage argb = TEST_IMAGE.convertToFormat(QImage::Format_ARGB32);
+    for(int row = 0; row < argb.height(); row++){
+        QRgb *pixels = reinterpret_cast<QRgb *>(argb.scanLine(row));
+        for(int column = 0; column < argb.width(); column++){
+            pixels[column] = qRgba(qRed(pixels[column]), qGreen(pixels[column]), qBlue(pixels[column]), (row + column) % 256);
+        }
+    }
+    const QImage images[] = {TEST_IMAGE.convertToFormat(QImage::Format_Grayscale8), TEST_IMAGE.convertToFormat(QImage::Format_RGB888), TEST_IMAGE.convertToFormat(QImage::Format_RGB32), argb, TEST_IMAGE.convertToFormat(QImage::Format_ARGB32_Premultiplied)};
+    const int chunkRows[] = {1, 7, 0, TEST_IMAGE.height()};
+    for(const QImage &image : images){
+        QImage expected = image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+        for(int rows : chunkRows){
+            QImage decoded = QImage::fromData(PngEncoder::encode(image, false, 6, &pool, rows), "PNG");
+            QCOMPARE(decoded.convertToFormat(expected.format()), expected);
+        }
+        QImage flipped = QImage::fromData(PngEncoder::encode(image, true, 1, &pool, 5), "PNG");
+        QCOMPARE(flipped.convertToFormat(expected.format()), expected.mirrored());
+    }
+    QCOMPARE(QImage::fromData(PngEncoder::encode(images[0], false, -1, &pool, 3), "PNG").format(), QImage::Format_Grayscale8);
+}
+
+void testMain::testRectifyRow(){
+    //Compare the scanline kernel against the reference path on random opaque images of various widths and swaths
+    QRandomGenerator random(1568);
+    const int widths[] = {1, 2, 3, 500, 1568, 4000};
+    const int swaths[] = {500, SATELLITE_SWATH, 6000, 9999};
+    const QImage::Format formats[] = {QImage::Format_RGB32, QImage::Format_ARGB32};
+    for(int width : widths){
+        for(int swath : swaths){
+            CorrectionFactor correctionFactor(width);
+            correctionFactor.setSatelliteSwath(swath);
+            int rectifiedWidth = correctionFactor.getRectifiedWidth();
+            shared_ptr<const CorrectionTable> correctionTable = correctionFactor.getTable();
+            shared_ptr<const ResampleMap> resampleMap = correctionFactor.getResampleMap();
+            for(QImage::Format format : formats){
+                QImage original(width, 4, format);
+                for(int row = 0; row < original.height(); row++){
+                    for(int column = 0; column < width; column++){
+                        original.setPixel(column, row, random.generate() | 0xFF000000);
+                    }
+                }
+                QImage rectified(rectifiedWidth, original.height(), format);
+                QImage reference(rectifiedWidth, original.height(), format);
+                rectified.fill(0);
+                reference.fill(0);
+                for(int row = 0; row < original.height(); row++){
+                    RectifyKernel::rectifyRow(reinterpret_cast<const QRgb *>(original.constScanLine(row)),
+                                              reinterpret_cast<QRgb *>(rectified.scanLine(row)), *resampleMap);
+                    RectifyKernel::rectifyRowReference(&original, &reference, rectifiedWidth, *correctionTable, row);
+                }
+                QCOMPARE(rectified, reference);
+            }
+        }
+    }
+    QVERIFY(RectifyKernel::isSupportedFormat(QImage::Format_RGB32));
+    QVERIFY(!RectifyKernel::isSupportedFormat(QImage::Format_Indexed8));
+}
+
+void testMain::testRectifyRowBytes(){
+    //Grayscale8 and RGB888 rows blended in place have to match the same blend through QImage::pixel()/setPixel()
+    QRandomGenerator random(1568);
+    const int widths[] = {1, 2, 9, 500, 1568, 4001};
+    const int swaths[] = {500, SATELLITE_SWATH, 9999};
+    const QImage::Format formats[] = {QImage::Format_Grayscale8, QImage::Format_RGB888};
+    for(int width : widths){
+        for(int swath : swaths){
+            CorrectionFactor correctionFactor(width);
+            correctionFactor.setSatelliteSwath(swath);
+            shared_ptr<const ResampleMap> resampleMap = correctionFactor.getResampleMap();
+            for(QImage::Format format : formats){
+                QImage original(width, 4, format);
+                for(int row = 0; row < original.height(); row++){
+                    uchar *line = original.scanLine(row);
+                    for(int sample = 0; sample < width * original.depth() / 8; sample++){
+                        line[sample] = static_cast<uchar>(random.generate());
+                    }
+                }
+                QImage rectified(resampleMap->getRectifiedWidth(), original.height(), format);
+                QImage generic(resampleMap->getRectifiedWidth(), original.height(), format);
+                rectified.fill(0);
+                generic.fill(0);
+                RectifyKernel::rectifyRows(&original, &rectified, *resampleMap, 0, original.height());
+                for(int row = 0; row < original.height(); row++){
+                    RectifyKernel::rectifyRowGeneric(&original, &generic, *resampleMap, row);
+                }
+                QCOMPARE(rectified, generic);
+            }
+        }
+    }
+    QCOMPARE(RectifyKernel::bytesPerPixelFor(QImage::Format_Grayscale8), 1);
+    QCOMPARE(RectifyKernel::bytesPerPixelFor(QImage::Format_RGB888), 3);
+    QCOMPARE(RectifyKernel::bytesPerPixelFor(QImage::Format_ARGB32), 4);
+    QCOMPARE(RectifyKernel::bytesPerPixelFor(QImage::Format_Indexed8), 0);
+}
+
+void testMain::testRectifyRowFilter(){
+    //The tap filters keep flat areas flat, hit source pixels exactly and agree across pixel formats
+    QRandomGenerator random(1568);
+    const ResampleFilter filters[] = {ResampleFilter::Cubic, ResampleFilter::Lanczos3};
+    for(ResampleFilter filter : filters){
+        for(int width : {1, 3, 500, 1568}){
+            CorrectionFactor correctionFactor(width);
+            shared_ptr<const ResampleMap> linearMap = correctionFactor.getResampleMap();
+            shared_ptr<const CorrectionTable> correctionTable = correctionFactor.getTable();
+            correctionFactor.setFilter(filter);
+            shared_ptr<const ResampleMap> resampleMap = correctionFactor.getResampleMap();
+            QVERIFY(resampleMap != linearMap);
+            QCOMPARE(correctionFactor.getTable(), correctionTable);
+            QCOMPARE(resampleMap->getFilterTaps(), ResampleMap::tapsFor(filter));
+
+            QImage gray(width, 2, QImage::Format_Grayscale8);
+            for(int row = 0; row < gray.height(); row++){
+                for(int column = 0; column < width; column++){
+                    gray.scanLine(row)[column] = static_cast<uchar>(random.generate());
+                }
+            }
+            gray.scanLine(1)[0] = 77;
+            QImage color = gray.convertToFormat(QImage::Format_RGB32);
+            QImage flat(width, 1, QImage::Format_RGB32);
+            flat.fill(0xFF336699);
+            QImage rectifiedGray(resampleMap->getRectifiedWidth(), gray.height(), QImage::Format_Grayscale8);
+            QImage rectifiedColor(resampleMap->getRectifiedWidth(), gray.height(), QImage::Format_RGB32);
+            QImage rectifiedFlat(resampleMap->getRectifiedWidth(), 1, QImage::Format_RGB32);
+            RectifyKernel::rectifyRows(&gray, &rectifiedGray, *resampleMap, 0, gray.height());
+            RectifyKernel::rectifyRows(&color, &rectifiedColor, *resampleMap, 0, color.height());
+            RectifyKernel::rectifyRows(&flat, &rectifiedFlat, *resampleMap, 0, 1);
+            QCOMPARE(rectifiedColor.convertToFormat(QImage::Format_Grayscale8), rectifiedGray);
+            for(int column = 0; column < resampleMap->getRectifiedWidth(); column++){
+                if(resampleMap->getFilterPhases()[column] == ResampleMap::filterPhaseCount){
+                    continue;
+                }
+                QCOMPARE(rectifiedFlat.pixel(column, 0), 0xFF336699u);
+                if(linearMap->getWeights()[column] != 0 && (linearMap->getWeights()[column] >> 16) == 0){
+                    QCOMPARE(rectifiedGray.constScanLine(1)[column], gray.constScanLine(1)[linearMap->getStartColumns()[column]]);
+                }
+            }
+        }
+    }
+}
+
+void testMain::testRectifyTile(){
+    //Any tile rectified on its own matches the same pixels of a whole image pass, and leaves everything around it alone
+    QRandomGenerator random(777);
+    QImage original(777, 40, QImage::Format_RGB32);
+    for(int row = 0; row < original.height(); row++){
+        for(int column = 0; column < original.width(); column++){
+            original.setPixel(column, row, random.generate() | 0xFF000000);
+        }
+    }
+    const QImage::Format formats[] = {QImage::Format_RGB32, QImage::Format_RGB888, QImage::Format_Grayscale8, QImage::Format_RGB16};
+    const ResampleFilter filters[] = {ResampleFilter::Linear, ResampleFilter::Cubic, ResampleFilter::Lanczos3};
+    for(ResampleFilter filter : filters){
+        CorrectionFactor correctionFactor(original.width());
+        correctionFactor.setParameters(EARTH_RADIUS, SATELLITE_ALTITUDE, 9999);
+        correctionFactor.setFilter(filter);
+        shared_ptr<const ResampleMap> resampleMap = correctionFactor.getResampleMap();
+        for(QImage::Format format : formats){
+            QImage source = original.convertToFormat(format);
+            QImage whole(resampleMap->getRectifiedWidth(), source.height(), format);
+            whole.fill(0);
+            RectifyKernel::rectifyRows(&source, &whole, *resampleMap, 0, source.height());
+            for(int trial = 0; trial < 8; trial++){
+                int left = random.bounded(resampleMap->getRectifiedWidth());
+                int top = random.bounded(source.height());
+                QRect tile(left, top, 1 + random.bounded(resampleMap->getRectifiedWidth() - left), 1 + random.bounded(source.height() - top));
+                QImage tiled(whole.size(), format);
+                tiled.fill(0);
+                RectifyKernel::rectifyTile(&source, &tiled, *resampleMap, tile);
+                QImage expected(whole.size(), format);
+                expected.fill(0);
+                for(int row = tile.top(); row <= tile.bottom(); row++){
+                    for(int column = tile.left(); column <= tile.right(); column++){
+                        expected.setPixel(column, row, whole.pixel(column, row));
+                    }
+                }
+                QCOMPARE(tiled, expected);
+            }
+        }
+    }
+}
+
 void testMain::testRunRT(){
     CorrectionFactor correctionFactor(TEST_IMAGE.width());
     QImage testImageWork(correctionFactor.getRectifiedWidth(),
                                   TEST_IMAGE.height(), TEST_IMAGE.format());
-    int rows_completed;
+    QImage testImageReference(correctionFactor.getRectifiedWidth(),
+                                  TEST_IMAGE.height(), TEST_IMAGE.format());
+    testImageWork.fill(0);
+    testImageReference.fill(0);
+    atomic<int> rows_completed{0};
+
+    RowScheduler rowScheduler;
+
+    //A single thread has to work through every chunk of the image on its own
+    rowScheduler.setMaxWorkers(1);
+    QFuture<void> job = rowScheduler.submit(&TEST_IMAGE, &testImageWork, correctionFactor.getResampleMap(),
+                                            TEST_IMAGE.height(), &rows_completed);
+    job.waitForFinished();
+    QVERIFY(job.isFinished());
+    QVERIFY(!job.isCanceled());
+
+    QCOMPARE(rows_completed.load(), TEST_IMAGE.height());
+    QCOMPARE(TEST_IMAGE_RECTIFIED, testImageWork);
 
-    RectifyThread *rectifyThread = new RectifyThread(&TEST_IMAGE, &testImageWork,
-                                                     correctionFactor.getRectifiedWidth(),
-                                                     correctionFactor.getVector(),
-                                                     TEST_IMAGE.height(),
-                                                     0, &rows_completed);
+    //The thread output has to match the reference per-pixel path as well
+    for(int row = 0; row < TEST_IMAGE.height(); row++){
+        RectifyKernel::rectifyRowReference(&TEST_IMAGE, &testImageReference, correctionFactor.getRectifiedWidth(), *correctionFactor.getTable(), row);
+    }
+    QCOMPARE(testImageWork, testImageReference);
+}
+
+void testMain::testChunkRowsFor(){
+    //Several chunks per worker, within the bounds
+    QCOMPARE(RowScheduler::chunkRowsFor(8192, 4), 256);
+    QCOMPARE(RowScheduler::chunkRowsFor(8192, 32), 32);
+    QCOMPARE(RowScheduler::chunkRowsFor(1000, 8), 16);
+    QCOMPARE(RowScheduler::chunkRowsFor(100000, 1), RowScheduler::maxChunkRows);
+    QCOMPARE(RowScheduler::chunkRowsFor(10, 64), RowScheduler::minChunkRows);
+    QCOMPARE(RowScheduler::chunkRowsFor(10, 0), RowScheduler::minChunkRows);
+}
+
+void testMain::testSubmit(){
+    //Several images queued at once on a small pool all come out whole and correct
+    CorrectionFactor wideFactor(640);
+    CorrectionFactor narrowFactor(96);
+    QImage wideImage(640, 301, QImage::Format_RGB32);
+    QImage narrowImage(96, 37, QImage::Format_RGB32);
+    for(int row = 0; row < wideImage.height(); row++){
+        for(int column = 0; column < wideImage.width(); column++){
+            wideImage.setPixel(column, row, qRgb(column % 256, row % 256, (column * row) % 256));
+        }
+    }
+    for(int row = 0; row < narrowImage.height(); row++){
+        for(int column = 0; column < narrowImage.width(); column++){
+            narrowImage.setPixel(column, row, qRgb((column * 7) % 256, (row * 3) % 256, 128));
+        }
+    }
+    QImage wideRectified(wideFactor.getRectifiedWidth(), wideImage.height(), wideImage.format());
+    QImage narrowRectified(narrowFactor.getRectifiedWidth(), narrowImage.height(), narrowImage.format());
+    QImage wideReference(wideRectified.width(), wideImage.height(), wideImage.format());
+    QImage narrowReference(narrowRectified.width(), narrowImage.height(), narrowImage.format());
+    wideRectified.fill(0);
+    narrowRectified.fill(0);
+    wideReference.fill(0);
+    narrowReference.fill(0);
+
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(3);
+    atomic<int> rowsCompleted{0};
+    {
+        RowScheduler rowScheduler(&threadPool);
+        QFuture<void> wideJob = rowScheduler.submit(&wideImage, &wideRectified, wideFactor.getResampleMap(), wideImage.height(), &rowsCompleted);
+        QFuture<void> narrowJob = rowScheduler.submit(&narrowImage, &narrowRectified, narrowFactor.getResampleMap(), narrowImage.height(), &rowsCompleted);
+        QFuture<void> emptyJob = rowScheduler.submit(&narrowImage, &narrowRectified, narrowFactor.getResampleMap(), 0, nullptr);
+        QVERIFY(emptyJob.isFinished());
+        wideJob.waitForFinished();
+        narrowJob.waitForFinished();
+    }
+    QCOMPARE(rowsCompleted.load(), wideImage.height() + narrowImage.height());
+
+    for(int row = 0; row < wideImage.height(); row++){
+        RectifyKernel::rectifyRowReference(&wideImage, &wideReference, wideFactor.getRectifiedWidth(), *wideFactor.getTable(), row);
+    }
+    for(int row = 0; row < narrowImage.height(); row++){
+        RectifyKernel::rectifyRowReference(&narrowImage, &narrowReference, narrowFactor.getRectifiedWidth(), *narrowFactor.getTable(), row);
+    }
+    QCOMPARE(wideRectified, wideReference);
+    QCOMPARE(narrowRectified, narrowReference);
+}
+
+void testMain::testCancel(){
+    //A cancelled job stops at a chunk boundary, and reports finished only once its claimed chunks are written
+    CorrectionFactor correctionFactor(1000);
+    QImage original(1000, 4096, QImage::Format_RGB32);
+    original.fill(0xFF204060);
+    QImage rectified(correctionFactor.getRectifiedWidth(), original.height(), original.format());
+    rectified.fill(0);
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(2);
+    RowScheduler rowScheduler(&threadPool);
+    atomic<int> rowsCompleted{0};
+    QFuture<void> job = rowScheduler.submit(&original, &rectified, correctionFactor.getResampleMap(), original.height(), &rowsCompleted);
+    job.cancel();
+    job.waitForFinished();
+    QVERIFY(job.isCanceled());
+    int rows = rowsCompleted.load();
+    QVERIFY(rows <= original.height());
+    QCOMPARE(rows % RowScheduler::chunkRowsFor(original.height(), 2) == 0 || rows == original.height(), true);
+    rowScheduler.waitForIdle();
+    QCOMPARE(rowsCompleted.load(), rows);
+
+    //Superseding a running ThreadManager job leaves the new one complete and correct
+    ThreadManager threadManager;
+    QImage managed;
+    threadManager.setResampleMap(correctionFactor.getResampleMap());
+    threadManager.setOriginalImage(&original);
+    threadManager.setRectImage(&managed);
+    threadManager.prepare();
+    QFuture<void> superseded = threadManager.run();
+    threadManager.prepare();
+    QVERIFY(superseded.isFinished());
+    QCOMPARE(threadManager.rowsCompleted.load(), 0);
+    QFuture<void> current = threadManager.run();
+    current.waitForFinished();
+    QVERIFY(!current.isCanceled());
+    QCOMPARE(threadManager.rowsCompleted.load(), original.height());
+    QImage reference(correctionFactor.getRectifiedWidth(), original.height(), original.format());
+    reference.fill(0);
+    RectifyKernel::rectifyRows(&original, &reference, *correctionFactor.getResampleMap(), 0, original.height());
+    QCOMPARE(managed, reference);
+}
+
+void testMain::testSubmitChannels(){
+    //Three gray channels rectified in one job match rectifying each on its own, and the composite packs them
+    QRandomGenerator random(1568);
+    CorrectionFactor correctionFactor(777);
+    shared_ptr<const ResampleMap> resampleMap = correctionFactor.getResampleMap();
+    vector<QImage> originals, rectified;
+    for(int channel = 0; channel < 3; channel++){
+        QImage original(777, 93, QImage::Format_Grayscale8);
+        for(int row = 0; row < original.height(); row++){
+            for(int column = 0; column < original.width(); column++){
+                original.scanLine(row)[column] = static_cast<uchar>(random.generate());
+            }
+        }
+        originals.push_back(original);
+        rectified.push_back(QImage(resampleMap->getRectifiedWidth(), original.height(), original.format()));
+    }
+    vector<const QImage *> originalImages = {&originals[0], &originals[1], &originals[2]};
+    vector<QImage *> rectifiedImages = {&rectified[0], &rectified[1], &rectified[2]};
+    QImage composite(resampleMap->getRectifiedWidth(), 93, QImage::Format_RGB32);
+    atomic<int> rows_completed{0};
+
+    RowScheduler rowScheduler;
+    QFuture<void> job = rowScheduler.submitChannels(originalImages, rectifiedImages, &composite, {{2, 0, 1}}, resampleMap, 93, &rows_completed);
+    job.waitForFinished();
+    QCOMPARE(rows_completed.load(), 93);
+    for(int channel = 0; channel < 3; channel++){
+        QImage expected(resampleMap->getRectifiedWidth(), 93, QImage::Format_Grayscale8);
+        RectifyKernel::rectifyRows(&originals[channel], &expected, *resampleMap, 0, 93);
+        QCOMPARE(rectified[channel], expected);
+    }
+    for(int row = 0; row < 93; row += 23){
+        for(int column = 0; column < composite.width(); column += 37){
+            QCOMPARE(composite.pixel(column, row), qRgb(rectified[2].constScanLine(row)[column], rectified[0].constScanLine(row)[column], rectified[1].constScanLine(row)[column]));
+        }
+    }
+
+    //Mismatched channel lists and out of range composite channels are refused
+    QVERIFY_EXCEPTION_THROWN(rowScheduler.submitChannels(originalImages, {&rectified[0]}, nullptr, {{0, 1, 2}}, resampleMap, 93, nullptr), string);
+    QVERIFY_EXCEPTION_THROWN(rowScheduler.submitChannels(originalImages, rectifiedImages, &composite, {{0, 1, 3}}, resampleMap, 93, nullptr), string);
+}
+
+void testMain::testTileColumnsFor(){
+    //Full width while rows alone keep the workers busy, bands no narrower than minTileColumns otherwise
+    QCOMPARE(RowScheduler::tileColumnsFor(8000, 8192, 4), 8000);
+    QCOMPARE(RowScheduler::tileColumnsFor(100, 4, 8), 100);
+    QCOMPARE(RowScheduler::tileColumnsFor(8000, 4, 8), (8000 + 30) / 31); //64 bands wanted, but no more than 8000 / minTileColumns
+    QCOMPARE(RowScheduler::tileColumnsFor(1024, 4, 8), RowScheduler::minTileColumns);
+    QCOMPARE(RowScheduler::tileColumnsFor(8000, 64, 4), 8000 / 2);
+}
 
-    QSignalSpy testRowSpy(rectifyThread, SIGNAL(rowCompleted()));
+void testMain::testSubmitRegion(){
+    //A short wide image is split by column and still comes out whole, and a region only fills itself
+    CorrectionFactor correctionFactor(3000);
+    shared_ptr<const ResampleMap> resampleMap = correctionFactor.getResampleMap();
+    QImage original(3000, 6, QImage::Format_RGB32);
+    for(int row = 0; row < original.height(); row++){
+        for(int column = 0; column < original.width(); column++){
+            original.setPixel(column, row, qRgb(column % 256, (row * 40) % 256, (column / 7) % 256));
+        }
+    }
+    QImage reference(resampleMap->getRectifiedWidth(), original.height(), original.format());
+    reference.fill(0);
+    RectifyKernel::rectifyRows(&original, &reference, *resampleMap, 0, original.height());
 
-    QThreadPool::globalInstance()->start(rectifyThread);
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(4);
+    RowScheduler rowScheduler(&threadPool);
+    QVERIFY(RowScheduler::tileColumnsFor(resampleMap->getRectifiedWidth(), original.height(), 4) < resampleMap->getRectifiedWidth());
+    QImage rectified(reference.size(), original.format());
+    rectified.fill(0);
+    atomic<int> rowsCompleted{0};
+    rowScheduler.submit(&original, &rectified, resampleMap, original.height(), &rowsCompleted).waitForFinished();
+    QCOMPARE(rowsCompleted.load(), original.height());
+    QCOMPARE(rectified, reference);
 
-    do{
-        if(testRowSpy.count() == TEST_IMAGE.height()){
-            QCOMPARE(TEST_IMAGE_RECTIFIED, testImageWork);
+    QRect region(resampleMap->getRectifiedWidth() / 3, 2, 900, 3);
+    QImage partial(reference.size(), original.format());
+    partial.fill(0);
+    rowsCompleted = 0;
+    rowScheduler.submitRegion(&original, &partial, resampleMap, region, &rowsCompleted).waitForFinished();
+    QCOMPARE(rowsCompleted.load(), region.height());
+    QImage expected(reference.size(), original.format());
+    expected.fill(0);
+    for(int row = region.top(); row <= region.bottom(); row++){
+        for(int column = region.left(); column <= region.right(); column++){
+            expected.setPixel(column, row, reference.pixel(column, row));
         }
-    }while (testRowSpy.count() != TEST_IMAGE.height());
+    }
+    QCOMPARE(partial, expected);
+}
+
+void testMain::testCompletedRows(){
+    //Logged chunks come back merged and sorted, and only once
+    CompletedRows completedRows;
+    completedRows.add(8, 12);
+    completedRows.add(0, 4);
+    completedRows.add(20, 24);
+    completedRows.add(4, 8);
+    vector<pair<int, int>> expected = {{0, 12}, {20, 24}};
+    QVERIFY(completedRows.take() == expected);
+    QVERIFY(completedRows.take().empty());
+
+    //A row chunk split into column bands is only logged once its last band is written
+    CorrectionFactor correctionFactor(3000);
+    QImage original(3000, 40, QImage::Format_Grayscale8);
+    original.fill(100);
+    QImage rectified(correctionFactor.getRectifiedWidth(), original.height(), original.format());
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(4);
+    RowScheduler rowScheduler(&threadPool);
+    atomic<int> rowsCompleted{0};
+    rowScheduler.submit(&original, &rectified, correctionFactor.getResampleMap(), original.height(), &rowsCompleted, &completedRows).waitForFinished();
+    expected = {{0, original.height()}};
+    QVERIFY(completedRows.take() == expected);
+    QCOMPARE(rowsCompleted.load(), original.height());
 }
 
 void testMain::testSetOriginalImage(){
@@ -324,18 +1384,12 @@ void testMain::testSetRectImage(){
     QCOMPARE(&testImageWork, threadManager.rectifiedImage);
 }
 
-void testMain::testSetCorrectionFactorVector(){
-    ThreadManager threadManager;
-    CorrectionFactor correctionFactor(TEST_IMAGE.width());
-    threadManager.setCorrectionFactorVector(correctionFactor.getVector());
-    QCOMPARE(correctionFactor.getVector(), threadManager.correctionFactorVector);
-}
-
-void testMain::testSetRectifiedWidth(){
+void testMain::testSetResampleMap(){
     ThreadManager threadManager;
     CorrectionFactor correctionFactor(TEST_IMAGE.width());
-    threadManager.setRectifiedWidth(correctionFactor.getRectifiedWidth());
-    QCOMPARE(correctionFactor.getRectifiedWidth(), threadManager.rectifiedWidth);
+    threadManager.setResampleMap(correctionFactor.getResampleMap());
+    QCOMPARE(correctionFactor.getResampleMap(), threadManager.resampleMap);
+    QCOMPARE(correctionFactor.getRectifiedWidth(), threadManager.resampleMap->getRectifiedWidth());
 }
 
 void testMain::testPrepare(){
@@ -343,17 +1397,27 @@ void testMain::testPrepare(){
     CorrectionFactor correctionFactor(TEST_IMAGE.width());
     QImage testImageWork(correctionFactor.getRectifiedWidth(),
                                   TEST_IMAGE.height(), TEST_IMAGE.format());
-    threadManager.setCorrectionFactorVector(correctionFactor.getVector());
+    threadManager.setResampleMap(correctionFactor.getResampleMap());
     threadManager.setOriginalImage(&TEST_IMAGE);
     threadManager.setRectImage(&testImageWork);
-    threadManager.setRectifiedWidth(correctionFactor.getRectifiedWidth());
     threadManager.prepare();
-    QCOMPARE(threadManager.numberThreads, std::thread::hardware_concurrency());
-    QCOMPARE(threadManager.workers.size(), std::thread::hardware_concurrency());
-    QCOMPARE(threadManager.workerRows, ceil(TEST_IMAGE.height() / std::thread::hardware_concurrency()));
-    QCOMPARE(threadManager.endRow, TEST_IMAGE.height());
+    QCOMPARE(threadManager.numberThreads, static_cast<int>(WorkerPool::usableCpus().size()));
+    QCOMPARE(threadManager.rowScheduler.getMaxWorkers(), threadManager.numberThreads);
+    QCOMPARE(threadManager.chunkRows, RowScheduler::chunkRowsFor(TEST_IMAGE.height(), threadManager.numberThreads));
     QCOMPARE(threadManager.progress, 0);
-    QCOMPARE(threadManager.rowsCompleted, 0);
+    QCOMPARE(threadManager.rowsCompleted.load(), 0);
+
+    //Preparing again for the same size takes the same buffer back, rather than allocating another
+    QImage original(2000, 600, QImage::Format_Grayscale8);
+    CorrectionFactor wideFactor(original.width());
+    threadManager.setResampleMap(wideFactor.getResampleMap());
+    threadManager.setOriginalImage(&original);
+    threadManager.prepare();
+    const uchar *pixels = testImageWork.constBits();
+    qint64 allocations = BufferPool::instance().getAllocationCount();
+    threadManager.prepare();
+    QCOMPARE(testImageWork.constBits(), pixels);
+    QCOMPARE(BufferPool::instance().getAllocationCount(), allocations);
 }
 
 void testMain::testRunTM(){
@@ -361,20 +1425,422 @@ void testMain::testRunTM(){
     CorrectionFactor correctionFactor(TEST_IMAGE.width());
     QImage testImageWork(correctionFactor.getRectifiedWidth(),
                                   TEST_IMAGE.height(), TEST_IMAGE.format());
-    threadManager.setCorrectionFactorVector(correctionFactor.getVector());
+    testImageWork.fill(0);
+    threadManager.setResampleMap(correctionFactor.getResampleMap());
     threadManager.setOriginalImage(&TEST_IMAGE);
     threadManager.setRectImage(&testImageWork);
-    threadManager.setRectifiedWidth(correctionFactor.getRectifiedWidth());
     threadManager.prepare();
     QSignalSpy testProgressSpy(&threadManager, SIGNAL(progressMade(int)));
     QSignalSpy testDoneSpy(&threadManager, SIGNAL(processingDone()));
+    QSignalSpy testRowsSpy(&threadManager, SIGNAL(rowsRectified()));
     threadManager.run();
     testDoneSpy.wait(120000);
-    QCOMPARE(testProgressSpy.count(), 100);
+    //Finished rows are announced at most once per progress update, and all of them by the end
+    QVERIFY(testRowsSpy.count() >= 1);
+    vector<pair<int, int>> rectifiedRows = threadManager.takeRectifiedRows();
+    QVERIFY(rectifiedRows.size() == 1 && rectifiedRows[0] == make_pair(0, TEST_IMAGE.height()));
+    //Progress is sampled, so only check that it climbs to 100 without repeats
+    QVERIFY(testProgressSpy.count() >= 1 && testProgressSpy.count() <= 100);
+    for(int update = 1; update < testProgressSpy.count(); update++){
+        QVERIFY(testProgressSpy[update][0].toInt() > testProgressSpy[update - 1][0].toInt());
+    }
+    QCOMPARE(testProgressSpy.last()[0].toInt(), 100);
     QCOMPARE(testDoneSpy.count(), 1);
+    QCOMPARE(threadManager.rowsCompleted.load(), TEST_IMAGE.height());
     QCOMPARE(testImageWork, TEST_IMAGE_RECTIFIED);
+
+    //Compare against the reference per-pixel path
+    QImage testImageReference(correctionFactor.getRectifiedWidth(),
+                                  TEST_IMAGE.height(), TEST_IMAGE.format());
+    testImageReference.fill(0);
+    for(int row = 0; row < TEST_IMAGE.height(); row++){
+        RectifyKernel::rectifyRowReference(&TEST_IMAGE, &testImageReference, correctionFactor.getRectifiedWidth(), *correctionFactor.getTable(), row);
+    }
+    QCOMPARE(testImageWork, testImageReference);
+}
+
+
+void testMain::testParseCpuList(){
+    vector<int> cpus;
+    QVERIFY(WorkerPool::parseCpuList(" 8,0-3, 2,10-11\n", &cpus));
+    QCOMPARE(cpus, vector<int>({0, 1, 2, 3, 8, 10, 11}));
+    QCOMPARE(WorkerPool::formatCpuList(cpus), QString("0-3,8,10-11"));
+    QVERIFY(WorkerPool::parseCpuList("", &cpus));
+    QVERIFY(cpus.empty());
+    QVERIFY(!WorkerPool::parseCpuList("3-1", &cpus));
+    QVERIFY(!WorkerPool::parseCpuList("0-2-4", &cpus));
+    QVERIFY(!WorkerPool::parseCpuList("a", &cpus));
+    //Huge ranges are refused rather than expanded
+    QVERIFY(!WorkerPool::parseCpuList("0-2000000000", &cpus));
+    QVERIFY(!WorkerPool::parseCpuList(QString::number(WorkerPool::maxCpus), &cpus));
+    QVERIFY(WorkerPool::parseCpuList(QString("0-%1").arg(WorkerPool::maxCpus - 1), &cpus));
+    QCOMPARE(static_cast<int>(cpus.size()), WorkerPool::maxCpus);
+
+    CpuAffinity affinity = CpuAffinity::None;
+    QVERIFY(WorkerPool::parseAffinity("Spread", &affinity));
+    QVERIFY(affinity == CpuAffinity::Spread);
+    QVERIFY(!WorkerPool::parseAffinity("everywhere", &affinity));
+    QCOMPARE(WorkerPool::affinityName(CpuAffinity::Compact), QString("compact"));
+}
+
+void testMain::testPlacementFor(){
+    //Compact fills a node before the next, spread alternates between them
+    vector<vector<int>> nodes = {{0, 1, 2}, {4, 5}};
+    QCOMPARE(WorkerPool::placementFor(nodes, CpuAffinity::Compact), vector<int>({0, 1, 2, 4, 5}));
+    QCOMPARE(WorkerPool::placementFor(nodes, CpuAffinity::Spread), vector<int>({0, 4, 1, 5, 2}));
+    QVERIFY(WorkerPool::placementFor(nodes, CpuAffinity::None).empty());
+
+    //Every usable CPU belongs to exactly one node, whether sysfs has a layout or not
+    vector<int> usable = WorkerPool::usableCpus();
+    QVERIFY(!usable.empty());
+    vector<int> placed = WorkerPool::placementFor(WorkerPool::numaNodes(usable), CpuAffinity::Compact);
+    sort(placed.begin(), placed.end());
+    QCOMPARE(placed, usable);
 }
 
+void testMain::testConfigure(){
+    //Settings round trip through an INI file, and a configured pool still rectifies correctly
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    int firstCpu = WorkerPool::usableCpus().front();
+    WorkerConfig config;
+    config.threads = 3;
+    config.affinity = CpuAffinity::Spread;
+    config.cpus = {firstCpu};
+    {
+        QSettings settings(directory.filePath("workers.ini"), QSettings::IniFormat);
+        config.save(settings);
+    }
+    WorkerConfig loaded = WorkerConfig::load(QSettings(directory.filePath("workers.ini"), QSettings::IniFormat));
+    QCOMPARE(loaded.threads, 3);
+    QVERIFY(loaded.affinity == CpuAffinity::Spread);
+    QCOMPARE(loaded.cpus, vector<int>({firstCpu}));
+    WorkerConfig defaults = WorkerConfig::load(QSettings(directory.filePath("missing.ini"), QSettings::IniFormat));
+    QCOMPARE(defaults.threads, 0);
+    QVERIFY(defaults.affinity == CpuAffinity::None && defaults.cpus.empty());
+
+    //CPUs the process may not use are dropped, leaving all usable ones if none remain
+    WorkerPool pool;
+    QCOMPARE(pool.maxThreadCount(), static_cast<int>(WorkerPool::usableCpus().size()));
+    pool.configure(loaded);
+    QCOMPARE(pool.maxThreadCount(), 3);
+    QCOMPARE(pool.getPlacement(), vector<int>({firstCpu}));
+    config.cpus = {1 << 20};
+    pool.configure(config);
+    QCOMPARE(pool.getAllowedCpus(), WorkerPool::usableCpus());
+
+    ThreadManager threadManager;
+    threadManager.setWorkerConfig(loaded);
+    QCOMPARE(threadManager.getThreadCount(), 3);
+    CorrectionFactor correctionFactor(TEST_IMAGE.width());
+    QImage testImageWork;
+    threadManager.setResampleMap(correctionFactor.getResampleMap());
+    threadManager.setOriginalImage(&TEST_IMAGE);
+    threadManager.setRectImage(&testImageWork);
+    threadManager.prepare();
+    QCOMPARE(threadManager.rowScheduler.getMaxWorkers(), 3);
+    threadManager.run().waitForFinished();
+    QCOMPARE(testImageWork, TEST_IMAGE_RECTIFIED);
+}
+
+void testMain::testTracer(){
+    //Nothing is kept while disabled, every stage and chunk of a render is kept while enabled
+    Tracer &tracer = Tracer::instance();
+    tracer.setEnabled(false);
+    tracer.clear();
+    {
+        TraceScope trace("testTracer::disabled");
+    }
+    QVERIFY(tracer.snapshot().empty());
+    QCOMPARE(tracer.summary(), QString("No timings recorded"));
+
+    tracer.setEnabled(true);
+    ThreadManager threadManager;
+    CorrectionFactor correctionFactor(TEST_IMAGE.width());
+    QImage testImageWork(correctionFactor.getRectifiedWidth(), TEST_IMAGE.height(), TEST_IMAGE.format());
+    threadManager.setResampleMap(correctionFactor.getResampleMap());
+    threadManager.setOriginalImage(&TEST_IMAGE);
+    threadManager.setRectImage(&testImageWork);
+    threadManager.prepare();
+    QSignalSpy testDoneSpy(&threadManager, SIGNAL(processingDone()));
+    threadManager.run();
+    testDoneSpy.wait(120000);
+    tracer.setEnabled(false);
+    QCOMPARE(testDoneSpy.count(), 1);
+
+    int chunks = 0;
+    for(const TraceEvent &event : tracer.snapshot()){
+        QVERIFY(event.startNs >= 0 && event.durationNs >= 0);
+        chunks += qstrcmp(event.name, "RectifyThread::chunk") == 0;
+    }
+    QVERIFY(chunks >= 1);
+    QString summary = tracer.summary();
+    QVERIFY(summary.startsWith("Stage timings:"));
+    QVERIFY(summary.contains("ThreadManager::prepare: 1 x"));
+    QVERIFY(summary.contains("RowScheduler::job"));
+    QVERIFY(summary.contains("RectifyThread::chunk"));
+
+    //The saved trace is Chrome's JSON format, spans plus thread names
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    tracer.writeChromeTrace(directory.filePath("trace.json").toStdString());
+    QFile file(directory.filePath("trace.json"));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QJsonArray traceEvents = QJsonDocument::fromJson(file.readAll()).object()["traceEvents"].toArray();
+    int spans = 0;
+    int threadNames = 0;
+    for(const QJsonValue &value : traceEvents){
+        QJsonObject event = value.toObject();
+        spans += event["ph"].toString() == "X";
+        threadNames += event["ph"].toString() == "M";
+    }
+    QCOMPARE(spans, int(tracer.snapshot().size()));
+    QVERIFY(threadNames >= 1);
+    QVERIFY_EXCEPTION_THROWN(tracer.writeChromeTrace(directory.filePath("missing/trace.json").toStdString()), string);
+    tracer.clear();
+    QVERIFY(tracer.snapshot().empty());
+}
+
+void testMain::testSetSource(){
+    PreviewRenderer previewRenderer;
+    //Large images shrink to the proxy bounds keeping their aspect, small ones are kept as they are
+    QImage tall(3000, 12000, QImage::Format_RGB32);
+    tall.fill(0xFF808080);
+    previewRenderer.setSource(&tall);
+    QCOMPARE(previewRenderer.getProxyImagePtr()->height(), PreviewRenderer::maxProxyHeight);
+    QCOMPARE(previewRenderer.getProxyImagePtr()->width(), 256);
+    QCOMPARE(previewRenderer.getProxyImagePtr()->format(), QImage::Format_RGB32);
+    QImage wide(4000, 400, QImage::Format_Grayscale8);
+    wide.fill(128);
+    previewRenderer.setSource(&wide);
+    QCOMPARE(previewRenderer.getProxyImagePtr()->width(), PreviewRenderer::maxProxyWidth);
+    QCOMPARE(previewRenderer.getProxyImagePtr()->height(), 51);
+    previewRenderer.setSource(&TEST_IMAGE);
+    QVERIFY(previewRenderer.getProxyImagePtr()->width() <= PreviewRenderer::maxProxyWidth);
+    QVERIFY(previewRenderer.getProxyImagePtr()->height() <= PreviewRenderer::maxProxyHeight);
+    QVERIFY(previewRenderer.getPreviewImagePtr()->isNull());
+}
+
+void testMain::testRender(){
+    PreviewRenderer previewRenderer;
+    QVERIFY(previewRenderer.render(EARTH_RADIUS, SATELLITE_ALTITUDE, SATELLITE_SWATH)->isNull());
+    previewRenderer.setSource(&TEST_IMAGE);
+    const QImage *proxy = previewRenderer.getProxyImagePtr();
+
+    //The preview is the proxy rectified with the proxy's own table
+    for(int swath : {SATELLITE_SWATH, SATELLITE_SWATH + 500}){
+        const QImage *preview = previewRenderer.render(EARTH_RADIUS, SATELLITE_ALTITUDE, swath);
+        CorrectionFactor correctionFactor(proxy->width());
+        correctionFactor.setParameters(EARTH_RADIUS, SATELLITE_ALTITUDE, swath);
+        QImage reference(correctionFactor.getRectifiedWidth(), proxy->height(), proxy->format());
+        reference.fill(0);
+        for(int row = 0; row < proxy->height(); row++){
+            RectifyKernel::rectifyRowReference(proxy, &reference, correctionFactor.getRectifiedWidth(), *correctionFactor.getTable(), row);
+        }
+        QCOMPARE(*preview, reference);
+    }
+
+    //Its shape follows the full resolution render
+    CorrectionFactor fullFactor(TEST_IMAGE.width());
+    const QImage *preview = previewRenderer.render(EARTH_RADIUS, SATELLITE_ALTITUDE, SATELLITE_SWATH);
+    double fullAspect = static_cast<double>(fullFactor.getRectifiedWidth()) / TEST_IMAGE.width();
+    double previewAspect = static_cast<double>(preview->width()) / proxy->width();
+    QVERIFY(qAbs(fullAspect - previewAspect) < 0.02);
+}
+
+void testMain::testExpandInputs(){
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    QVERIFY(TEST_IMAGE.save(directory.filePath("a.png")));
+    QVERIFY(TEST_IMAGE.save(directory.filePath("b.png")));
+    QVERIFY(TEST_IMAGE.save(directory.filePath("c.jpg")));
+
+    QCOMPARE(BatchProcessor::expandInputs(QStringList() << directory.path()),
+             QStringList() << directory.filePath("a.png") << directory.filePath("b.png"));
+    QCOMPARE(BatchProcessor::expandInputs(QStringList() << directory.filePath("*.jpg")),
+             QStringList() << directory.filePath("c.jpg"));
+    QCOMPARE(BatchProcessor::expandInputs(QStringList() << directory.filePath("a.png") << directory.filePath("a.png")),
+             QStringList() << directory.filePath("a.png"));
+}
+
+void testMain::testProcessFile(){
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    QVERIFY(TEST_IMAGE.save(directory.filePath("testimage.png")));
+    BatchProcessor batchProcessor;
+    batchProcessor.setOutputDirectory(directory.filePath("out"));
+    QVERIFY(QDir().mkpath(directory.filePath("out")));
+
+    BatchResult result = batchProcessor.processFile(directory.filePath("testimage.png"));
+    QVERIFY(result.error.isEmpty());
+    QCOMPARE(result.outputPath, directory.filePath("out/testimage-rectified.png"));
+    QCOMPARE(result.width, TEST_IMAGE.width());
+    QCOMPARE(result.height, TEST_IMAGE.height());
+    QCOMPARE(QImage(result.outputPath), TEST_IMAGE_RECTIFIED);
+
+    result = batchProcessor.processFile(directory.filePath("missing.png"));
+    QVERIFY(!result.error.isEmpty());
+}
+
+void testMain::testRunBP(){
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    QStringList inputPaths;
+    for(int file = 0; file < 4; file++){
+        inputPaths << directory.filePath(QString("pass%1.png").arg(file));
+        QVERIFY(TEST_IMAGE.save(inputPaths.last()));
+    }
+    BatchProcessor batchProcessor;
+    batchProcessor.setJobs(2);
+    vector<BatchResult> results = batchProcessor.run(inputPaths);
+
+    QCOMPARE(static_cast<int>(results.size()), inputPaths.size());
+    for(const BatchResult &result : results){
+        QVERIFY(result.error.isEmpty());
+        QCOMPARE(QImage(result.outputPath), TEST_IMAGE_RECTIFIED);
+    }
+    QVERIFY(BatchProcessor::formatSummary(results, 1).contains("4 of 4 images rectified"));
+}
+
+
+void testMain::testProcessChannels(){
+    //Three channels of one pass go through a single job and come out next to the composite
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    QImage gray = TEST_IMAGE.convertToFormat(QImage::Format_Grayscale8);
+    QStringList inputPaths;
+    for(int apid : {64, 65, 68}){
+        inputPaths << directory.filePath(QString("pass-%1.png").arg(apid));
+        QVERIFY(gray.save(inputPaths.last()));
+    }
+    BatchProcessor batchProcessor;
+    vector<BatchResult> results = batchProcessor.processChannels(inputPaths, directory.filePath("pass-composite.png"), {{2, 1, 0}});
+
+    QCOMPARE(static_cast<int>(results.size()), 4);
+    QImage expected = TEST_IMAGE_RECTIFIED.convertToFormat(QImage::Format_Grayscale8);
+    for(int channel = 0; channel < 3; channel++){
+        QVERIFY(results[channel].error.isEmpty());
+        QCOMPARE(QImage(results[channel].outputPath).convertToFormat(QImage::Format_Grayscale8).size(), expected.size());
+    }
+    QImage composite(directory.filePath("pass-composite.png"));
+    QCOMPARE(composite.size(), expected.size());
+    QImage channel = QImage(results[0].outputPath).convertToFormat(QImage::Format_Grayscale8);
+    QCOMPARE(qRed(composite.pixel(composite.width() / 2, 10)), static_cast<int>(channel.constScanLine(10)[composite.width() / 2]));
+
+    //One channel of another size fails the whole job
+    QVERIFY(gray.copy(0, 0, 10, 10).save(inputPaths[1]));
+    results = batchProcessor.processChannels(inputPaths, QString(), {{0, 1, 2}});
+    for(const BatchResult &result : results){
+        QVERIFY(!result.error.isEmpty());
+    }
+}
+
+void testMain::testRectifyPnm(){
+    //Stream a PPM through bands that do not divide the height evenly
+    QBuffer input;
+    QBuffer output;
+    input.open(QIODevice::ReadWrite);
+    QVERIFY(TEST_IMAGE.save(&input, "PPM"));
+    input.seek(0);
+    output.open(QIODevice::WriteOnly);
+
+    StripRectifier stripRectifier;
+    stripRectifier.setBandRows(7);
+    stripRectifier.rectifyPnm(&input, &output);
+
+    QCOMPARE(stripRectifier.getRowsWritten(), static_cast<qint64>(TEST_IMAGE.height()));
+    QImage rectified = QImage::fromData(output.data(), "PPM");
+    QCOMPARE(rectified.convertToFormat(QImage::Format_RGB32), TEST_IMAGE_RECTIFIED.convertToFormat(QImage::Format_RGB32));
+
+    //Truncated data and bad headers are reported
+    QBuffer truncated;
+    truncated.setData(input.data().left(input.data().size() / 2));
+    truncated.open(QIODevice::ReadOnly);
+    output.seek(0);
+    QVERIFY_EXCEPTION_THROWN(stripRectifier.rectifyPnm(&truncated, &output), string);
+    QBuffer garbage;
+    garbage.setData("P3\n1 1\n255\n0 0 0\n");
+    garbage.open(QIODevice::ReadOnly);
+    QVERIFY_EXCEPTION_THROWN(stripRectifier.rectifyPnm(&garbage, &output), string);
+    QVERIFY_EXCEPTION_THROWN(stripRectifier.setBandRows(0), string);
+}
+
+void testMain::testRectifyFile(){
+    //Qt never interlaces the PNGs it writes, so this one can be streamed
+    QTemporaryDir directory;
+    QString inputPath = directory.filePath("pass.png");
+    QVERIFY(TEST_IMAGE.save(inputPath, "PNG"));
+    QBuffer output;
+    output.open(QIODevice::WriteOnly);
+    StripRectifier stripRectifier;
+    stripRectifier.setBandRows(5);
+    stripRectifier.rectifyFile(inputPath, &output);
+
+    QCOMPARE(stripRectifier.getRowsWritten(), static_cast<qint64>(TEST_IMAGE.height()));
+    QImage rectified = QImage::fromData(output.data(), "PPM");
+    QCOMPARE(rectified.convertToFormat(QImage::Format_RGB32), TEST_IMAGE_RECTIFIED.convertToFormat(QImage::Format_RGB32));
+    QVERIFY_EXCEPTION_THROWN(stripRectifier.rectifyFile(QString::fromStdString(INPUT_PATH), &output), string);
+
+    //Formats without a row by row reader are refused rather than decoded whole
+    QString bmpPath = directory.filePath("pass.bmp");
+    QVERIFY(TEST_IMAGE.save(bmpPath, "BMP"));
+    QVERIFY_EXCEPTION_THROWN(stripRectifier.rectifyFile(bmpPath, &output), string);
+}
+
+void testMain::testRectifyPng(){
+    //Gray and palette PNGs stream to the same result as the PGM/PPM holding the same pixels
+    QImage gray = TEST_IMAGE.convertToFormat(QImage::Format_Grayscale8);
+    QImage indexed = TEST_IMAGE.convertToFormat(QImage::Format_Indexed8);
+    QImage sources[] = {gray, indexed, TEST_IMAGE};
+    QImage equivalents[] = {gray, indexed.convertToFormat(QImage::Format_RGB888), TEST_IMAGE.convertToFormat(QImage::Format_RGB888)};
+    StripRectifier stripRectifier;
+    stripRectifier.setBandRows(6);
+    QByteArray png;
+    for(int index = 0; index < 3; index++){
+        png.clear();
+        QBuffer pngInput(&png);
+        pngInput.open(QIODevice::WriteOnly);
+        QVERIFY(sources[index].save(&pngInput, "PNG"));
+        pngInput.close();
+        pngInput.open(QIODevice::ReadOnly);
+        QBuffer pngOutput;
+        pngOutput.open(QIODevice::WriteOnly);
+        stripRectifier.rectify(&pngInput, &pngOutput);
+
+        QBuffer pnmInput;
+        pnmInput.open(QIODevice::ReadWrite);
+        QVERIFY(equivalents[index].save(&pnmInput, index == 0 ? "PGM" : "PPM"));
+        pnmInput.seek(0);
+        QBuffer pnmOutput;
+        pnmOutput.open(QIODevice::WriteOnly);
+        stripRectifier.rectify(&pnmInput, &pnmOutput);
+        QCOMPARE(pngOutput.data(), pnmOutput.data());
+    }
+
+    //Truncated and corrupted image data is reported
+    QBuffer output;
+    output.open(QIODevice::WriteOnly);
+    QBuffer truncated;
+    truncated.setData(png.left(png.size() / 2));
+    truncated.open(QIODevice::ReadOnly);
+    QVERIFY_EXCEPTION_THROWN(stripRectifier.rectify(&truncated, &output), string);
+    QByteArray corrupt = png;
+    corrupt[corrupt.size() / 2] = static_cast<char>(corrupt[corrupt.size() / 2] ^ 0x55);
+    QBuffer corrupted(&corrupt);
+    corrupted.open(QIODevice::ReadOnly);
+    QVERIFY_EXCEPTION_THROWN(stripRectifier.rectify(&corrupted, &output), string);
+
+    //Interlaced images are refused, the IHDR chunk sits right after the signature
+    QByteArray interlaced = png;
+    interlaced[28] = 1;
+    quint32 crc = static_cast<quint32>(crc32(0, reinterpret_cast<const Bytef *>(interlaced.constData() + 12), 17));
+    for(int index = 0; index < 4; index++){
+        interlaced[29 + index] = static_cast<char>(crc >> (24 - index * 8));
+    }
+    QBuffer interlacedInput(&interlaced);
+    interlacedInput.open(QIODevice::ReadOnly);
+    QVERIFY_EXCEPTION_THROWN(stripRectifier.rectify(&interlacedInput, &output), string);
+}
 
 QTEST_MAIN(testMain)
 #include "tst_testmain.moc"